@@ -0,0 +1,106 @@
+#ifndef ADAPTIVEGRAIN_H_INCLUDED
+#define ADAPTIVEGRAIN_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file adaptiveGrain.h
+ * @brief File containing the definition of the \ref adaptiveGrain class, which picks the chunk size for a dynamically scheduled loop from the time the loop took last step
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<chrono>
+#include<algorithm>
+#include<cmath>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Chooses the chunk size of a dynamically scheduled loop, so that each chunk takes about the same time whatever the work per item
+    @details With a static schedule each thread gets an equal number of agents. When the work is uneven - infections concentrated in\n
+    a few contaminated places, a burst of travellers arriving from another domain, or a holiday departure date - some threads finish\n
+    early and wait for the slowest. With a dynamic schedule, threads take chunks from a shared counter until the loop is done, so idle\n
+    threads pick up the remaining work. Chunks that are too small spend their time on the shared counter; chunks that are too large\n
+    leave a long tail at the end of the loop.\n
+    Each thread adds the time it spent in the loop with \ref record. After the loop \ref adapt turns the total into a cost per item, and\n
+    sets the chunk size so that a chunk should take the target time. The new size is the geometric mean of the old one and the\n
+    measured one, so that a single noisy step does not swing it too far. \ref grain also caps the chunk size so there are always at least\n
+    four chunks per thread, leaving work to take from the end of the loop.
+    \code
+    adaptiveGrain g(50.);
+    #pragma omp parallel
+    {
+        auto start=adaptiveGrain::now();
+        #pragma omp for schedule(dynamic,g.grain(n,omp_get_num_threads())) nowait
+        for (long i=0;i<n;i++)work(i);
+        g.record(adaptiveGrain::now()-start);
+    }
+    g.adapt(n);
+    \endcode
+*/
+class adaptiveGrain{
+    /** @brief the current chunk size */
+    long _grain=64;
+    /** @brief the time a chunk should take, in nanoseconds */
+    double _targetNs=50000.;
+    /** @brief the time spent by all threads in the loop since the last \ref adapt, in nanoseconds */
+    int64_t _busyNs=0;
+    /** @brief the smallest chunk size allowed */
+    static const long minimum=16;
+public:
+    /** @brief set up with a target time per chunk
+        @param targetMicroseconds the time a chunk should take, in microseconds */
+    adaptiveGrain(double targetMicroseconds=50.){
+        setTarget(targetMicroseconds);
+    }
+    /** @brief change the target time per chunk
+        @param targetMicroseconds the time a chunk should take, in microseconds */
+    void setTarget(double targetMicroseconds){
+        _targetNs=std::max(targetMicroseconds,0.001)*1000.;
+    }
+    /** @brief the current clock time in nanoseconds */
+    static int64_t now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    /** @brief the chunk size to use for a loop - the same on every thread
+        @param items the number of items in the loop
+        @param nThreads the number of threads sharing the loop
+        @return the chunk size, no more than a quarter of each thread's share */
+    long grain(long items,int nThreads){
+        return std::max(1L,std::min(_grain,items/(4L*std::max(nThreads,1))));
+    }
+    /** @brief the chunk size worked out from the costs so far, before capping for a particular loop */
+    long current(){
+        return _grain;
+    }
+    /** @brief add one thread's time in the loop - safe to call from every thread at once
+        @param ns the time spent, in nanoseconds */
+    void record(int64_t ns){
+        #pragma omp atomic
+        _busyNs+=ns;
+    }
+    /** @brief set the chunk size for the next loop from the time recorded since the last call - call outside the parallel region
+        @param items the number of items the recorded time was spent on */
+    void adapt(long items){
+        if (items>0 && _busyNs>0){
+            double measured=_targetNs*items/double(_busyNs);
+            double next=std::sqrt(double(_grain)*measured);
+            _grain=std::max(minimum,std::min(long(next),1L<<24));
+        }
+        _busyNs=0;
+    }
+};
+#endif // ADAPTIVEGRAIN_H_INCLUDED
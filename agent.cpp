@@ -45,10 +45,24 @@ agent::agent(){
     _alive=true;
     _active=true;
     _leaver=false;
+    _destination=-1;
     _locationIsRemote=false;
-    //this is supposed to set a unique ID, but *NOT* threadsafe!! Set the ID instead at agent creation.
-    ID=nextID;
-    nextID++;
+    //set a unique ID - atomic so as to be threadsafe, but for many agents created in parallel use reserveIDs and the constructor below instead.
+    #pragma omp atomic capture
+    ID=nextID++;
+}
+//------------------------------------------------------------------------
+agent::agent(unsigned long id){
+
+    _diseased=false;
+    _immune=false;
+    _recovered=false;
+    _alive=true;
+    _active=true;
+    _leaver=false;
+    _destination=-1;
+    _locationIsRemote=false;
+    ID=id;
 }
 //------------------------------------------------------------------------
 void agent::moveTo(placeTypes location){
@@ -58,7 +72,7 @@ void agent::moveTo(placeTypes location){
         currentPlace=location;
 }
 //------------------------------------------------------------------------
-void agent::process_disease(randomizer& r){
+bool agent::process_disease(randomizer& r){
         //recovery
         if (diseased()){
             if (disease::die(r))                {die();}
@@ -66,8 +80,13 @@ void agent::process_disease(randomizer& r){
         }
         //infection
         assert(places[currentPlace]!=nullptr);
-        if (alive() && !immune() && disease::infect(places[currentPlace]->getContaminationLevel(),r) )becomeInfected();
+        bool newInfection=false;
+        if (alive() && !immune() && disease::infect(places[currentPlace]->getContaminationLevel(),r) ){
+            newInfection=!diseased();
+            becomeInfected();
+        }
         //immunity loss could go here...
+        return newInfection;
 }
 //------------------------------------------------------------------------
 void agent::atHome(){
@@ -118,7 +137,7 @@ void agent::goOnHoliday(){
     if (timeStep::getMonth()==5 && timeStep::getDayOfMonth()==0) {//holiday on 1st of June at midnight!
      if (ID<=35000 ){
       //if (travelList::travelLocations.find("London") == travelList::travelLocations.end()) return;//didn't find the holiday destination
-      //if(travelList::travelLocations["London"]->isOnRemoteDomain())setRemoteLocation();
+      //if(travelList::travelLocations["London"]->isOnRemoteDomain()){setRemoteLocation();setDestination(travelList::travelLocations["London"]->domain());}
       if (_locationIsRemote)leaveDomain();
       placeCache[vehicle]=places[vehicle];//store current values to be restored after trip - NB do this *BEFORE* visit! 
       placeCache[home]=places[home];
@@ -173,6 +192,11 @@ void agent::cough()
         
         if (diseased()) places[currentPlace]->increaseContamination(disease::shedInfection());
 }
+//------------------------------------------------------------------------
+double agent::shedding()
+{
+        return diseased()?disease::shedInfection():0.;
+}
 
 //static variables have to be defined outside the header file
 unsigned long agent::nextID=0;
@@ -61,6 +61,8 @@ class agent{
     bool _active=true;
     /** @brief flag set to true if the agent is about to leave this domain */
     bool _leaver=false;
+    /** @brief the MPI domain the agent goes to when it leaves this one, or -1 if not set - fits in the space before the ID */
+    short _destination;
 public:
      /** @brief Set the value of \ref nextID 
          @details Use with caution - resetting this will cause automatic agent IDs to be set starting from the value set here \n
@@ -69,6 +71,17 @@ public:
     static void setIDbaseValue(unsigned long i){
         nextID=i;
     }
+    /** @brief Set aside a block of agent IDs in one go
+        @details This is thread-safe, so factories can take a whole block of IDs for the agents they are about to make and then\n
+        hand them out inside parallel loops with the \ref agent(unsigned long) constructor, without every agent having to update \ref nextID
+        @param n the number of IDs required
+        @return the first ID of the block - the block runs from this value to this value+n-1*/
+    static unsigned long reserveIDs(unsigned long n){
+        unsigned long first;
+        #pragma omp atomic capture
+        {first=nextID;nextID+=n;}
+        return first;
+    }
     /** @brief Unique agent identifier - should be able to go up to 4e9 */
     unsigned long ID;
 
@@ -131,6 +144,10 @@ iday)    */
      * NB this means that places is initially empty - remember to set agent home/work/transport before anything else happens!\n
      */
     agent();
+    /** @brief create an agent with a given ID
+     *  @details As for the default constructor, but the ID is set directly rather than from \ref nextID - use with \ref reserveIDs when creating agents in parallel.
+        @param id the ID for this agent*/
+    agent(unsigned long id);
     /** @brief Function to change the agent from one place's list of occupants to another 
      *  @details- not used just at present - this function is very expensive on compute time 
      see \ref agent.cpp for definition*/
@@ -153,10 +170,14 @@ iday)    */
     /** @brief if you have the disease, contaminate the current place  - call every timestep \n
      see \ref agent.cpp for definition*/
     void cough();
+    /** @brief the contamination this agent would add to its current place with \ref cough - zero unless it has the disease \n
+     see \ref agent.cpp for definition*/
+    double shedding();
     /** @brief call the disease functions, specified for this agent \n
 
-     see \ref agent.cpp for definition*/
-    void process_disease(randomizer& );
+     see \ref agent.cpp for definition
+     @return true if the agent was infected during this call - used to log infection events*/
+    bool process_disease(randomizer& );
     /** @brief report whether infected with the disease */
     bool diseased(){
         return _diseased;
@@ -273,6 +294,16 @@ iday)    */
     void doNotLeaveDomain(){
          _leaver=false;
     }
+    /** @brief set the MPI domain the agent will go to when it leaves this one
+        @details for a local agent, the domain holding its travel destination (see \ref remoteTravel); for a traveller, the domain it came from
+        @param d the domain number (its MPI rank), or -1 if not known */
+    void setDestination(int d){
+         _destination=d;
+    }
+    /** @brief the MPI domain the agent will go to when it leaves this one, or -1 if not known */
+    int destination(){
+         return _destination;
+    }
     /** @brief agent is present, but will not do anything or engage with other agents   
         @details This is primarily for use with MPI based remote travel where agents have to move to another domain.\n
         To save re-allocating memory, agents can be present both on a local and remote MPI domain - while active \n
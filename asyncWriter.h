@@ -0,0 +1,232 @@
+#ifndef ASYNCWRITER_H_INCLUDED
+#define ASYNCWRITER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file asyncWriter.h
+ * @brief File containing the definition of the \ref asyncWriter class for buffered output written by a background thread
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<charconv>
+#include<chrono>
+#include<iostream>
+#include"traceRecorder.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Text output that is formatted into memory and written to disk by a background thread
+    @details Writing each line of output straight to a file (particularly with std::endl, which flushes every time) makes the model wait\n
+    for the disk - on a shared filesystem with many runs at once this can be a large part of the step time. Instead, values are formatted\n
+    into a memory buffer using the << operator. Once the buffer is full it is handed to a background thread that writes it to the file,\n
+    and an empty buffer is swapped in, so the model only waits for the disk when \ref flush is called (e.g. at the end of a run, or before\n
+    a copy is taken of the output file) or if the writer falls a long way behind.\n
+    Numbers are formatted as they would be by a default std::ostream (doubles to 6 significant figures).
+    \code
+    asyncWriter out;
+    out.open("diseaseSummary.csv");
+    out<<step<<","<<infected<<"\n";
+    out.flush();
+    \endcode
+*/
+class asyncWriter{
+    /** @brief the file being written */
+    FILE* _file=nullptr;
+    /** @brief the buffer currently being filled */
+    std::vector<char> _current;
+    /** @brief full buffers waiting to be written by the background thread */
+    std::deque<std::vector<char>> _queue;
+    /** @brief written buffers kept for re-use, so memory isn't re-allocated every time */
+    std::vector<std::vector<char>> _spare;
+    /** @brief the buffer size at which it gets handed to the background thread */
+    size_t _bufferSize=1<<20;
+    /** @brief the most buffers allowed to wait in the queue before the model has to wait for the writer */
+    size_t _maxQueued=16;
+    /** @brief true while the background thread is writing a buffer */
+    bool _busy=false;
+    /** @brief set to stop the background thread */
+    bool _stop=false;
+    /** @brief protects the queue, spare buffers and flags */
+    std::mutex _lock;
+    /** @brief signals that there is work for the background thread */
+    std::condition_variable _work;
+    /** @brief signals that the background thread has finished a buffer */
+    std::condition_variable _done;
+    /** @brief the background thread */
+    std::thread _writer;
+    /** @brief total time spent by the background thread writing to disk */
+    std::chrono::steady_clock::duration _writeTime{0};
+    //------------------------------------------------------------------------
+    /** @brief the background thread - write out buffers as they arrive until told to stop */
+    void run(){
+        traceRecorder::nameThread("asyncWriter");
+        std::unique_lock<std::mutex> guard(_lock);
+        while (true){
+            _work.wait(guard,[this]{return _stop || !_queue.empty();});
+            if (_queue.empty())break;
+            std::vector<char> buffer=std::move(_queue.front());
+            _queue.pop_front();
+            _busy=true;
+            //write without holding the lock, so the model can carry on filling the next buffer
+            guard.unlock();
+            auto start=std::chrono::steady_clock::now();
+            {
+                traceRecorder::span s("write","io");
+                fwrite(buffer.data(),1,buffer.size(),_file);
+            }
+            auto end=std::chrono::steady_clock::now();
+            guard.lock();
+            _writeTime+=end-start;
+            buffer.clear();
+            _spare.push_back(std::move(buffer));
+            _busy=false;
+            _done.notify_all();
+        }
+    }
+    //------------------------------------------------------------------------
+    /** @brief hand the current buffer to the background thread, and start a new one */
+    void handOver(){
+        if (_current.empty())return;
+        std::unique_lock<std::mutex> guard(_lock);
+        //if the disk is very slow, wait rather than let the queue use up all the memory
+        _done.wait(guard,[this]{return _queue.size()<_maxQueued;});
+        _queue.push_back(std::move(_current));
+        if (!_spare.empty()){
+            _current=std::move(_spare.back());
+            _spare.pop_back();
+        }else{
+            _current=std::vector<char>();
+            _current.reserve(_bufferSize);
+        }
+        _work.notify_one();
+    }
+    /** @brief add some characters to the current buffer */
+    void append(const char* s,size_t n){
+        _current.insert(_current.end(),s,s+n);
+        if (_current.size()>=_bufferSize)handOver();
+    }
+public:
+    /** @brief create a writer - no file is opened until \ref open is called */
+    asyncWriter(){
+        _current.reserve(_bufferSize);
+    }
+    /** @brief write out anything left and stop the background thread */
+    ~asyncWriter(){
+        close();
+    }
+    /** @brief the background thread can't be copied */
+    asyncWriter(const asyncWriter&)=delete;
+    /** @brief nor can the writer be assigned */
+    asyncWriter& operator=(const asyncWriter&)=delete;
+    //------------------------------------------------------------------------
+    /** @brief open a file and start the background thread
+        @param fileName the path of the file
+        @param append if true add to the end of an existing file, otherwise start a new one */
+    void open(std::string fileName,bool append=false){
+        close();
+        _file=fopen(fileName.c_str(),append?"a":"w");
+        if (_file==nullptr){
+            std::cout<<"Unable to open output file "<<fileName<<std::endl;
+            exit(1);
+        }
+        _stop=false;
+        _writer=std::thread(&asyncWriter::run,this);
+    }
+    /** @brief write everything so far out to the file, and wait until it is done */
+    void flush(){
+        if (_file==nullptr)return;
+        handOver();
+        std::unique_lock<std::mutex> guard(_lock);
+        _done.wait(guard,[this]{return _queue.empty() && !_busy;});
+        fflush(_file);
+    }
+    /** @brief write everything out, stop the background thread and close the file */
+    void close(){
+        if (_file==nullptr)return;
+        handOver();
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop=true;
+        }
+        _work.notify_one();
+        _writer.join();
+        fclose(_file);
+        _file=nullptr;
+    }
+    /** @brief the memory held in buffers, in bytes */
+    size_t memoryUsed(){
+        std::lock_guard<std::mutex> guard(_lock);
+        size_t bytes=_current.capacity();
+        for (auto& b:_queue)bytes+=b.capacity();
+        for (auto& b:_spare)bytes+=b.capacity();
+        return bytes;
+    }
+    /** @brief check whether a file is open */
+    bool is_open(){
+        return _file!=nullptr;
+    }
+    /** @brief the total time the background thread has spent writing so far, in seconds */
+    double writeSeconds(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return std::chrono::duration<double>(_writeTime).count();
+    }
+    //------------------------------------------------------------------------
+    /** @brief add raw bytes, e.g. binary data
+        @param s the start of the data
+        @param n the number of bytes */
+    void write(const char* s,size_t n){append(s,n);}
+    /** @brief add a string */
+    asyncWriter& operator<<(const std::string& s){append(s.data(),s.size());return *this;}
+    /** @brief add a C string */
+    asyncWriter& operator<<(const char* s){append(s,strlen(s));return *this;}
+    /** @brief add a single character */
+    asyncWriter& operator<<(char c){append(&c,1);return *this;}
+    /** @brief add an integer value */
+    asyncWriter& operator<<(long v){
+        char s[24];
+        auto r=std::to_chars(s,s+sizeof(s),v);
+        append(s,r.ptr-s);
+        return *this;
+    }
+    /** @brief add an integer value */
+    asyncWriter& operator<<(int v){return *this<<long(v);}
+    /** @brief add an unsigned integer value */
+    asyncWriter& operator<<(unsigned long v){
+        char s[24];
+        auto r=std::to_chars(s,s+sizeof(s),v);
+        append(s,r.ptr-s);
+        return *this;
+    }
+    /** @brief add an unsigned integer value */
+    asyncWriter& operator<<(unsigned v){return *this<<(unsigned long)v;}
+    /** @brief add a floating point value, formatted as by the default std::ostream */
+    asyncWriter& operator<<(double v){
+        char s[32];
+        int n=snprintf(s,sizeof(s),"%g",v);
+        append(s,n);
+        return *this;
+    }
+};
+#endif // ASYNCWRITER_H_INCLUDED
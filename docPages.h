@@ -56,6 +56,14 @@
  * \code
  * mpirun -np 1 -node host1 ./agentmodel parameterFile1 domain1 : -np 1 -node host2 ./agentmodel defaultparameterFile2 domain2
  * \endcode
+ * @subsection Bench Benchmarking
+ * make benchmark builds a program that times each phase of the step on its own for synthetic populations of several sizes - see \ref benchmark.cpp.\n
+ * Save the results from a known good version, then check a change with e.g.
+ * \code
+ * ./benchmark -s 1e4,1e5,1e6 -t 8 -o baseline.json
+ * ./benchmark -s 1e4,1e5,1e6 -t 8 -b baseline.json
+ * \endcode
+ * Any phase that has got slower by more than 10% (set with -tolerance) is flagged, and the program exits with status 1.
  * @subsection dett Detailed Description
  * For a formalised description of the model  see  @ref ODD
  * For parameter settings and builing experiments see @ref params
@@ -248,14 +256,17 @@
  * - First homes are created - enough for 3 agents per home.\n
  * - Agents are then created and allocated 3 to a home until the list of agents is exhausted.\n
  * - Work places are then created, enough for 10 agents per workplace.\n
- * - The agents list is shuffled randomly, then agents are allocated to work places 10 at a time in order.\n
+ * - The agents are put in a random order (using a \ref randomPermutation, so the order is the same whatever the number of threads),\n
+ * then allocated to work places 10 at a time in that order.\n
  * - Vehicles are created representing buses, with a capacity of 30 agents. Agents are allocated to\n 
  * buses in the same order as to work places\n
  * - Travel is initialised with Agents on the bus heading home - every agents has the same\n
  * schedule with the exact same time spent in each place.\n
  * - A (customiseable) number of agents are infected at random with the disease\n
+ * Alternatively the \ref censusFactory draws household, workplace and vehicle sizes from a table of size distributions,\n
+ * building the population in independent chunks so that very large populations can be made in parallel.\n
  * @subsection inpu Input Data
- * None.
+ * None, unless the census model type is used - this reads a table of place sizes (see \ref censusFactory).
  * @subsection subm Submodels
  * @subsubsection dise Disease
  * - Agents are infected if contamination > a uniform random number between 0 and 1, and not immune\n
@@ -0,0 +1,130 @@
+#ifndef DOMAINBALANCER_H_INCLUDED
+#define DOMAINBALANCER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file domainBalancer.h
+ * @brief File containing the definition of the \ref domainBalancer class, which decides how many agents each MPI domain should hand to another to even out the step time
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<vector>
+#include<algorithm>
+#include<numeric>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Plans moves of agents from slow MPI domains to fast ones, so that the run goes at the speed of the average domain rather than the slowest
+    @details Every domain gives the time it spent computing (not waiting for the others) since the last rebalance, and its number of agents.\n
+    The times are smoothed (each new time is averaged with the smoothed one so far), so one noisy interval does not move anything. If the\n
+    slowest domain is more than the tolerance above the mean, slow domains are paired with fast ones - slowest with fastest, then the next\n
+    pair, and so on while the slow one is still over the tolerance - and each slow domain sends agents to its partner. The number is worked\n
+    out from the time per agent on each side, so that both would end at the mean, and only half of it is moved (damping), as the cost of\n
+    an agent is only an estimate. To stop agents being passed back and forth, two domains that have just swapped agents one way may not\n
+    swap them the other way for a number of rebalances (the cooldown), and the smoothed times of both are reset to the mean, so that\n
+    the next decision waits for the effect of the move to be measured.\n
+    Every domain plans from the same numbers, so every domain gets the same plan without any further messages.
+    \code
+    domainBalancer B;
+    B.setup(0.1,3);
+    for (auto& m:B.plan(seconds,agentCounts))if (m.from==myRank)send(m.agents,m.to);
+    \endcode
+*/
+class domainBalancer{
+public:
+    /** @brief agents to be sent from one domain to another */
+    struct move{
+        /** @brief the sending domain */
+        int from;
+        /** @brief the receiving domain */
+        int to;
+        /** @brief the number of agents to send */
+        long agents;
+    };
+private:
+    /** @brief how far above the mean the slowest domain must be before anything is moved, as a fraction */
+    double _tolerance=0.1;
+    /** @brief the number of rebalances for which two domains may not swap agents back the other way */
+    int _cooldown=3;
+    /** @brief the fraction of the estimated excess that is moved */
+    static constexpr double damping=0.5;
+    /** @brief the smoothed time of each domain */
+    std::vector<double> _smoothed;
+    /** @brief for each pair of domains (from*n+to), the rebalance before which agents may not go that way */
+    std::vector<int> _blocked;
+    /** @brief the number of rebalances planned so far */
+    int _round=0;
+public:
+    /** @brief set up the balancer
+        @param tolerance how far above the mean time the slowest domain must be before agents are moved, as a fraction
+        @param cooldown the number of rebalances before two domains that have just swapped agents may swap them back */
+    void setup(double tolerance,int cooldown){
+        _tolerance=std::max(tolerance,0.);
+        _cooldown=std::max(cooldown,0);
+        _smoothed.clear();
+        _blocked.clear();
+        _round=0;
+    }
+    /** @brief the smoothed time of each domain */
+    std::vector<double>& smoothed(){
+        return _smoothed;
+    }
+    /** @brief plan the moves for this rebalance
+        @param seconds the time each domain spent computing since the last rebalance
+        @param agents the number of agents on each domain
+        @return the moves - empty if the domains are balanced within the tolerance */
+    std::vector<move> plan(const std::vector<double>& seconds,const std::vector<long>& agents){
+        int n=seconds.size();
+        if (int(_smoothed.size())!=n){
+            _smoothed=seconds;
+            _blocked.assign(n*n,0);
+        }else{
+            for (int d=0;d<n;d++)_smoothed[d]=0.5*(_smoothed[d]+seconds[d]);
+        }
+        _round++;
+        std::vector<move> moves;
+        if (n<2)return moves;
+        double mean=std::accumulate(_smoothed.begin(),_smoothed.end(),0.)/n;
+        if (mean<=0.)return moves;
+        //domains from slowest to fastest
+        std::vector<int> order(n);
+        std::iota(order.begin(),order.end(),0);
+        std::stable_sort(order.begin(),order.end(),[this](int x,int y){return _smoothed[x]>_smoothed[y];});
+        std::vector<bool> used(n,false);
+        for (int i=0;i<n;i++){
+            int slow=order[i];
+            if (_smoothed[slow]<=(1.+_tolerance)*mean)break;
+            if (used[slow] || agents[slow]<=0)continue;
+            for (int j=n-1;j>i;j--){
+                int fast=order[j];
+                if (used[fast] || _smoothed[fast]>=mean || _blocked[slow*n+fast]>_round)continue;
+                //agents each side would have to lose or gain to end at the mean, at their current time per agent
+                double excess=agents[slow]*(1.-mean/_smoothed[slow]);
+                double room=(_smoothed[fast]>0. && agents[fast]>0)?agents[fast]*(mean/_smoothed[fast]-1.):excess;
+                long count=damping*std::min(excess,room);
+                if (count<=0)continue;
+                moves.push_back({slow,fast,count});
+                used[slow]=used[fast]=true;
+                _blocked[fast*n+slow]=_round+_cooldown+1;
+                _smoothed[slow]=_smoothed[fast]=mean;
+                break;
+            }
+        }
+        return moves;
+    }
+};
+#endif // DOMAINBALANCER_H_INCLUDED
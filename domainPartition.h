@@ -0,0 +1,477 @@
+#ifndef DOMAINPARTITION_H_INCLUDED
+#define DOMAINPARTITION_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file domainPartition.h
+ * @brief File containing the definition of the \ref domainPartition class, which splits a population between MPI domains so that few agents use places on another domain
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<vector>
+#include<queue>
+#include<random>
+#include<numeric>
+#include<algorithm>
+#include<iostream>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Shares agents and places out between a number of MPI domains, keeping each agent on the same domain as its places where possible
+    @details Agents and places form a bipartite graph - each agent is joined to its home, work and vehicle. An edge between an agent and a\n
+    place on another domain is "cut": the place is then used by agents of more than one domain, so its contamination has to be shared between\n
+    them every step (see \ref MUIcoupler::setupSharedPlaces). The partition tries to cut as few edges as it can, while giving each domain about\n
+    the same number of agents.\n
+    Agents are first folded into their places, giving a graph of places in which two places are joined by the number of agents that use both,\n
+    and each place weighs the number of agents that will go with it (see below) - every domain has a copy of every place, so only the agents\n
+    need sharing out evenly. This graph is split with a multilevel method:-\n
+    - coarsen: places are paired with the neighbour they share most agents with (heavy edge matching), and each pair merged, over and over\n
+      until the graph is small;
+    - split: the small graph is cut into pieces by growing each piece outward from a seed, always taking the place most strongly tied to\n
+      it, until it has its share of the weight - this is tried from a few seeds, and the smallest cut kept;
+    - refine: the pieces are carried back through each finer graph, moving places on the edge of a piece to the piece they are most tied to,\n
+      as long as no piece gets more than (1+imbalance) times its share.\n
+    Each agent then goes to the domain holding most of its places (its home's, if they are all different), which is the fewest cuts it can have -\n
+    unless that domain already has more than its share of agents, when an agent that works away from home is kept on its home's domain.\n
+    The random choices use a fixed seed, so every domain working out the partition from the same population gets the same answer, without\n
+    having to talk to the others.
+    \code
+    domainPartition D;
+    D.build(pop.nPlaces(),pop.nAgents(),pop.home(),pop.work(),pop.vehicle(),16);
+    D.report();
+    for (uint64_t i=0;i<pop.nAgents();i++)if (D.agentDomain(i)==myRank)makeAgent(i);
+    \endcode
+*/
+class domainPartition{
+    /** @brief a weighted graph in compressed row form - the neighbours of vertex v are adjacent[start[v]] to adjacent[start[v+1]-1] */
+    struct graph{
+        /** @brief where the neighbours of each vertex start, plus one past the end */
+        std::vector<uint64_t> start;
+        /** @brief the neighbours */
+        std::vector<uint32_t> adjacent;
+        /** @brief the weight of the edge to each neighbour - the number of agents joining the two */
+        std::vector<uint32_t> weight;
+        /** @brief the weight of each vertex */
+        std::vector<uint64_t> size;
+        /** @brief the number of vertices */
+        uint64_t vertices()const{return size.size();}
+    };
+    /** @brief the number of domains */
+    int _nDomains=0;
+    /** @brief the largest weight of a domain, as a fraction above its share */
+    double _imbalance=0.03;
+    /** @brief the domain of each place */
+    std::vector<int> _placeDomain;
+    /** @brief the domain of each agent */
+    std::vector<int> _agentDomain;
+    /** @brief the number of agent-place edges cut */
+    uint64_t _edgeCut=0;
+    /** @brief the number of places used by agents of more than one domain */
+    uint64_t _sharedPlaces=0;
+    /** @brief random numbers for the vertex orders - always the same seed */
+    std::mt19937_64 _random;
+    /** @brief stop coarsening at about this many vertices per domain */
+    static const int coarsestPerDomain=30;
+    /** @brief the number of seeds tried for the first split */
+    static const int tries=4;
+    /** @brief the most refinement passes at each level */
+    static const int passes=8;
+    //------------------------------------------------------------------------
+    /** @brief the vertices in a random order */
+    std::vector<uint32_t> shuffled(uint64_t n){
+        std::vector<uint32_t> order(n);
+        std::iota(order.begin(),order.end(),0);
+        std::shuffle(order.begin(),order.end(),_random);
+        return order;
+    }
+    /** @brief add up repeated neighbours of each vertex, and drop edges from a vertex to itself
+        @param g a graph whose neighbour lists may repeat, each repeat with its own weight */
+    static void merge(graph& g){
+        std::vector<int64_t> where(g.vertices(),-1);
+        uint64_t k=0,first=0;
+        for (uint64_t v=0;v<g.vertices();v++){
+            uint64_t rowStart=k;
+            for (uint64_t e=first;e<g.start[v+1];e++){
+                uint32_t u=g.adjacent[e];
+                if (u==v)continue;
+                if (where[u]>=int64_t(rowStart)){
+                    g.weight[where[u]]+=g.weight[e];
+                }else{
+                    where[u]=k;
+                    g.adjacent[k]=u;
+                    g.weight[k]=g.weight[e];
+                    k++;
+                }
+            }
+            first=g.start[v+1];
+            g.start[v+1]=k;
+        }
+        g.adjacent.resize(k);
+        g.weight.resize(k);
+    }
+    /** @brief fold the agents into their places
+        @details two places are joined once for every agent that uses both, and each place weighs the number of agents expected to go with it */
+    static graph placeGraph(uint64_t nPlaces,uint64_t nAgents,const uint32_t* home,const uint32_t* work,const uint32_t* vehicle){
+        graph g;
+        g.size.assign(nPlaces,0);
+        g.start.assign(nPlaces+1,0);
+        for (uint64_t i=0;i<nAgents;i++){
+            //the agent will go with its work and vehicle if they end up together, otherwise with its home - so it weighs on that place
+            g.size[work[i]==vehicle[i]?work[i]:home[i]]++;
+            uint32_t p[3]={home[i],work[i],vehicle[i]};
+            for (int a=0;a<3;a++)for (int b=a+1;b<3;b++){
+                if (p[a]!=p[b]){g.start[p[a]+1]++;g.start[p[b]+1]++;}
+            }
+        }
+        for (uint64_t v=0;v<nPlaces;v++)g.start[v+1]+=g.start[v];
+        g.adjacent.resize(g.start[nPlaces]);
+        g.weight.assign(g.start[nPlaces],1);
+        std::vector<uint64_t> next(g.start.begin(),g.start.end()-1);
+        for (uint64_t i=0;i<nAgents;i++){
+            uint32_t p[3]={home[i],work[i],vehicle[i]};
+            for (int a=0;a<3;a++)for (int b=a+1;b<3;b++){
+                if (p[a]!=p[b]){g.adjacent[next[p[a]]++]=p[b];g.adjacent[next[p[b]]++]=p[a];}
+            }
+        }
+        merge(g);
+        return g;
+    }
+    /** @brief merge pairs of vertices joined by heavy edges
+        @param g the graph to coarsen
+        @param coarse set to the coarser graph
+        @param largest no merged vertex may weigh more than this
+        @return the vertex of the coarse graph that each vertex of g went into */
+    std::vector<uint32_t> coarsen(const graph& g,graph& coarse,uint64_t largest){
+        const uint32_t unmatched=UINT32_MAX;
+        std::vector<uint32_t> match(g.vertices(),unmatched);
+        std::vector<uint32_t> order=shuffled(g.vertices());
+        for (auto v:order){
+            if (match[v]!=unmatched)continue;
+            uint32_t best=v,heaviest=0;
+            for (uint64_t e=g.start[v];e<g.start[v+1];e++){
+                uint32_t u=g.adjacent[e];
+                if (match[u]==unmatched && g.weight[e]>heaviest && g.size[u]+g.size[v]<=largest){
+                    best=u;
+                    heaviest=g.weight[e];
+                }
+            }
+            match[v]=best;
+            match[best]=v;
+        }
+        //homes are only joined to workplaces and vehicles, so most find no partner above - pair those left over with another vertex
+        //sharing a neighbour (two hop matching), and pair up places with no neighbours at all, or coarsening soon stalls
+        for (auto v:order){
+            uint32_t waiting=unmatched;
+            for (uint64_t e=g.start[v];e<g.start[v+1];e++){
+                uint32_t u=g.adjacent[e];
+                if (match[u]!=u)continue;
+                if (waiting!=unmatched && g.size[u]+g.size[waiting]<=largest){
+                    match[u]=waiting;
+                    match[waiting]=u;
+                    waiting=unmatched;
+                }else waiting=u;
+            }
+        }
+        uint32_t waiting=unmatched;
+        for (uint64_t v=0;v<g.vertices();v++){
+            if (match[v]!=v || g.start[v+1]>g.start[v])continue;
+            if (waiting!=unmatched && g.size[v]+g.size[waiting]<=largest){
+                match[v]=waiting;
+                match[waiting]=v;
+                waiting=unmatched;
+            }else waiting=v;
+        }
+        std::vector<uint32_t> map(g.vertices());
+        uint32_t n=0;
+        for (uint64_t v=0;v<g.vertices();v++){
+            if (match[v]>=v)map[v]=n++;
+            else map[v]=map[match[v]];
+        }
+        coarse.size.assign(n,0);
+        coarse.start.assign(n+1,0);
+        for (uint64_t v=0;v<g.vertices();v++){
+            coarse.size[map[v]]+=g.size[v];
+            coarse.start[map[v]+1]+=g.start[v+1]-g.start[v];
+        }
+        for (uint32_t c=0;c<n;c++)coarse.start[c+1]+=coarse.start[c];
+        coarse.adjacent.resize(coarse.start[n]);
+        coarse.weight.resize(coarse.start[n]);
+        std::vector<uint64_t> next(coarse.start.begin(),coarse.start.end()-1);
+        for (uint64_t v=0;v<g.vertices();v++){
+            for (uint64_t e=g.start[v];e<g.start[v+1];e++){
+                coarse.adjacent[next[map[v]]]=map[g.adjacent[e]];
+                coarse.weight[next[map[v]]++]=g.weight[e];
+            }
+        }
+        merge(coarse);
+        return map;
+    }
+    /** @brief the total weight of the edges joining different domains */
+    static uint64_t cut(const graph& g,const std::vector<int>& domain){
+        uint64_t c=0;
+        for (uint64_t v=0;v<g.vertices();v++){
+            for (uint64_t e=g.start[v];e<g.start[v+1];e++)if (domain[g.adjacent[e]]!=domain[v])c+=g.weight[e];
+        }
+        return c/2;
+    }
+    /** @brief the weight of each domain */
+    std::vector<uint64_t> weights(const graph& g,const std::vector<int>& domain){
+        std::vector<uint64_t> w(_nDomains,0);
+        for (uint64_t v=0;v<g.vertices();v++)w[domain[v]]+=g.size[v];
+        return w;
+    }
+    /** @brief split a (small) graph by growing each domain from a seed, taking the vertex most tied to it each time
+        @return the domain of each vertex */
+    std::vector<int> grow(const graph& g){
+        uint64_t total=std::accumulate(g.size.begin(),g.size.end(),uint64_t(0));
+        std::vector<int> domain(g.vertices(),-1);
+        std::vector<uint64_t> tie(g.vertices(),0);
+        std::vector<uint32_t> seeds=shuffled(g.vertices());
+        uint64_t nextSeed=0,taken=0;
+        for (int d=0;d<_nDomains-1;d++){
+            //each domain aims for an equal share of what is left, so that overshoots don't pile up on the last one
+            uint64_t share=(total-taken)/(_nDomains-d),w=0;
+            std::priority_queue<std::pair<uint64_t,uint32_t>> frontier;
+            std::vector<uint32_t> touched;
+            while (w<share){
+                if (frontier.empty()){
+                    while (nextSeed<seeds.size() && domain[seeds[nextSeed]]>=0)nextSeed++;
+                    if (nextSeed==seeds.size())break;
+                    frontier.push({0,seeds[nextSeed]});
+                }
+                uint32_t v=frontier.top().second;
+                uint64_t t=frontier.top().first;
+                frontier.pop();
+                if (domain[v]>=0 || t!=tie[v])continue;
+                domain[v]=d;
+                w+=g.size[v];
+                for (uint64_t e=g.start[v];e<g.start[v+1];e++){
+                    uint32_t u=g.adjacent[e];
+                    if (domain[u]>=0)continue;
+                    tie[u]+=g.weight[e];
+                    touched.push_back(u);
+                    frontier.push({tie[u],u});
+                }
+            }
+            for (auto u:touched)tie[u]=0;
+            taken+=w;
+        }
+        for (auto& d:domain)if (d<0)d=_nDomains-1;
+        return domain;
+    }
+    /** @brief move vertices on the edge of a domain to the neighbouring domain they are most tied to
+        @details a move is made if it lowers the cut, or keeps it the same and evens up the weights, without taking the new domain over\n
+        the limit, or the old one below the floor. A vertex in a domain that is over the limit, or next to one under the floor, may move even\n
+        if the cut goes up - without the floor, domains could all fill up to the limit, leaving the last one short by the sum of the excesses.
+        @param g the graph
+        @param domain the domain of each vertex - changed in place
+        @param limit the most any domain may weigh
+        @param floor the least any domain should weigh */
+    void refine(const graph& g,std::vector<int>& domain,uint64_t limit,uint64_t floor){
+        std::vector<uint64_t> w=weights(g,domain);
+        std::vector<int64_t> tie(_nDomains,0);
+        std::vector<int> near;
+        for (int pass=0;pass<passes;pass++){
+            uint64_t moved=0;
+            for (uint64_t v=0;v<g.vertices();v++){
+                int own=domain[v];
+                near.clear();
+                for (uint64_t e=g.start[v];e<g.start[v+1];e++){
+                    int d=domain[g.adjacent[e]];
+                    if (tie[d]==0 && d!=own)near.push_back(d);
+                    tie[d]+=g.weight[e];
+                }
+                bool over=w[own]>limit;
+                int best=own;
+                int64_t bestGain=0;
+                for (auto d:near){
+                    if (w[d]+g.size[v]>limit || (!over && w[own]<floor+g.size[v]))continue;
+                    int64_t gain=tie[d]-tie[own];
+                    bool better=(best==own)?(gain>0 || (gain==0 && w[d]+g.size[v]<w[own]) || over || w[d]<floor)
+                                          :(gain>bestGain || (gain==bestGain && w[d]<w[best]));
+                    if (better){
+                        best=d;
+                        bestGain=gain;
+                    }
+                }
+                for (auto d:near)tie[d]=0;
+                tie[own]=0;
+                if (best!=own){
+                    w[own]-=g.size[v];
+                    w[best]+=g.size[v];
+                    domain[v]=best;
+                    moved++;
+                }
+            }
+            if (moved==0)break;
+        }
+    }
+public:
+    /** @brief split a population between domains
+        @param nPlaces the number of places
+        @param nAgents the number of agents
+        @param home the home place index of each agent
+        @param work the work place index of each agent
+        @param vehicle the vehicle place index of each agent
+        @param nDomains the number of domains
+        @param imbalance the most a domain's weight may be above its share, as a fraction */
+    void build(uint64_t nPlaces,uint64_t nAgents,const uint32_t* home,const uint32_t* work,const uint32_t* vehicle,int nDomains,double imbalance=0.03){
+        _nDomains=std::max(nDomains,1);
+        _imbalance=std::max(imbalance,0.);
+        _random.seed(1);
+        //the graphs from finest to coarsest, and how each vertex maps onto the next one down
+        std::vector<graph> levels;
+        std::vector<std::vector<uint32_t>> maps;
+        levels.push_back(placeGraph(nPlaces,nAgents,home,work,vehicle));
+        uint64_t total=nAgents;
+        uint64_t coarsest=uint64_t(coarsestPerDomain)*_nDomains;
+        uint64_t largest=std::max<uint64_t>(1,(3*total)/(2*coarsest));
+        while (levels.back().vertices()>coarsest){
+            graph coarse;
+            std::vector<uint32_t> map=coarsen(levels.back(),coarse,largest);
+            //stop if hardly anything could be merged - e.g. places that no agent shares with another
+            if (coarse.vertices()>0.95*levels.back().vertices())break;
+            levels.push_back(std::move(coarse));
+            maps.push_back(std::move(map));
+        }
+        //split the coarsest graph, keeping the best of a few tries - those within the limit first, then the smallest cut
+        uint64_t share=total/_nDomains+1;
+        uint64_t heaviest=*std::max_element(levels.back().size.begin(),levels.back().size.end());
+        uint64_t slack=std::max<uint64_t>(_imbalance*share,heaviest);
+        uint64_t limit=share+slack,floor=share>slack?share-slack:0;
+        std::vector<int> domain;
+        uint64_t bestCut=0;
+        bool bestFits=false;
+        for (int t=0;t<tries;t++){
+            std::vector<int> d=grow(levels.back());
+            refine(levels.back(),d,limit,floor);
+            std::vector<uint64_t> w=weights(levels.back(),d);
+            bool fits=*std::max_element(w.begin(),w.end())<=limit;
+            uint64_t c=cut(levels.back(),d);
+            if (t==0 || (fits && !bestFits) || (fits==bestFits && c<bestCut)){
+                domain=d;
+                bestCut=c;
+                bestFits=fits;
+            }
+        }
+        //carry the split back up to the places, tightening the limit as the vertices get lighter
+        for (int l=levels.size()-2;l>=0;l--){
+            std::vector<int> finer(levels[l].vertices());
+            for (uint64_t v=0;v<finer.size();v++)finer[v]=domain[maps[l][v]];
+            domain.swap(finer);
+            heaviest=*std::max_element(levels[l].size.begin(),levels[l].size.end());
+            slack=std::max<uint64_t>(_imbalance*share,heaviest);
+            refine(levels[l],domain,share+slack,share>slack?share-slack:0);
+        }
+        //places with no neighbours (unused, or with agents that never leave them) can go anywhere without cutting anything - use them to even
+        //up the weights, heaviest first
+        const graph& g=levels[0];
+        std::vector<uint64_t> w=weights(g,domain);
+        std::vector<uint32_t> alone;
+        for (uint64_t v=0;v<g.vertices();v++){
+            if (g.start[v+1]==g.start[v]){
+                alone.push_back(v);
+                w[domain[v]]-=g.size[v];
+            }
+        }
+        std::stable_sort(alone.begin(),alone.end(),[&g](uint32_t x,uint32_t y){return g.size[x]>g.size[y];});
+        for (auto v:alone){
+            domain[v]=std::min_element(w.begin(),w.end())-w.begin();
+            w[domain[v]]+=g.size[v];
+        }
+        _placeDomain.swap(domain);
+        //each agent goes with most of its places - but an agent working away from home goes home instead if its work domain
+        //has too many agents, which costs one more cut
+        _agentDomain.resize(nAgents);
+        std::vector<uint64_t> count(_nDomains,0);
+        for (uint64_t i=0;i<nAgents;i++){
+            int h=_placeDomain[home[i]],w=_placeDomain[work[i]],v=_placeDomain[vehicle[i]];
+            _agentDomain[i]=(w==v)?w:h;
+            count[_agentDomain[i]]++;
+        }
+        uint64_t most=(1.+_imbalance)*nAgents/_nDomains+1;
+        for (uint64_t i=0;i<nAgents;i++){
+            int h=_placeDomain[home[i]],d=_agentDomain[i];
+            if (d!=h && count[d]>most && count[h]<most){
+                _agentDomain[i]=h;
+                count[d]--;
+                count[h]++;
+            }
+        }
+        _edgeCut=0;
+        //the domain of the first agent found using each place, and whether an agent of another domain uses it too
+        std::vector<int> user(nPlaces,-1);
+        std::vector<bool> shared(nPlaces,false);
+        for (uint64_t i=0;i<nAgents;i++){
+            int h=_placeDomain[home[i]],w=_placeDomain[work[i]],v=_placeDomain[vehicle[i]],d=_agentDomain[i];
+            _edgeCut+=(h!=d)+(w!=d && work[i]!=home[i])+(v!=d && vehicle[i]!=home[i] && vehicle[i]!=work[i]);
+            for (uint32_t p:{home[i],work[i],vehicle[i]}){
+                if (user[p]<0)user[p]=d;
+                else if (user[p]!=d)shared[p]=true;
+            }
+        }
+        _sharedPlaces=std::count(shared.begin(),shared.end(),true);
+    }
+    /** @brief the number of domains */
+    int domains(){
+        return _nDomains;
+    }
+    /** @brief the domain of a place */
+    int placeDomain(uint64_t p){
+        return _placeDomain[p];
+    }
+    /** @brief the domain of an agent */
+    int agentDomain(uint64_t i){
+        return _agentDomain[i];
+    }
+    /** @brief the number of agent-place edges joining an agent to a place on another domain */
+    uint64_t edgeCut(){
+        return _edgeCut;
+    }
+    /** @brief the number of places used by agents of more than one domain
+        @details each has its contamination shared between the domains every step, as one double in an MPI_Allreduce (see \ref MUIcoupler::shareContamination) */
+    uint64_t sharedPlaces(){
+        return _sharedPlaces;
+    }
+    /** @brief the number of agents on each domain */
+    std::vector<uint64_t> agentCounts(){
+        std::vector<uint64_t> n(_nDomains,0);
+        for (auto d:_agentDomain)n[d]++;
+        return n;
+    }
+    /** @brief the number of places on each domain */
+    std::vector<uint64_t> placeCounts(){
+        std::vector<uint64_t> n(_nDomains,0);
+        for (auto d:_placeDomain)n[d]++;
+        return n;
+    }
+    /** @brief print the edge cut, the number of shared places and the number of agents and places on each domain */
+    void report(){
+        std::vector<uint64_t> a=agentCounts(),p=placeCounts();
+        uint64_t nAgents=_agentDomain.size();
+        double mean=double(nAgents)/_nDomains;
+        std::cout<<"Population split between "<<_nDomains<<" domains: "<<_edgeCut<<" of the agent-place links cross domains ("
+                 <<(nAgents>0?100.*_edgeCut/(3.*nAgents):0.)<<"% of at most "<<3*nAgents<<")"<<std::endl;
+        std::cout<<"Shared places: "<<_sharedPlaces<<" places are used by agents of more than one domain ("<<_sharedPlaces*sizeof(double)
+                 <<" bytes of contamination summed over the domains every step)"<<std::endl;
+        std::cout<<"Agents per domain: largest "<<*std::max_element(a.begin(),a.end())<<", smallest "<<*std::min_element(a.begin(),a.end())
+                 <<", imbalance "<<(mean>0?*std::max_element(a.begin(),a.end())/mean:1.)<<std::endl;
+        for (int d=0;d<_nDomains;d++)std::cout<<"  domain "<<d<<": "<<a[d]<<" agents, "<<p[d]<<" places"<<std::endl;
+    }
+};
+#endif // DOMAINPARTITION_H_INCLUDED
@@ -0,0 +1,262 @@
+#ifndef EVENTLOG_H_INCLUDED
+#define EVENTLOG_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file eventLog.h
+ * @brief File containing the definition of the \ref eventLog class, which records infection events from inside parallel loops
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstdio>
+#include<algorithm>
+#include<string>
+#include<vector>
+#include<deque>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<chrono>
+#include<iostream>
+#include"traceRecorder.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief One infection - where and when an agent caught the disease */
+struct infectionEvent{
+    /** @brief the step in which the infection happened */
+    int64_t step;
+    /** @brief the ID of the agent infected */
+    uint64_t agentID;
+    /** @brief the ID of the place it was infected in */
+    uint64_t placeID;
+    /** @brief the type of that place - see \ref agent::placeTypes */
+    int32_t placeType;
+    /** @brief padding to keep each event 32 bytes */
+    int32_t spare;
+};
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Records infection events from many threads at once, and writes them to a binary file in the background
+    @details Each OpenMP thread adds events to its own chunk of memory, so no lock is needed when an event is recorded. When a thread's\n
+    chunk fills up it is handed to a background thread to be written, and the recording thread takes an empty chunk from a pool -\n
+    only this hand-over (once every few thousand events) needs a lock.\n
+    The pool is limited by a memory budget. If the writer can't keep up and the pool runs out, the policy decides what happens:-\n
+    - "block" - the recording thread waits for the writer to free a chunk (no events lost, but the model slows down)\n
+    - "drop"  - the chunk is emptied and its events are lost (the model carries on at full speed) - the number dropped is reported.\n
+    Events from different threads are written chunk by chunk, so the file is not in step order - sort by step if needed.\n
+    File layout:-
+    \code
+    "MOPEVENT" | version (uint32) | byte order check 0x01020304 (uint32) | bytes per event (uint32) | spare (uint32)
+    then one \ref infectionEvent (32 bytes) after another
+    \endcode
+    See experiments/mopatopReader.py for a reader. Use from inside a parallel loop like this:-
+    \code
+    #pragma omp parallel for
+    for (long i=0;i<agents.size();i++){
+        if (agents[i]->process_disease(r)) log.record(omp_get_thread_num(),step,agents[i]->getID(),placeID,placeType);
+    }
+    log.flush();
+    \endcode
+*/
+class eventLog{
+    /** @brief what to do if the memory budget is used up */
+    enum policies{block,drop};
+    /** @brief a chunk of events */
+    typedef std::vector<infectionEvent> chunk;
+    /** @brief the chunk each thread is currently filling - aligned so that threads don't share cache lines */
+    struct alignas(64) threadChunk{
+        /** @brief the events so far */
+        chunk events;
+    };
+    /** @brief the file being written */
+    FILE* _file=nullptr;
+    /** @brief one chunk being filled per thread */
+    std::vector<threadChunk> _current;
+    /** @brief full chunks waiting to be written */
+    std::deque<chunk> _queue;
+    /** @brief empty chunks ready for use */
+    std::vector<chunk> _free;
+    /** @brief number of events in each chunk */
+    size_t _chunkEvents=4096;
+    /** @brief the policy when memory runs out */
+    policies _policy=block;
+    /** @brief true while the writer is writing a chunk */
+    bool _busy=false;
+    /** @brief set to stop the background thread */
+    bool _stop=false;
+    /** @brief protects the queue, pool and counters */
+    std::mutex _lock;
+    /** @brief signals that a chunk is ready to write */
+    std::condition_variable _work;
+    /** @brief signals that a chunk has been written and is free again */
+    std::condition_variable _done;
+    /** @brief the background thread */
+    std::thread _writer;
+    /** @brief number of events written */
+    uint64_t _written=0;
+    /** @brief number of events lost because memory ran out (drop policy) */
+    uint64_t _dropped=0;
+    /** @brief total time threads have waited for memory (block policy) */
+    std::chrono::steady_clock::duration _blockedTime{0};
+    //------------------------------------------------------------------------
+    /** @brief the background thread - write out chunks as they arrive */
+    void run(){
+        traceRecorder::nameThread("eventLog");
+        std::unique_lock<std::mutex> guard(_lock);
+        while (true){
+            _work.wait(guard,[this]{return _stop || !_queue.empty();});
+            if (_queue.empty())break;
+            chunk c=std::move(_queue.front());
+            _queue.pop_front();
+            _busy=true;
+            guard.unlock();
+            {
+                traceRecorder::span s("write events","io");
+                fwrite(c.data(),sizeof(infectionEvent),c.size(),_file);
+            }
+            guard.lock();
+            _written+=c.size();
+            c.clear();
+            _free.push_back(std::move(c));
+            _busy=false;
+            _done.notify_all();
+        }
+    }
+    /** @brief hand a thread's chunk to the writer and give the thread an empty one
+        @param t the thread number
+        @param wait true to wait for an empty chunk whatever the policy - only a chunk handed over while recording may be dropped */
+    void handOver(int t,bool wait){
+        chunk& c=_current[t].events;
+        if (c.empty())return;
+        std::unique_lock<std::mutex> guard(_lock);
+        if (_free.empty()){
+            if (_policy==drop && !wait){
+                _dropped+=c.size();
+                c.clear();
+                return;
+            }
+            auto start=std::chrono::steady_clock::now();
+            traceRecorder::span s("wait for event memory","io");
+            _done.wait(guard,[this]{return !_free.empty();});
+            _blockedTime+=std::chrono::steady_clock::now()-start;
+        }
+        _queue.push_back(std::move(c));
+        c=std::move(_free.back());
+        _free.pop_back();
+        _work.notify_one();
+    }
+public:
+    /** @brief finish writing and stop the background thread */
+    ~eventLog(){
+        close();
+    }
+    /** @brief open the log file and set aside the memory for events
+        @param fileName the path of the file
+        @param nThreads the number of threads that will record events (thread numbers 0 to nThreads-1)
+        @param memoryBudgetMB the most memory to use for events waiting to be written, in MB
+        @param policy "block" or "drop" - what to do when the memory is all used up */
+    void open(std::string fileName,int nThreads,long memoryBudgetMB,std::string policy){
+        close();
+        if (policy!="block" && policy!="drop"){
+            std::cout<<"Unknown event log policy "<<policy<<" - should be block or drop"<<std::endl;
+            exit(1);
+        }
+        _policy=(policy=="drop")?drop:block;
+        _file=fopen(fileName.c_str(),"wb");
+        if (_file==nullptr){
+            std::cout<<"Unable to open event log "<<fileName<<std::endl;
+            exit(1);
+        }
+        //every thread needs its own chunk plus at least one spare
+        size_t nChunks=std::max<size_t>(memoryBudgetMB*1024*1024/(_chunkEvents*sizeof(infectionEvent)),nThreads+1);
+        _current.assign(nThreads,threadChunk());
+        for (auto& c:_current)c.events.reserve(_chunkEvents);
+        _free.assign(nChunks-nThreads,chunk());
+        for (auto& c:_free)c.reserve(_chunkEvents);
+        _queue.clear();
+        _written=0;_dropped=0;_blockedTime=std::chrono::steady_clock::duration(0);
+        uint32_t header[4]={1,0x01020304,uint32_t(sizeof(infectionEvent)),0};
+        fwrite("MOPEVENT",1,8,_file);
+        fwrite(header,4,4,_file);
+        _stop=false;
+        _writer=std::thread(&eventLog::run,this);
+    }
+    /** @brief record one infection - call only from thread t, no locking is needed
+        @param t the thread number (from omp_get_thread_num())
+        @param step the current step
+        @param agentID the agent infected
+        @param placeID the place where it happened
+        @param placeType the type of that place */
+    void record(int t,long step,uint64_t agentID,uint64_t placeID,int placeType){
+        chunk& c=_current[t].events;
+        c.push_back({step,agentID,placeID,placeType,0});
+        if (c.size()>=_chunkEvents)handOver(t,false);
+    }
+    /** @brief write out all events so far, including part-filled chunks, and wait until done - call from outside any parallel region
+        @details nothing is dropped here, even with the drop policy - the chunks are handed over one at a time, waiting for the writer to free one if need be */
+    void flush(){
+        if (_file==nullptr)return;
+        for (unsigned t=0;t<_current.size();t++)handOver(t,true);
+        std::unique_lock<std::mutex> guard(_lock);
+        _done.wait(guard,[this]{return _queue.empty() && !_busy;});
+        fflush(_file);
+    }
+    /** @brief write everything out, stop the background thread and close the file */
+    void close(){
+        if (_file==nullptr)return;
+        flush();
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop=true;
+        }
+        _work.notify_one();
+        _writer.join();
+        fclose(_file);
+        _file=nullptr;
+    }
+    /** @brief the memory held for events, in bytes - this is the memory budget set aside in \ref open */
+    size_t memoryUsed(){
+        std::lock_guard<std::mutex> guard(_lock);
+        size_t events=0;
+        for (auto& c:_current)events+=c.events.capacity();
+        for (auto& c:_queue)events+=c.capacity();
+        for (auto& c:_free)events+=c.capacity();
+        return events*sizeof(infectionEvent);
+    }
+    /** @brief check whether the log is open */
+    bool is_open(){
+        return _file!=nullptr;
+    }
+    /** @brief the number of events written so far */
+    uint64_t written(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return _written;
+    }
+    /** @brief the number of events lost because the memory budget ran out */
+    uint64_t dropped(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return _dropped;
+    }
+    /** @brief the total time threads have spent waiting for memory, in seconds */
+    double blockedSeconds(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return std::chrono::duration<double>(_blockedTime).count();
+    }
+};
+#endif // EVENTLOG_H_INCLUDED
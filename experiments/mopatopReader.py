@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+##@file mopatopReader.py
+#@brief Read the binary time series output (.mts files) of the model into numpy arrays.
+#@details The model writes a binary version of its summary output if outputFormat
+#is set to binary or both in the parameter file (see seriesWriter.h for the format).
+#The file has a header describing the columns, followed by blocks of rows stored
+#column by column as 8 byte values - so each block can be turned straight into
+#numpy arrays without any parsing. For example:-
+#
+#    import mopatopReader as mr
+#    s=mr.readSeries('output/default/run_0000/diseaseSummary.mts')
+#    print(s['infected'].max())
+#    runs=mr.readRuns('experiments/myExperiment/runs')
+#    meanInfected=runs['infected'].mean(axis=0)
+#
+#@author: Mike Bithell
+#Created on Sun Oct 18 2026
+
+import numpy as np
+import struct
+import glob
+import os
+
+##the file type identifier at the start of every file
+magic=b'MOPSERIE'
+##numpy types for each column type code
+types={b'i':np.int64,b'd':np.float64}
+
+def readHeader(data):
+    '''
+    read the header from the start of a file (as a numpy byte array)
+    returns the list of column names, their numpy types, and the header size in bytes
+    '''
+    if bytes(data[:8])!=magic:
+        raise ValueError('not a mopatop series file')
+    version,byteOrder,nColumns,headerSize=struct.unpack_from('<4I',data,8)
+    if byteOrder!=0x01020304:
+        raise ValueError('series file was written with a different byte order')
+    if version!=1:
+        raise ValueError('unknown series file version '+str(version))
+    names=[]
+    dtypes=[]
+    for c in range(nColumns):
+        description=bytes(data[24+40*c:24+40*(c+1)])
+        names.append(description[:32].rstrip(b'\0').decode())
+        dtypes.append(types[description[32:33]])
+    return names,dtypes,headerSize
+
+def readSeries(fileName):
+    '''
+    read a whole series file - returns a dictionary of numpy arrays, one per column, keyed by column name
+    the file is memory mapped, so only the blocks are copied (into one array per column)
+    '''
+    data=np.memmap(fileName,dtype=np.uint8,mode='r')
+    names,dtypes,position=readHeader(data)
+    blocks=[[] for n in names]
+    while position<len(data):
+        nRows=int(np.frombuffer(data,dtype=np.uint64,count=1,offset=position)[0])
+        position+=8
+        for c in range(len(names)):
+            blocks[c].append(np.frombuffer(data,dtype=dtypes[c],count=nRows,offset=position))
+            position+=8*nRows
+    return {names[c]:np.concatenate(blocks[c]) if blocks[c] else np.zeros(0,dtypes[c]) for c in range(len(names))}
+
+def readRuns(directory,fileName='diseaseSummary.mts'):
+    '''
+    read the series file from every run_nnnn sub-directory of directory (as created by the model for an experiment)
+    returns a dictionary of 2D numpy arrays, one per column, with one row per run - runs that are shorter than
+    the longest one are padded at the end with their last value. The run directory names are included as 'runs'.
+    Runs whose series has no rows yet (e.g. stopped before the first block was written) are skipped, as they have
+    no last value to pad with - their directory names are listed as 'emptyRuns'.
+    '''
+    files=sorted(glob.glob(os.path.join(directory,'run_*',fileName)))
+    series=[]
+    result={'runs':[],'emptyRuns':[]}
+    for f in files:
+        s=readSeries(f)
+        run=os.path.basename(os.path.dirname(f))
+        if len(s['step'])==0:
+            result['emptyRuns'].append(run)
+            continue
+        series.append(s)
+        result['runs'].append(run)
+    if not series:
+        return result
+    length=max(len(s['step']) for s in series)
+    for name in series[0]:
+        result[name]=np.stack([np.pad(s[name],(0,length-len(s[name])),mode='edge') for s in series])
+    return result
+
+def readSnapshots(fileName):
+    '''
+    read a place snapshot file (see snapshotWriter.h) - returns a dictionary with 'step' (one value per snapshot),
+    'placeID' (one per place) and 'contamination' (a 2D array, one row per snapshot and one column per place),
+    plus 'occupancy' if the snapshots include it
+    '''
+    data=np.memmap(fileName,dtype=np.uint64,mode='r')
+    if bytes(np.asarray(data[:1]).tobytes())!=b'MOPSNAPS':
+        raise ValueError('not a mopatop snapshot file')
+    version,byteOrder,nPlaces,nColumns=(int(v) for v in data[1:5])
+    if byteOrder!=0x01020304:
+        raise ValueError('snapshot file was written with a different byte order')
+    placeIDs=np.array(data[5:5+nPlaces])
+    position=5+nPlaces
+    steps=[]
+    columns=[[] for c in range(nColumns)]
+    previous=[np.zeros(nPlaces,np.uint64) for c in range(nColumns)]
+    while position<len(data):
+        steps.append(int(data[position]))
+        position+=1
+        for c in range(nColumns):
+            m=int(data[position])
+            words=data[position+1:position+1+m]
+            position+=1+m
+            #undo the run length encoding - each token gives a run of unchanged values then a run of changed ones
+            values=previous[c].copy()
+            i=0
+            k=0
+            while k<m:
+                zeros=int(words[k])>>32
+                literals=int(words[k])&0xffffffff
+                i+=zeros
+                values[i:i+literals]^=words[k+1:k+1+literals]
+                i+=literals
+                k+=1+literals
+            previous[c]=values
+            columns[c].append(values)
+    result={'step':np.array(steps),'placeID':placeIDs}
+    result['contamination']=np.array(columns[0]).view(np.float64).reshape(len(steps),nPlaces)
+    if nColumns>1:
+        result['occupancy']=np.array(columns[1]).astype(np.int64).reshape(len(steps),nPlaces)
+    return result
+
+##numpy layout of one infection event (see eventLog.h)
+eventType=np.dtype([('step',np.int64),('agentID',np.uint64),('placeID',np.uint64),('placeType',np.int32),('spare',np.int32)])
+
+def readEvents(fileName,sort=True):
+    '''
+    read an infection event log (see eventLog.h) - returns a numpy structured array with fields step, agentID, placeID
+    and placeType (0 home, 1 work, 2 vehicle). Events are written by several threads, so by default they are sorted into step order
+    '''
+    header=np.fromfile(fileName,dtype=np.uint8,count=24)
+    if bytes(header[:8])!=b'MOPEVENT':
+        raise ValueError('not a mopatop event file')
+    version,byteOrder,size,spare=struct.unpack_from('<4I',header,8)
+    if byteOrder!=0x01020304:
+        raise ValueError('event file was written with a different byte order')
+    if size!=eventType.itemsize:
+        raise ValueError('unexpected event size '+str(size))
+    events=np.array(np.memmap(fileName,dtype=eventType,mode='r',offset=24))
+    if sort:
+        events=events[np.argsort(events['step'],kind='stable')]
+    return events
+
+if __name__=='__main__':
+    import sys
+    for f in sys.argv[1:]:
+        s=readSeries(f)
+        print(f)
+        print(','.join(s.keys()))
+        for row in zip(*s.values()):
+            print(','.join(str(v) for v in row))
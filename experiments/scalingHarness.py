@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+##@file scalingHarness.py
+#@brief Run the model over a sweep of thread counts and population sizes, and tabulate how well each phase of the step scales.
+#@details Strong scaling keeps the number of agents fixed as the threads increase - ideally the time
+#falls in proportion, so the efficiency T(1)/(p*T(p)) stays at 1. Weak scaling increases the agents in
+#proportion to the threads - ideally the time stays the same, so the efficiency T(1)/T(p) stays at 1.
+#For each combination a parameter file is written (starting from a base file, with run.nThreads, run.nAgents
+#and run.nSteps changed), the model is run with the profiler switched on, and the per-phase times are read back
+#from profileSummary.json (see profiler.h). The results for every run and phase are saved to scaling.csv,
+#and an efficiency table is printed for each mode and size, with each phase's thread imbalance, so that phases
+#that stop scaling (e.g. contamination updates by many agents in the same place, or the single-threaded output)
+#stand out. Threads can optionally be pinned to cores using the standard OpenMP environment variables.
+#For example, from the experiments directory:-
+#
+#    python3 scalingHarness.py --threads 1,2,4,8 --sizes 1e5,1e6 --steps 48 --pin
+#
+#The model runs in the experiments directory, so the relative paths in the default parameter file
+#(e.g. ../censusSizeTable) still work. Output goes to experiments/scaling unless --output is given.
+#@author: Mike Bithell
+#Created on Sun Oct 18 2026
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import csv
+
+##directory from which to find the model executable and default parameter file
+root=os.path.abspath(os.path.join(os.path.dirname(os.path.abspath(__file__)),'..'))
+
+def readParameters(fileName):
+    '''
+    read a parameter file into a list of lines, so that values can be changed while keeping comments and order
+    '''
+    with open(fileName,'r') as reader:
+        return reader.readlines()
+
+def change(parameters,name,value):
+    '''
+    set a parameter in the list of lines, adding it at the end if the base file does not have it
+    '''
+    for i,line in enumerate(parameters):
+        if line.split('=')[0].strip()==name:
+            parameters[i]=name+'='+str(value)+'\n'
+            return
+    parameters.append(name+'='+str(value)+'\n')
+
+def runModel(args,baseParameters,mode,size,threads):
+    '''
+    run the model once, returning the profile summary as a dictionary of phases (or None if the run failed)
+    '''
+    nAgents=size if mode=='strong' else size*threads
+    name=mode+'_'+str(size)+'_t'+str(threads)
+    parameters=list(baseParameters)
+    change(parameters,'run.nThreads',threads)
+    change(parameters,'run.nAgents',nAgents)
+    change(parameters,'run.nSteps',args.steps)
+    change(parameters,'run.nRepeats',1)
+    change(parameters,'run.branchStep',-1)
+    change(parameters,'experiment.output.directory',args.output)
+    change(parameters,'experiment.name',name)
+    change(parameters,'experiment.run.number','0000')
+    change(parameters,'profile.enabled','true')
+    change(parameters,'profile.counters','true' if args.counters else 'false')
+    change(parameters,'memory.report','false')
+    change(parameters,'trace.enabled','false')
+    #keep the number infected in proportion to the population, so each run does the same work per agent
+    if args.infectedFraction>0:
+        change(parameters,'disease.simplistic.initialNumberInfected',max(1,int(nAgents*args.infectedFraction)))
+    runDirectory=os.path.join(args.output,name,'run_0000')
+    os.makedirs(os.path.join(args.output,name),exist_ok=True)
+    parameterFile=os.path.join(args.output,name,'parameterFile')
+    with open(parameterFile,'w') as writer:
+        writer.writelines(parameters)
+    environment=dict(os.environ)
+    environment['OMP_NUM_THREADS']=str(threads)
+    if args.pin:
+        environment['OMP_PROC_BIND']=args.bind
+        environment['OMP_PLACES']=args.places
+    print('Running '+name+' ('+str(nAgents)+' agents, '+str(threads)+' threads)',flush=True)
+    with open(os.path.join(args.output,name,'RunFile'),'w') as log:
+        result=subprocess.run([args.executable,parameterFile],cwd=args.workdir,env=environment,stdout=log,stderr=subprocess.STDOUT)
+    summary=os.path.join(runDirectory,'profileSummary.json')
+    if result.returncode!=0 or not os.path.exists(summary):
+        print('  run failed - see '+os.path.join(args.output,name,'RunFile'))
+        return None
+    with open(summary,'r') as f:
+        profile=json.load(f)
+    phases={p['name']:p for p in profile['phases']}
+    #the whole step, for comparison with the phases
+    phases['step']={'name':'step','total_ns':sum(p['total_ns'] for p in profile['phases'])}
+    return phases
+
+def efficiency(mode,threads,t1,tp):
+    '''
+    parallel efficiency - 1 is perfect scaling
+    '''
+    if tp<=0 or t1<=0:
+        return 0
+    if mode=='strong':
+        return t1/(threads*tp)
+    return t1/tp
+
+def main():
+    parser=argparse.ArgumentParser(description='Strong and weak thread scaling of each phase of the model step')
+    parser.add_argument('--threads',default='1,2,4,8',help='comma separated thread counts - the first is the reference')
+    parser.add_argument('--sizes',default='1e5,1e6',help='comma separated numbers of agents (per thread for weak scaling)')
+    parser.add_argument('--modes',default='strong,weak',help='strong, weak or both')
+    parser.add_argument('--steps',type=int,default=48,help='time steps per run')
+    parser.add_argument('--parameters',default=os.path.join(root,'defaultParameterFile'),help='base parameter file')
+    parser.add_argument('--executable',default=os.path.join(root,'agentModel'),help='the model executable')
+    parser.add_argument('--output',default=os.path.join(root,'experiments','scaling'),help='directory for runs and tables')
+    parser.add_argument('--workdir',default=os.path.join(root,'experiments'),help='directory the model runs in')
+    parser.add_argument('--infectedFraction',type=float,default=0.01,help='initial fraction infected (0 keeps the base file value)')
+    parser.add_argument('--pin',action='store_true',help='pin threads using OMP_PROC_BIND and OMP_PLACES')
+    parser.add_argument('--bind',default='close',help='OMP_PROC_BIND value used with --pin (close or spread)')
+    parser.add_argument('--places',default='cores',help='OMP_PLACES value used with --pin (cores, threads or sockets)')
+    parser.add_argument('--counters',action='store_true',help='also collect hardware counters (profile.counters)')
+    parser.add_argument('--threshold',type=float,default=0.5,help='efficiency below which a phase is reported as no longer scaling')
+    args=parser.parse_args()
+    args.output=os.path.abspath(args.output)
+    args.executable=os.path.abspath(args.executable)
+
+    threadCounts=[int(t) for t in args.threads.split(',')]
+    sizes=[int(float(s)) for s in args.sizes.split(',')]
+    modes=[m.strip() for m in args.modes.split(',')]
+    for m in modes:
+        if m not in ('strong','weak'):
+            sys.exit('Unknown scaling mode '+m+' - should be strong or weak')
+    if not os.path.exists(args.executable):
+        sys.exit('Model executable '+args.executable+' not found - build it with make first')
+    baseParameters=readParameters(args.parameters)
+    os.makedirs(args.output,exist_ok=True)
+
+    rows=[]
+    for mode in modes:
+        for size in sizes:
+            results={t:runModel(args,baseParameters,mode,size,t) for t in threadCounts}
+            reference=results[threadCounts[0]]
+            if reference is None:
+                print('Reference run failed for '+mode+' scaling with '+str(size)+' agents - skipping')
+                continue
+            phases=[p for p in reference]
+            #table of efficiencies, one row per thread count and one column per phase
+            print('\n'+mode.capitalize()+' scaling, '+str(size)+' agents'+(' per thread' if mode=='weak' else '')
+                  +' - efficiency relative to '+str(threadCounts[0])+' thread(s) (imbalance in brackets)')
+            print('threads'.ljust(8)+''.join(p.rjust(16) for p in phases))
+            flattens={}
+            for t in threadCounts:
+                if results[t] is None:
+                    continue
+                line=str(t).ljust(8)
+                for p in phases:
+                    t1=reference[p]['total_ns']*threadCounts[0] if mode=='strong' else reference[p]['total_ns']
+                    tp=results[t][p]['total_ns']
+                    e=efficiency(mode,t,t1,tp)
+                    imbalance=results[t][p].get('mean_imbalance')
+                    line+=(('%.2f (%.2f)'%(e,imbalance)) if imbalance is not None else '%.2f'%e).rjust(16)
+                    if e<args.threshold and p not in flattens:
+                        flattens[p]=t
+                    rows.append({'mode':mode,'size':size,'threads':t,'agents':size if mode=='strong' else size*t,'phase':p,
+                                 'total_s':tp*1e-9,'speedup':(reference[p]['total_ns']/tp if tp>0 else 0),
+                                 'efficiency':e,'imbalance':imbalance})
+                print(line)
+            for p,t in flattens.items():
+                print('  '+p+' stops scaling at '+str(t)+' threads (efficiency below '+str(args.threshold)+')')
+
+    tableFile=os.path.join(args.output,'scaling.csv')
+    with open(tableFile,'w',newline='') as f:
+        writer=csv.DictWriter(f,fieldnames=['mode','size','threads','agents','phase','total_s','speedup','efficiency','imbalance'])
+        writer.writeheader()
+        writer.writerows(rows)
+    print('\nScaling table saved to '+tableFile)
+
+if __name__=='__main__':
+    main()
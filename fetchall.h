@@ -58,8 +58,65 @@
 #include "../mui/mui.h"
 #include "mui_config.h"
 #include <omp.h>
-/** @brief This class defines an interface for two copies of the model running on different MPI threads
-    @details On each MPI thread (currently just two allowed) define an interface for exchange of data between the threads \n
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include "traceRecorder.h"
+#include "domainBalancer.h"
+//------------------------------------------------------------------------
+/** @brief One travelling agent, as sent between domains by the packed protocol - see \ref MUIcoupler::exchangePacked
+    @details 10 bytes per agent, where the MUI protocol sends six doubles, each with its own one-double location (96 bytes).\n
+    Schedules are not sent: a new traveller's schedule is set up on arrival by \ref agent::outwardTravel, and a returning agent's by\n
+    \ref agent::inwardTravel, using places on the receiving domain.*/
+#pragma pack(push,1)
+struct migrant{
+    /** @brief the agent ID - only meaningful on the agent's home domain */
+    uint64_t id;
+    /** @brief 0 for a local agent setting off, 2 for a traveller going home - as in the MUI protocol */
+    uint8_t travelType;
+    /** @brief alive, diseased, immune and recovered, one bit each */
+    uint8_t state;
+    /** @brief fill in from an agent
+        @param type the travel type
+        @param a the agent */
+    void pack(int type,agent* a){
+        id=a->getID();
+        travelType=type;
+        state=(a->alive()?1:0)|(a->diseased()?2:0)|(a->immune()?4:0)|(a->recovered()?8:0);
+    }
+    /** @brief copy the state into an agent - the ID and travel type are dealt with by the caller */
+    void unpack(agent* a){
+        a->setAlive(state&1);
+        a->setDiseased(state&2);
+        a->setImmune(state&4);
+        a->setRecovered(state&8);
+    }
+};
+/** @brief One agent moving to another domain for good, when the domains are rebalanced - see \ref MUIcoupler::rebalance
+    @details the \ref migrant record (with travel type 1, and the agent's own ID, which it keeps), plus the agent's places and where it is in its\n
+    schedule. Places are sent as their position in the list of places, so every domain must have the same places in the same order (as with a\n
+    columnar population split between the domains).*/
+struct settler{
+    /** @brief the agent's state */
+    migrant agent;
+    /** @brief the position of the home, work and vehicle in the list of places */
+    uint32_t places[3];
+    /** @brief where the agent is now - see \ref agent::placeTypes */
+    uint8_t currentPlace;
+    /** @brief the agent's schedule type, and the one it goes back to after travelling */
+    uint8_t scheduleType,originalScheduleType;
+    /** @brief the step the agent is at in its schedule */
+    uint32_t schedulePoint;
+    /** @brief the time left at the current place */
+    double scheduleTimer;
+};
+#pragma pack(pop)
+/** @brief This class defines an interface for copies of the model running on different MPI threads
+    @details With the packed protocol any number of domains can be coupled, one MPI rank each, and agents are only sent to the domain\n
+             they are going to (see \ref exchangePacked). The MUI protocol described below is limited to two domains.\n
+             On each MPI thread define an interface for exchange of data between the threads \n
              In each time step, the list of agents is checked to see whether data should be transferred between threads\n
              The format for the interface is mpi://domainIdentifier/interfaceIdentifier - so if I am on domain one, I can push data to \n
              an interface called e.g. ifs - so my complete interface name is mpi://one/ifs. Domain two can find data pushed to this \n
@@ -74,29 +131,535 @@
 class MUIcoupler {
     /** @brief the interface for exchanging data, using the configuration in config.h */
     mui::uniface<mui::mui_config>* interface;
-    /** @brief a second interface, used to check whether there is any significant data to exchange
-        @details It seems if you do a commit on any interface at any particular time, any further commits are ignored\n
-         so this second interface is needed to exchange a flag between domains, so that they can check whether the other domain\n
-         has information to send. This avoids doing expensive loops over all agents if there is no data to send on either side \n
-         (since domain a cannot know if domain b has data to send until some data has been sent (!) and vice versa)*/
-    mui::uniface<mui::mui_config>*flagInterface;
+    /** @brief the number of steps between a domain announcing it has leavers and the exchange that sends them - see \ref exchangeDue
+        @details domains only have to wait for each other once every this many steps, so can run up to this many steps apart */
+    int lag=0;
+    /** @brief the leaver flag reductions still in progress, one per step of the lag */
+    std::vector<MPI_Request> reductions;
+    /** @brief this domain's leaver flag for each reduction in progress */
+    std::vector<int> leaving;
+    /** @brief the number of domains with leavers, for each reduction in progress */
+    std::vector<int> domainsLeaving;
     /** @brief the name of this domain - unique to each mpi thread */
     std::string domain;
     /** @brief set to true to print out (lots of) diagnostic info - only really for debug/test purposes */
     bool verbose;
+    /** @brief the largest memory used by the exchange buffers in any step, in bytes (not including MUI's own storage) */
+    size_t peakBufferBytes=0;
+    /** @brief true if agents are sent as packed \ref migrant records in one MPI message, rather than one MUI push per value */
+    bool packed=false;
+    /** @brief a copy of MPI_COMM_WORLD for the packed messages, so they cannot be confused with MUI's own */
+    MPI_Comm packedComm=MPI_COMM_NULL;
+    /** @brief the message tag for packed exchanges - messages between two ranks arrive in the order sent, so one tag is enough */
+    static const int packedTag=1;
+    /** @brief the names of all the domains, in rank order - one rank per domain */
+    std::vector<std::string> domainNames;
+    /** @brief the rank of this domain in packedComm */
+    int rank=0;
+    /** @brief the rank of the other domain when there are just two, otherwise -1 - agents with no destination set go here */
+    int peer=-1;
+    /** @brief the leaving agents packed for sending, one buffer per destination rank, kept between steps to avoid re-allocating */
+    std::vector<std::vector<migrant>> outboxes;
+    /** @brief the arriving agents, one buffer per source rank, kept between steps to avoid re-allocating */
+    std::vector<std::vector<migrant>> inboxes;
+    /** @brief the number of agents going to each rank, and coming from each rank, in this exchange */
+    std::vector<int> sendCounts,receiveCounts;
+    /** @brief the sends and receives in progress - only for ranks that have agents to exchange */
+    std::vector<MPI_Request> requests;
+    /** @brief decides how many agents go between domains when rebalancing */
+    domainBalancer balancer;
+    /** @brief the number of steps between rebalances, or 0 for none */
+    int rebalanceInterval=0;
+    /** @brief the agents moving for good to each rank, and arriving from each, in a rebalance */
+    std::vector<std::vector<settler>> settlersOut,settlersIn;
+    /** @brief the thread support MPI was started with - sharing places needs at least MPI_THREAD_FUNNELED */
+    int threadLevel=MPI_THREAD_SINGLE;
+    /** @brief true if the domains split one population between them, so that places are shared - see \ref setupSharedPlaces */
+    bool placesShared=false;
+    /** @brief the position of each place in the list of places - the same on every domain when places are shared */
+    std::unordered_map<place*,uint32_t> placePosition;
+    /** @brief the places used by local agents of more than one domain - in the same order on every domain */
+    std::vector<place*> sharedPlaces;
+    /** @brief the contamination of each shared place before the agents cough, and the change in it, summed over the domains */
+    std::vector<double> sharedBefore,sharedChange;
+    /** @brief a checksum of the place IDs, in order - the same on every domain that has the same list of places
+        @param places the list of places */
+    static uint64_t placeChecksum(std::vector<place*>& places){
+        uint64_t h=places.size();
+        for (auto p:places){
+            //splitmix64 finaliser of the running value and the next ID, so the order matters as well as the IDs
+            h=(h^uint64_t(p->getID()))+0x9e3779b97f4a7c15ULL;
+            h^=h>>30;h*=0xbf58476d1ce4e5b9ULL;
+            h^=h>>27;h*=0x94d049bb133111ebULL;
+            h^=h>>31;
+        }
+        return h;
+    }
+    /** @brief check that every domain has the same places, with the same IDs in the same order - call on every domain
+        @param places the list of places
+        @return true if the place checksums agree on every domain */
+    bool samePlaces(std::vector<place*>& places){
+        uint64_t h=placeChecksum(places);
+        //the largest checksum, and the complement of the smallest
+        uint64_t extremes[2]={h,~h};
+        MPI_Allreduce(MPI_IN_PLACE,extremes,2,MPI_UINT64_T,MPI_MAX,packedComm);
+        return extremes[0]==~extremes[1];
+    }
+    /** @brief flag the places (home, work and vehicle) used by the local agents, by position in the list of places
+        @param locals the local agents */
+    std::vector<int> placesUsed(std::vector<agent*>& locals){
+        std::vector<int> used(placePosition.size(),0);
+        for (auto a:locals){
+            for (int p=0;p<3;p++){
+                auto it=placePosition.find(a->places[p]);
+                if (it!=placePosition.end())used[it->second]=1;
+            }
+        }
+        return used;
+    }
+    /** @brief find the places used by local agents of more than one domain - call on every domain
+        @param locals the local agents
+        @param places the list of places */
+    void findSharedPlaces(std::vector<agent*>& locals,std::vector<place*>& places){
+        std::vector<int> users=placesUsed(locals);
+        MPI_Allreduce(MPI_IN_PLACE,users.data(),users.size(),MPI_INT,MPI_SUM,packedComm);
+        sharedPlaces.clear();
+        for (unsigned long p=0;p<places.size();p++)if (users[p]>1)sharedPlaces.push_back(places[p]);
+        sharedBefore.assign(sharedPlaces.size(),0.);
+        sharedChange.assign(sharedPlaces.size(),0.);
+    }
+    /** @brief give every copy of each place used by local agents the contamination it has on the lowest rank using it - call on every domain
+        @details used before agents move in a rebalance - a home moving to a new domain may until now only have been used, and so kept up to\n
+        date, on the old one. Places used on more than one domain already agree (see \ref shareContamination).
+        @param locals the local agents
+        @param places the list of places */
+    void syncPlaces(std::vector<agent*>& locals,std::vector<place*>& places){
+        int size=domainNames.size();
+        std::vector<int> owner=placesUsed(locals);
+        for (auto& o:owner)o=o?rank:size;
+        MPI_Allreduce(MPI_IN_PLACE,owner.data(),owner.size(),MPI_INT,MPI_MIN,packedComm);
+        std::vector<double> level(places.size(),0.);
+        for (unsigned long p=0;p<places.size();p++)if (owner[p]==rank)level[p]=places[p]->getContaminationLevel();
+        MPI_Allreduce(MPI_IN_PLACE,level.data(),level.size(),MPI_DOUBLE,MPI_SUM,packedComm);
+        for (unsigned long p=0;p<places.size();p++)if (owner[p]<size)places[p]->setContaminationLevel(level[p]);
+    }
+    /** @brief send each rank its buffer, and receive one from each rank - only ranks with something to send are sent a message
+        @details each rank first tells every other how many records it has for it (MPI_Alltoall), then the records go with non-blocking\n
+        point to point messages, so each rank only talks to the ranks it actually has agents to swap with
+        @param out one buffer of records for each rank
+        @param in set to the records arriving from each rank */
+    template<class record> void swapWithNeighbours(std::vector<std::vector<record>>& out,std::vector<std::vector<record>>& in){
+        int size=domainNames.size();
+        for (int r=0;r<size;r++)sendCounts[r]=out[r].size();
+        MPI_Alltoall(sendCounts.data(),1,MPI_INT,receiveCounts.data(),1,MPI_INT,packedComm);
+        requests.clear();
+        for (int r=0;r<size;r++){
+            in[r].resize(receiveCounts[r]);
+            if (receiveCounts[r]==0)continue;
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Irecv(in[r].data(),receiveCounts[r]*sizeof(record),MPI_BYTE,r,packedTag,packedComm,&requests.back());
+        }
+        for (int r=0;r<size;r++){
+            if (sendCounts[r]==0)continue;
+            requests.push_back(MPI_REQUEST_NULL);
+            MPI_Isend(out[r].data(),sendCounts[r]*sizeof(record),MPI_BYTE,r,packedTag,packedComm,&requests.back());
+        }
+        MPI_Waitall(requests.size(),requests.data(),MPI_STATUSES_IGNORE);
+    }
+    /** @brief the local agents away on another domain - their position in the list of locals, by ID
+        @details added to when a local leaves, and removed from when it comes home, so returning agents are found without searching the locals */
+    std::unordered_map<unsigned long,unsigned long> away;
+    /** @brief the positions of inactive travellers, that can be re-used for new arrivals - added to when a traveller goes home */
+    std::vector<unsigned long> freeTravellers;
+    /** @brief a local agent sets off for the other domain
+        @param locals the local agents
+        @param i the position of the agent in locals */
+    void depart(std::vector<agent*>& locals,unsigned long i){
+        //local copy on this domain pauses
+        locals[i]->deactivate();
+        //once the agent has crossed to the other side, it shouldn't try again! - until its schedule says so in the main model
+        locals[i]->doNotLeaveDomain();
+        away[locals[i]->getID()]=i;
+    }
+    /** @brief a traveller goes back to its own domain - its slot can then be re-used
+        @param travellers the travellers on this domain
+        @param i the position of the traveller */
+    void sendHome(std::vector<agent*>& travellers,unsigned long i){
+        travellers[i]->deactivate();
+        //it shouldn't try to leave again - unless it gets re-used to represent another agent from the remote domain
+        travellers[i]->doNotLeaveDomain();
+        freeTravellers.push_back(i);
+    }
+    /** @brief find a traveller to hold an agent arriving from the other domain - a free slot if there is one, otherwise a new agent
+        @param travellers the travellers on this domain */
+    agent* arrival(std::vector<agent*>& travellers){
+        if (!freeTravellers.empty()){
+            agent* a=travellers[freeTravellers.back()];
+            freeTravellers.pop_back();
+            return a;
+        }
+        agent* a=new agent();
+        travellers.push_back(a);
+        return a;
+    }
+    /** @brief find a local agent coming back from the other domain, and remove it from \ref away
+        @param locals the local agents
+        @param ID the agent ID
+        @return the agent */
+    agent* homecoming(std::vector<agent*>& locals,unsigned long ID){
+        auto it=away.find(ID);
+        if (it==away.end()){
+            std::cout<<"Domain "<<domain<<": agent "<<ID<<" came home, but was not known to be away"<<std::endl;
+            exit(1);
+        }
+        agent* a=locals[it->second];
+        assert(a->getID()==ID);
+        away.erase(it);
+        return a;
+    }
+    /** @brief memory used by \ref away and \ref freeTravellers, in bytes - hash nodes are about 32 bytes plus the key and value */
+    size_t indexBytes(){
+        return away.bucket_count()*sizeof(void*)+away.size()*(32+2*sizeof(unsigned long))+freeTravellers.capacity()*sizeof(unsigned long);
+    }
+    /** @brief start MPI, unless it is already running, asking for MPI_THREAD_FUNNELED - see \ref shareContamination
+        @details called before the MUI interface is made, as MUI would otherwise start MPI with MPI_Init, which only promises\n
+        MPI_THREAD_SINGLE. If MPI was started by the caller, the thread level it was given is looked up instead. */
+    void startMPI(){
+        int started=0;
+        MPI_Initialized(&started);
+        if (!started){
+            MPI_Init_thread(nullptr,nullptr,MPI_THREAD_FUNNELED,&threadLevel);
+            std::atexit([]{int finished=0;MPI_Finalized(&finished);if (!finished)MPI_Finalize();});
+        }else{
+            MPI_Query_thread(&threadLevel);
+        }
+    }
+    /** @brief find the other domains to send packed messages to
+        @details every rank sends its domain name to all the others, so that each knows which rank runs which domain. The packed\n
+        protocol needs one rank per domain, so the names must all differ - otherwise the MUI protocol is used.
+        @return true if every rank has its own domain */
+    bool findDomains(){
+        int size=0;
+        MPI_Comm_size(MPI_COMM_WORLD,&size);
+        MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+        const int nameLength=64;
+        std::vector<char> names(size*nameLength,0);
+        std::vector<char> mine(nameLength,0);
+        std::strncpy(mine.data(),domain.c_str(),nameLength-1);
+        MPI_Allgather(mine.data(),nameLength,MPI_CHAR,names.data(),nameLength,MPI_CHAR,MPI_COMM_WORLD);
+        MPI_Comm_dup(MPI_COMM_WORLD,&packedComm);
+        domainNames.clear();
+        for (int r=0;r<size;r++)domainNames.push_back(std::string(names.data()+r*nameLength));
+        outboxes.assign(size,std::vector<migrant>());
+        inboxes.assign(size,std::vector<migrant>());
+        sendCounts.assign(size,0);
+        receiveCounts.assign(size,0);
+        if (size==2)peer=1-rank;
+        std::vector<std::string> sorted=domainNames;
+        std::sort(sorted.begin(),sorted.end());
+        return size>1 && std::adjacent_find(sorted.begin(),sorted.end())==sorted.end();
+    }
+    /** @brief the rank to send a leaving agent to - its destination, or the other domain if there are only two
+        @param a the agent */
+    int destinationOf(agent* a){
+        int d=a->destination();
+        if (d<0)d=peer;
+        if (d<0 || d>=int(domainNames.size()) || d==rank){
+            std::cout<<"Domain "<<domain<<": agent "<<a->getID()<<" is leaving, but has no other domain to go to (destination "<<a->destination()<<")"<<std::endl;
+            exit(1);
+        }
+        return d;
+    }
 public:
     /** @brief default constructor - not used in practice */
     MUIcoupler(){verbose=false;};
-    /** @brief constructor - sets up the interface connecting the two MPI domains (threads)
+    /** @brief constructor - sets up the interface connecting this MPI domain (thread) to the others
      * @param ident a string used to define the domain
+     * @param protocol "packed" to send agents as packed records in one MPI message per step, or "mui" to push each value through MUI
+     * @param exchangeLag the number of steps between a domain announcing leavers and the exchange - see \ref exchangeDue
      * @param verby set to true for verbose output - defaults to false if not presentfrom caller */
-    MUIcoupler(std::string ident,bool verby=false):domain(ident),verbose(verby){
+    MUIcoupler(std::string ident,std::string protocol="packed",int exchangeLag=0,bool verby=false):domain(ident),verbose(verby){
+        //MPI has to be running, with the thread support needed, before MUI gets the chance to start it
+        startMPI();
         //ident is the subdomain of mpi - needs to be unique for every instance of the code
         std::string iface="mpi://cough"+ident+"/iface";
-        std::string eface="mpi://cough"+ident+"/flagInterface";
         //create the interface for transfer of data between 2 domains
         interface=new mui::uniface<mui::mui_config> ( iface.c_str() );
-        flagInterface=new mui::uniface<mui::mui_config> ( eface.c_str() );
+        if (protocol!="packed" && protocol!="mui"){
+            std::cout<<"Unknown coupler.protocol "<<protocol<<" - should be packed or mui"<<std::endl;
+            exit(1);
+        }
+        //Every rank has to take part in finding the domains, whatever the protocol
+        bool found=findDomains();
+        //all domains must use the same protocol - packed only if every domain asks for it
+        int want=(protocol=="packed");
+        MPI_Allreduce(MPI_IN_PLACE,&want,1,MPI_INT,MPI_MIN,packedComm);
+        packed=(want==1 && found);
+        if (want==1 && !found)std::cout<<"Domain "<<domain<<": packed agent exchange needs at least two domains of one rank each - using MUI instead"<<std::endl;
+        if (!packed && domainNames.size()>2){
+            std::cout<<"Domain "<<domain<<": the MUI agent exchange only works with two domains - use coupler.protocol=packed, with one rank per domain"<<std::endl;
+            exit(1);
+        }
+        if (want==0 && protocol=="packed")std::cout<<"Domain "<<domain<<": the other domain uses coupler.protocol=mui, so this one does too"<<std::endl;
+        //the lag must also agree, or the domains would exchange on different steps - use the largest asked for
+        lag=std::max(exchangeLag,0);
+        MPI_Allreduce(MPI_IN_PLACE,&lag,1,MPI_INT,MPI_MAX,packedComm);
+        if (lag!=exchangeLag)std::cout<<"Domain "<<domain<<": using coupler.exchangeLag="<<lag<<" to match the other domains"<<std::endl;
+        reductions.assign(lag+1,MPI_REQUEST_NULL);
+        leaving.assign(lag+1,0);
+        domainsLeaving.assign(lag+1,0);
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief decide whether agents need to be exchanged this step, without making the domains wait for each other on quiet steps
+        @details Every step each domain starts a non-blocking sum (MPI_Iallreduce) of its leaver flag over all domains, and then waits for\n
+        the sum started \ref lag steps earlier. If any domain had leavers then, every domain exchanges agents in this step - all of them\n
+        reach the same answer at the same step, so they stay in step with each other. Agents that decide to leave wait (still flagged as\n
+        leavers, and still here) until the exchange.\n
+        With a lag of zero the sum is waited for at once, so agents leave on the next step, as before, but every step is synchronised.\n
+        With a lag of L, the wait is for a sum that every domain should have joined long ago, so it rarely blocks - a domain can run up to\n
+        L steps ahead of the slowest, and only exchanges (and waits for the others) when agents are actually travelling.
+        @param time The current model time step
+        @param leavers true if any agent on this domain wants to leave
+        @return true if agents must be exchanged this step */
+    bool exchangeDue(int time,bool leavers){
+        int now=time%(lag+1);
+        leaving[now]=leavers;
+        MPI_Iallreduce(&leaving[now],&domainsLeaving[now],1,MPI_INT,MPI_SUM,packedComm,&reductions[now]);
+        if (time<lag)return false;
+        int due=(time-lag)%(lag+1);
+        {
+            //a long wait here shows this domain is more than the lag ahead of another
+            traceRecorder::span s("leaver sum wait","mpi");
+            MPI_Wait(&reductions[due],MPI_STATUS_IGNORE);
+        }
+        return domainsLeaving[due]>0;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief complete the leaver sums still in progress - call once at the end of the run, on every domain */
+    void finish(){
+        MPI_Waitall(reductions.size(),reductions.data(),MPI_STATUSES_IGNORE);
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief the names of all the domains, in rank order - a travel location's owner is found from these (see \ref travelList::domainNumber) */
+    std::vector<std::string>& domains(){
+        return domainNames;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief the sum of a count over all the domains - call on every domain
+        @param n this domain's count */
+    long sumOverDomains(long n){
+        MPI_Allreduce(MPI_IN_PLACE,&n,1,MPI_LONG,MPI_SUM,packedComm);
+        return n;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief set up sharing places between domains that split one population between them - call on every domain, once the agents and places exist
+        @details When a population is split between domains (see \ref columnarFactory) every domain has a copy of every place, but a place used\n
+        by agents of more than one domain must have the same contamination on all of them. These shared places are found here - each domain flags\n
+        the places its agents use, and the flags are summed over the domains - and in every step \ref noteContamination and \ref shareContamination\n
+        add up the contamination left in them by each domain's agents. A place used by one domain's agents only needs no sharing, as no other\n
+        domain looks at its copy. All the domains must agree on whether the population is split, and must have the same places in the same order.
+        @param split true if this domain has only its share of a population split between domains
+        @param locals the local agents
+        @param places the list of places */
+    void setupSharedPlaces(bool split,std::vector<agent*>& locals,std::vector<place*>& places){
+        //the largest of split, and minus the smallest
+        int asked[2]={split,-int(split)};
+        MPI_Allreduce(MPI_IN_PLACE,asked,2,MPI_INT,MPI_MAX,packedComm);
+        if (asked[0]!=-asked[1]){
+            std::cout<<"Domain "<<domain<<": some domains split the population between them (model.columnar.domains>1) and some do not"<<std::endl;
+            exit(1);
+        }
+        if (!split)return;
+        if (!packed){
+            std::cout<<"Domain "<<domain<<": splitting the population between domains needs coupler.protocol=packed, with one rank per domain"<<std::endl;
+            exit(1);
+        }
+        if (threadLevel<MPI_THREAD_FUNNELED){
+            std::cout<<"Domain "<<domain<<": splitting the population between domains needs MPI started with at least MPI_THREAD_FUNNELED, but it only has"
+                     <<" thread level "<<threadLevel<<std::endl;
+            exit(1);
+        }
+        if (!samePlaces(places)){
+            std::cout<<"Domain "<<domain<<": splitting the population between domains needs the same places, in the same order, on every domain"<<std::endl;
+            exit(1);
+        }
+        placesShared=true;
+        placePosition.clear();
+        placePosition.reserve(places.size());
+        for (uint32_t p=0;p<places.size();p++)placePosition[places[p]]=p;
+        findSharedPlaces(locals,places);
+        std::cout<<"Domain "<<domain<<": "<<sharedPlaces.size()<<" places are also used by agents on other domains - their contamination is shared every step"<<std::endl;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief true if contamination of places is shared between the domains every step - the same answer on every domain */
+    bool sharesPlaces(){
+        return placesShared;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief note the contamination of the shared places before the agents cough - call from every thread of the step's parallel region,\n
+        once the places are updated
+        @details ends with a barrier, so no agent coughs until this is done. Like \ref shareContamination, this is only safe with MPI started\n
+        with at least MPI_THREAD_FUNNELED (see \ref startMPI), as it is part of the same parallel region as the MPI call there. */
+    void noteContamination(){
+        long n=sharedPlaces.size();
+        #pragma omp for schedule(static)
+        for (long i=0;i<n;i++)sharedBefore[i]=sharedPlaces[i]->getContaminationLevel();
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief add up the contamination left in the shared places by the agents of every domain - call from every thread of the step's\n
+        parallel region, once the agents have coughed
+        @details the change in each shared place on this domain is summed over the domains (one MPI_Allreduce, by the master thread) and added to\n
+        the level noted before the coughs, so every copy of the place ends up as if all its agents were on one domain. Ends with a barrier.\n
+        The MPI call is made while the other threads of the region wait, so MPI must be started with at least MPI_THREAD_FUNNELED - which\n
+        \ref startMPI asks for, and \ref setupSharedPlaces checks. */
+    void shareContamination(){
+        long n=sharedPlaces.size();
+        #pragma omp for schedule(static)
+        for (long i=0;i<n;i++)sharedChange[i]=sharedPlaces[i]->getContaminationLevel()-sharedBefore[i];
+        #pragma omp master
+        {
+            traceRecorder::span s("share contamination","mpi");
+            MPI_Allreduce(MPI_IN_PLACE,sharedChange.data(),n,MPI_DOUBLE,MPI_SUM,packedComm);
+        }
+        #pragma omp barrier
+        #pragma omp for schedule(static)
+        for (long i=0;i<n;i++)sharedPlaces[i]->setContaminationLevel(sharedBefore[i]+sharedChange[i]);
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief set up moving agents between domains to even out the time each takes - call on every domain, once the places exist
+        @details rebalancing needs the packed protocol, and a population split between the domains (see \ref setupSharedPlaces) - so that every\n
+        domain has the same places in the same order (as they are sent by position, which is checked here with a checksum of the place IDs), the\n
+        contamination of places can follow the agents, and agent IDs are the same on every domain, so agents can keep them when they move.\n
+        The interval has to agree, or the domains would rebalance on different steps - the largest asked for is used.
+        @param interval the number of steps between rebalances, or 0 for none
+        @param tolerance how far above the mean time the slowest domain must be before agents are moved, as a fraction
+        @param cooldown the number of rebalances before two domains that have just swapped agents may swap them back
+        @param places the list of places */
+    void setupRebalance(int interval,double tolerance,int cooldown,std::vector<place*>& places){
+        int asked=std::max(interval,0);
+        rebalanceInterval=asked;
+        MPI_Allreduce(MPI_IN_PLACE,&rebalanceInterval,1,MPI_INT,MPI_MAX,packedComm);
+        if (rebalanceInterval!=asked)std::cout<<"Domain "<<domain<<": using coupler.rebalanceInterval="<<rebalanceInterval<<" to match the other domains"<<std::endl;
+        bool same=samePlaces(places);
+        if (rebalanceInterval>0 && (!packed || !placesShared || !same)){
+            std::cout<<"Domain "<<domain<<": rebalancing needs coupler.protocol=packed and a population split between the domains, with the same places"
+                     <<" on every domain (model.columnar.domains>1) - turned off"<<std::endl;
+            rebalanceInterval=0;
+        }
+        balancer.setup(tolerance,cooldown);
+        settlersOut.assign(domainNames.size(),std::vector<settler>());
+        settlersIn.assign(domainNames.size(),std::vector<settler>());
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief check whether the domains rebalance at this step - the same answer on every domain */
+    bool rebalanceDue(int time){
+        return rebalanceInterval>0 && time>0 && time%rebalanceInterval==0;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief move agents from domains that are taking longest to those that are quickest - call on every domain when \ref rebalanceDue
+        @details Every domain shares the time it spent computing since the last rebalance (not counting time waiting for the others) and its\n
+        number of agents, and the \ref domainBalancer works out, identically on every domain, how many agents each slow domain should send to\n
+        a fast one. The agents go in clusters: a home with everyone who lives there, taken from the end of the list of locals backwards, so\n
+        households stay together and the agents left keep their order. A home is skipped if anyone living there is away on another domain,\n
+        or about to leave. The agents are sent as \ref settler records (the packed \ref migrant record plus places and schedule), deleted\n
+        here, and made into new local agents, keeping their IDs (so infection events can still be traced to them), on the receiving domain.\n
+        Every domain already has all the places, but first each place's contamination is copied from the domain that has been keeping it up\n
+        to date to all the others (see \ref syncPlaces), so it moves with the household - and afterwards the shared places are found again.
+        @param time The current model time step
+        @param locals The list of agents local to this domain - agents are removed from and added to this
+        @param places The list of places - the same on every domain
+        @param seconds The time this domain spent computing since the last rebalance
+        @return the number of agents sent or received by this domain */
+    long rebalance(int time,std::vector<agent*>& locals,std::vector<place*>& places,double seconds){
+        traceRecorder::span span("rebalance","mpi");
+        int size=domainNames.size();
+        std::vector<double> times(size);
+        std::vector<long> counts(size);
+        long mine=locals.size();
+        MPI_Allgather(&seconds,1,MPI_DOUBLE,times.data(),1,MPI_DOUBLE,packedComm);
+        MPI_Allgather(&mine,1,MPI_LONG,counts.data(),1,MPI_LONG,packedComm);
+        std::vector<domainBalancer::move> moves=balancer.plan(times,counts);
+        for (auto& o:settlersOut)o.clear();
+        //every domain joins in, as the plan is the same on all of them
+        if (!moves.empty())syncPlaces(locals,places);
+        long sent=0;
+        for (auto& m:moves){
+            if (m.from!=rank)continue;
+            //who lives in each home
+            std::unordered_map<place*,std::vector<unsigned long>> residents;
+            for (unsigned long i=0;i<locals.size();i++)residents[locals[i]->places[agent::home]].push_back(i);
+            std::vector<bool> moving(locals.size(),false);
+            long chosen=0,homes=0;
+            for (long i=locals.size()-1;i>=0 && chosen<m.agents;i--){
+                auto it=residents.find(locals[i]->places[agent::home]);
+                if (it==residents.end())continue;
+                bool settled=true;
+                for (auto k:it->second)settled=settled && locals[k]->active() && !locals[k]->leaver();
+                if (settled){
+                    for (auto k:it->second){
+                        agent* a=locals[k];
+                        settler r;
+                        r.agent.pack(1,a);
+                        for (int p=0;p<3;p++)r.places[p]=placePosition.at(a->places[p]);
+                        r.currentPlace=a->currentPlace;
+                        r.scheduleType=a->scheduleType;
+                        r.originalScheduleType=a->originalScheduleType;
+                        r.schedulePoint=a->schedulePoint;
+                        r.scheduleTimer=a->scheduleTimer;
+                        settlersOut[m.to].push_back(r);
+                        moving[k]=true;
+                    }
+                    chosen+=it->second.size();
+                    homes++;
+                }
+                //each home is only looked at once
+                residents.erase(it);
+            }
+            //remove the movers, keeping the order of the rest - positions of agents away on other domains change
+            unsigned long kept=0;
+            for (unsigned long i=0;i<locals.size();i++){
+                if (moving[i])delete locals[i];
+                else locals[kept++]=locals[i];
+            }
+            locals.resize(kept);
+            if (!away.empty()){
+                for (unsigned long i=0;i<locals.size();i++){
+                    auto it=away.find(locals[i]->getID());
+                    if (it!=away.end())it->second=i;
+                }
+            }
+            sent+=chosen;
+            std::cout<<"Domain "<<domain<<": rebalancing at step "<<time<<" sent "<<chosen<<" agents in "<<homes<<" homes to domain "<<domainNames[m.to]<<std::endl;
+        }
+        swapWithNeighbours(settlersOut,settlersIn);
+        long arrived=0;
+        for (auto& in:settlersIn)arrived+=in.size();
+        for (int r=0;r<size;r++){
+            for (auto& s:settlersIn[r]){
+                agent* a=new agent(s.agent.id);
+                s.agent.unpack(a);
+                a->setHome(places[s.places[agent::home]]);
+                a->setWork(places[s.places[agent::work]]);
+                a->setTransport(places[s.places[agent::vehicle]]);
+                a->currentPlace=agent::placeTypes(s.currentPlace);
+                a->scheduleType=agent::scheduleTypes(s.scheduleType);
+                a->originalScheduleType=agent::scheduleTypes(s.originalScheduleType);
+                a->schedulePoint=s.schedulePoint;
+                a->scheduleTimer=s.scheduleTimer;
+                locals.push_back(a);
+            }
+            if (!settlersIn[r].empty())std::cout<<"Domain "<<domain<<": rebalancing at step "<<time<<" received "<<settlersIn[r].size()<<" agents from domain "<<domainNames[r]<<std::endl;
+        }
+        if (!moves.empty())findSharedPlaces(locals,places);
+        size_t bytes=0;
+        for (int r=0;r<size;r++)bytes+=(settlersOut[r].capacity()+settlersIn[r].capacity())*sizeof(settler);
+        peakBufferBytes=std::max(peakBufferBytes,bytes);
+        return sent+arrived;
+    }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief the largest memory used by the buffers of any exchange so far, in bytes - MUI's own storage is not included */
+    size_t memoryUsed(){
+        return peakBufferBytes;
     }
 //--------------------------------------------------------------------------------------------------------
     /** @brief The data to be pushed from this domain to the remote domain on the other thread, for each agent */
@@ -131,29 +694,35 @@ public:
      *  @details this gets annoyingly complex :(. When an agent leaves its original domain, it is assumed it will return at some point\n
      *  i.e. each moving agent is a traveller. For this reason the original agent on the original domain is left untouched, but labelled as inactive \n
      *  Any agents (either local ones, or travellers) that are set to leave their current domain in this timestep are initially labelled as leavers.\n 
-        In the first part of the routine, all agents that are inactive have their ID stored. This is so that incoming data can be assigned to \n
-        returning agents when they come back from travel. Then local leaver agents have their data pushed out to the remote domain, labelled \n
+        In the first part of the routine, local leaver agents have their data pushed out to the remote domain, labelled \n
         with a zero to show that they are outgoing, and with their *local* agent ID (note this may coincide with a remote ID, but such remote agents\n
         will not be "travellers"). Following this travellers on the current domain that are labelled as leaving (i.e. they are about to go home) \n
         have their data pushed, now with a label larger than 1 to show that they are not local to this pushing thread (larger than one is used since the\n
         labels are currently doubles, so guarantees that we can distinguish this value reliably from 0). These leaving agents are immediately deactivated\n
         on the local thread (since they are about to go away to the remote MPI domain), and also re-labelled as non-leavers (since they cannot leave their\n
-        domain a second time, unless and until they return to the current domain).\n
+        domain a second time, unless and until they return to the current domain). Each local leaver's position is stored by ID in \ref away, so that\n
+        incoming data can be assigned to it when it comes back from travel, and each traveller going home has its position added to \ref freeTravellers.\n
         All changes are now committed - i.e. they are sent to the remote domain - this implies a wait for the other thread to be ready.\n
         In the second part of the routine, data can now be fetched - this is all done in one go, and the data stored ready for use: it needs to be allocated\n
         to the right agents. First we deal with incoming travellers. On the remote thread, these were labelled with zero (since there they were local leavers)\n
         so we pick out those arrivals first. We need to create a new agent on the local thread to store their data - this agent is added to the travellers present here\n
         However, to save memory allocations, we can re-use any local inactive travellers - these were agents that were sent here, but have since gone home.\n
-        So first we set up a list of inactive local travellers and re-use these - if we run out of these, then we create some new agents. Each traveller is \n
+        These are kept in \ref freeTravellers and re-used - if we run out of these, then we create some new agents. Each traveller is \n
         added to the local vector of travellers (kept separate from the local list of agents) and assigned the ID from the remote domain. Then their schedules\n
         are set up using a call to \ref outwardTravel in \ref agent.cpp . They are also labelled as needing to leave the domain at the end of their schedule.\n
-        Now we can add the returning travellers - we use their (local) ID and index, as transmitted with them from the remote domain to find their corresponding \n
+        Now we can add the returning travellers - we use their (local) ID, as transmitted with them from the remote domain, to find their corresponding \n
         local copy, activate it and copy in the data sent from the remote domain. The schedule for returning home is set with a call to \ref inwardTravel .
         @param time The current model time step
         @param locals The list of agents local to this domain (i.e. excluding travellers)
         @param travellers The list of agents that have come from the remote domain
         @param leavers The list of new agents about to leave this domain */
     void exchange(int time,std::vector<agent*>& locals,std::vector<agent*>& travellers,bool leavers){
+        //only do the full data exchange if some domain had agents to send - this avoids expensive loops over all agents, and waiting for the other domain
+        if (!exchangeDue(time,leavers))return;
+        if (packed){
+            exchangePacked(time,locals,travellers,leavers);
+            return;
+        }
         
         // Declare MUI interface and samplers using templates in config.h
         // note: please update types stored in default_config in config.h first to 1-dimensional before compilation
@@ -162,37 +731,20 @@ public:
 
         mui::chrono_sampler_exact<mui::mui_config> chrono_sampler;
         mui::point<mui::mui_config::REAL, 1> push_loc;
-        //push the leavers flag to the other domain - leavers is 1 if this domain has any data to send - at the moment I ony seem to be able to send real values assocaited with a "data point"
-        //hence the extra zero value and the casts
-        flagInterface->push( "Check",  static_cast<mui::mui_config::REAL>(0), static_cast<mui::mui_config::REAL>(leavers)  );
-        flagInterface->commit(time);
-        //get the flag - again I only seem to be able to receive at a given time into a vector, even if there is only one value
-        //std::vector<mui::point<mui::mui_config::REAL, 1>> flag_locs = flagInterface->fetch_points<mui::mui_config::REAL>( "Check", time, chrono_sampler ); // Extract the locations stored in the interface at time
-        std::vector<double> received_flag_value = flagInterface->fetch_values<mui::mui_config::REAL>( "Check", time, chrono_sampler );
-        //only do the full data exchange if either this domain has some data to send, or the flag received from the other domain is non zero (i.e. it wants to send data)
-        //since we have cast bools to doubles, use 0.5 as the check to guarantee we don't have trouble with values being some tiny amount greater than zero.
-if ((received_flag_value[0]+(double)leavers)>0.5){
+{
         // Push values to the MUI interface - at the moment it seems all values have to be cast to doubles??
         
         // For each value sent, the receiver will get (in order) a copy of the location and then the value
-        //TODO set up the airplane (or other vehicle) to carry the agent at each end, in a way that can generalize to more than two domains, and that knows the domain.
+        //TODO set up the airplane (or other vehicle) to carry the agent at each end - the packed protocol sends agents to any number of domains, this one only to the other of two.
         //count of agents moved this time
         unsigned count=0;
-        // store a mapping from agent IDs to index in locals */
-    std::map<unsigned long,unsigned long> identities;
     for(unsigned long i=0; i<locals.size(); i++) { //
-        //need to store the index value currently associated with inactive agents for retrieving travellers below
-        //note this might not be the index they originally had when they first left the domain...
-        if (!locals[i]->active())identities[locals[i]->getID()]=i;
         //loop over all locals  leavers- agents that normally reside on this domain may decide to leave
-        //leavers vector holds the indices into the locals vector
+        //leavers are noted in away, so they can be found again by ID when they come back
         if (locals[i]->leaver()){
             //push leaver data
             count++;
-            //local copy on this domain pauses
-            locals[i]->deactivate();
-            //once the agent has crossed to the other side, it shouldn't try again! - until its schedule says so in the main model
-            locals[i]->doNotLeaveDomain();
+            depart(locals,i);
             //currently use i to label the agent - OK since here we loop over all agents, and immediately fetch below
             push_loc = static_cast<mui::mui_config::REAL>(i);
             //locals going travelling are labelled with a zero
@@ -206,9 +758,7 @@ if ((received_flag_value[0]+(double)leavers)>0.5){
         if (travellers[i]->leaver()){
             count++;
             //local copy on this domain pauses - this traveller can be re-used if necessary
-            travellers[i]->deactivate();
-            //once the agent has crossed to the other side, it shouldn't try again! - unless it gets re-used to represent another agent from the remote domain
-            travellers[i]->doNotLeaveDomain();
+            sendHome(travellers,i);
             //dummy location - not used at the far end as the agent is crossing back to its own original domain
             push_loc = static_cast<mui::mui_config::REAL>(i);
             //returning travellers are labelled with a 2
@@ -218,28 +768,31 @@ if ((received_flag_value[0]+(double)leavers)>0.5){
     if(verbose)std::cout<<"Domain "<<domain<<": counted "<<count<<" leavers at step "<<time<<std::endl;
     
     // Commit (transmit by MPI) the values at time
-    interface->commit( time );
+    {
+        traceRecorder::span s("data commit","mpi");
+        interface->commit( time );
+    }
     
     //===================================================================================
     //Fetch the values from the interface using the fetch_points and fetch_values methods
     //====================================================================================
     // (blocking until data at "t=time" exists according to chrono_sampler)
-    std::vector<mui::point<mui::mui_config::REAL, 1>> fetch_locs = interface->fetch_points<mui::mui_config::REAL>( "data", time, chrono_sampler ); // Extract the locations stored in the interface at time
-    std::vector<double> fetch_vals = interface->fetch_values<mui::mui_config::REAL>( "data", time, chrono_sampler ); // Extract the values stored in the interface at time
+    std::vector<mui::point<mui::mui_config::REAL, 1>> fetch_locs;
+    std::vector<double> fetch_vals;
+    {
+        traceRecorder::span s("data fetch","mpi");
+        fetch_locs = interface->fetch_points<mui::mui_config::REAL>( "data", time, chrono_sampler ); // Extract the locations stored in the interface at time
+        fetch_vals = interface->fetch_values<mui::mui_config::REAL>( "data", time, chrono_sampler ); // Extract the values stored in the interface at time
+    }
     
     if(verbose)std::cout<<"Domain:"<< domain<<" Total number of data elements fetched "<<fetch_locs.size()<<std::endl;
+    //keep track of the exchange buffer sizes for the memory report - map nodes are about 48 bytes plus the key and value
+    peakBufferBytes=std::max(peakBufferBytes,fetch_locs.capacity()*sizeof(mui::point<mui::mui_config::REAL, 1>)+fetch_vals.capacity()*sizeof(double)
+                                             +indexBytes());
     // All values for all agents, both returning locals and new travellers are all packed together, new travellers first (labelled with 0 as the first data element)
     
-    //These are the travellers on this domain that can be re-used, since they have been inactivated
-    std::vector<unsigned long>indx;
-    for (unsigned long i=0;i<travellers.size();i++){
-        if( !travellers[i]->active())indx.push_back(i);
-    }
-    
     //count of agents moved this time
     count=0;
-    //index into 
-    unsigned long reuser=0;
     //iterator over ALL data elements transferred
     unsigned long i=0;
     while (i<fetch_locs.size()) {
@@ -247,14 +800,8 @@ if ((received_flag_value[0]+(double)leavers)>0.5){
         if (fetch_vals[i]<1){
             count++;
             i++;
-            agent* a;
-            if (reuser<indx.size()){
-                a=travellers[indx[reuser]];//use the free indices into travellers to find agents that can be overwritten with new data
-                reuser++;
-            }else{
-                a=new agent();
-                travellers.push_back(a);//only needed if no free inactive travellers 
-            }
+            //inactive travellers are re-used, so that new agents are only needed if there are none free
+            agent* a=arrival(travellers);
             if(verbose)printf( "domain %s fetched value %lf at location %lf time %d \n", domain.c_str(), fetch_vals[i], fetch_locs[i][0],time );
             if(verbose)std::cout<<"I am a passenger, and I ride and I ride"<<std::endl;
             a->setID(fetch_vals[i]);
@@ -269,9 +816,8 @@ if ((received_flag_value[0]+(double)leavers)>0.5){
             i++;
             if(verbose)printf( "domain %s fetched value %lf at location %lf time %d \n", domain.c_str(), fetch_vals[i], fetch_locs[i][0],time );
             if(verbose)std::cout<<"You're going, you're going home"<<std::endl;
-            //identities labelled the agent's place in the local domain agent vector - check this is true! NB IDs are only valid in original domain
-            assert(locals[identities[fetch_vals[i]]]->getID()==(long)fetch_vals[i]);
-            agent* a=locals[identities[fetch_vals[i]]];
+            //away holds the agent's place in the local domain agent vector - NB IDs are only valid in original domain
+            agent* a=homecoming(locals,(unsigned long)fetch_vals[i]);
             a->activate();
             a->inwardTravel();//sets up return journey
             //...copy in modified data...one value for each after the ID
@@ -282,4 +828,74 @@ if ((received_flag_value[0]+(double)leavers)>0.5){
     if(verbose)std::cout<<"Domain "<<domain<<": counted "<<count<<" arrivals at step "<<time<<std::endl;
 }
     }
+//--------------------------------------------------------------------------------------------------------
+    /** @brief the same exchange as \ref exchange, but with each agent packed into a \ref migrant record, and sent only to the domain it is going to
+        @details Leaving locals (travel type 0) and travellers going home (type 2) are packed into one buffer per destination rank, in the same\n
+        order as the MUI protocol, and deactivated. A local goes to the domain owning its travel location (see \ref agent::setDestination), and a\n
+        traveller goes back to the domain it came from. With only two domains, an agent with no destination goes to the other one.\n
+        Every domain then sends every other the number of agents it has for it (MPI_Alltoall - one int per rank, as this is only called on steps\n
+        where some domain has leavers, see \ref exchangeDue), and the agents themselves are sent and received with non-blocking calls, one\n
+        message per pair of domains that actually have agents to swap - so with many domains, each only talks to its current neighbours.\n
+        Arrivals are handled as in \ref exchange, source by source in rank order, so the result does not depend on message timing. New\n
+        travellers are given their source domain as destination, so that they go back there.
+        @param time The current model time step
+        @param locals The list of agents local to this domain (i.e. excluding travellers)
+        @param travellers The list of agents that have come from the remote domains
+        @param leavers true if any agent on this domain is leaving - if false the agent lists are not searched */
+    void exchangePacked(int time,std::vector<agent*>& locals,std::vector<agent*>& travellers,bool leavers){
+        int size=domainNames.size();
+        for (auto& o:outboxes)o.clear();
+        if (leavers){
+            for (unsigned long i=0;i<locals.size();i++){
+                if (locals[i]->leaver()){
+                    auto& o=outboxes[destinationOf(locals[i])];
+                    depart(locals,i);
+                    o.push_back(migrant());
+                    o.back().pack(0,locals[i]);
+                }
+            }
+            for (unsigned long i=0;i<travellers.size();i++){
+                if (travellers[i]->leaver()){
+                    auto& o=outboxes[destinationOf(travellers[i])];
+                    sendHome(travellers,i);
+                    o.push_back(migrant());
+                    o.back().pack(2,travellers[i]);
+                }
+            }
+        }
+        if(verbose){
+            long leaving=0;
+            for (auto& o:outboxes)leaving+=o.size();
+            std::cout<<"Domain "<<domain<<": counted "<<leaving<<" leavers at step "<<time<<std::endl;
+        }
+        {
+            //this waits for the remote domains to reach the same step - in a trace, a long exchange shows this domain waiting for the others
+            traceRecorder::span s("packed exchange","mpi");
+            swapWithNeighbours(outboxes,inboxes);
+        }
+        long arrived=std::accumulate(receiveCounts.begin(),receiveCounts.end(),0L);
+        if(verbose)std::cout<<"Domain:"<< domain<<" Total number of agents fetched "<<arrived<<std::endl;
+        size_t bytes=indexBytes()+(sendCounts.capacity()+receiveCounts.capacity())*sizeof(int)+requests.capacity()*sizeof(MPI_Request);
+        for (int r=0;r<size;r++)bytes+=(outboxes[r].capacity()+inboxes[r].capacity())*sizeof(migrant)+2*sizeof(std::vector<migrant>);
+        peakBufferBytes=std::max(peakBufferBytes,bytes);
+        for (int r=0;r<size;r++){
+            for (auto& m:inboxes[r]){
+                if (m.travelType<1){
+                    agent* a=arrival(travellers);
+                    a->setID(m.id);
+                    a->activate();
+                    a->outwardTravel();
+                    a->setRemoteLocation();
+                    a->setDestination(r);
+                    m.unpack(a);
+                }else{
+                    agent* a=homecoming(locals,m.id);
+                    a->activate();
+                    a->inwardTravel();
+                    m.unpack(a);
+                }
+            }
+        }
+        if(verbose)std::cout<<"Domain "<<domain<<": counted "<<arrived<<" arrivals at step "<<time<<std::endl;
+    }
 };
@@ -0,0 +1,222 @@
+#ifndef HARDWARECOUNTERS_H_INCLUDED
+#define HARDWARECOUNTERS_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file hardwareCounters.h
+ * @brief File containing the definition of the \ref hardwareCounters class, which reads the CPU performance counters of each thread
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstring>
+#include<cerrno>
+#include<string>
+#include<vector>
+#include<array>
+#include<algorithm>
+#include<iostream>
+#include<mutex>
+#include<thread>
+#include<unordered_map>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Reads CPU performance counters (cycles, instructions, last level cache misses and data TLB misses) for the calling thread
+    @details Uses the Linux perf_event_open system call. Each thread that calls \ref read gets its own set of counters the first time it does so,\n
+    counting only that thread's user-space work. The counters are opened as a group, so all of them are read with one system call.\n
+    The counters of every thread belong to the object, and are all closed when it is destroyed.\n
+    Counters are often unavailable - in virtual machines and containers, or if /proc/sys/kernel/perf_event_paranoid is set too high -\n
+    in which case \ref available is false, \ref read gives zeros and \ref reason says why. If only some of the counters can be opened\n
+    the others are still read, and the missing ones give zeros (see \ref has).\n
+    If the kernel has to share the hardware between more counters than it has, each value is scaled up by the fraction of time it was running.
+    \code
+    hardwareCounters hw;
+    hardwareCounters::values start=hw.read();
+    ... do some stuff ...
+    hardwareCounters::values used=hw.difference(start,hw.read());
+    double ipc=double(used[hardwareCounters::instructions])/used[hardwareCounters::cycles];
+    \endcode
+*/
+class hardwareCounters{
+public:
+    /** @brief the counters read - used as indices into \ref values */
+    enum counterNames{cycles,instructions,llcMisses,dtlbMisses,nCounters};
+    /** @brief one value for each counter */
+    typedef std::array<uint64_t,nCounters> values;
+    /** @brief a perf_event_open event type and configuration for each counter */
+    struct eventType{
+        /** @brief the perf event type, e.g. PERF_TYPE_HARDWARE */
+        uint32_t type;
+        /** @brief the event within that type */
+        uint64_t config;
+    };
+private:
+    /** @brief the open counters for one thread */
+    struct threadGroup{
+        /** @brief the file descriptor of the first counter opened, which leads the group - -1 if none */
+        int leader=-1;
+        /** @brief which counter each value read from the group belongs to */
+        std::vector<int> order;
+        /** @brief all the file descriptors, so they can be closed */
+        std::vector<int> fds;
+        /** @brief the value of _generation when these were opened */
+        int generation=-1;
+    };
+    /** @brief the events to count */
+    std::array<eventType,nCounters> _events;
+    /** @brief false if no counters could be opened */
+    bool _available=true;
+    /** @brief which counters could be opened on every thread so far */
+    std::array<bool,nCounters> _has;
+    /** @brief why the counters are not available */
+    std::string _reason;
+    /** @brief counts calls to \ref setEvents, so that threads re-open their counters with the new events */
+    int _generation=0;
+    /** @brief the counters of each thread that has called \ref read - elements stay put when others are added, so a thread can use its own unlocked */
+    std::unordered_map<std::thread::id,threadGroup> _groups;
+    /** @brief guards adding to \ref _groups */
+    std::mutex _groupsLock;
+    /** @brief the system call (glibc has no wrapper) */
+    static int perfEventOpen(perf_event_attr* attributes,int groupLeader){
+        return syscall(SYS_perf_event_open,attributes,0,-1,groupLeader,0);
+    }
+    /** @brief close a thread's counters */
+    static void close(threadGroup& g){
+        for (auto fd:g.fds)::close(fd);
+        g.fds.clear();
+        g.leader=-1;
+        g.order.clear();
+    }
+    /** @brief open the counters for the calling thread */
+    void open(threadGroup& g){
+        close(g);
+        for (int c=0;c<nCounters;c++){
+            perf_event_attr a;
+            memset(&a,0,sizeof(a));
+            a.size=sizeof(a);
+            a.type=_events[c].type;
+            a.config=_events[c].config;
+            a.exclude_kernel=1;
+            a.exclude_hv=1;
+            a.read_format=PERF_FORMAT_GROUP|PERF_FORMAT_TOTAL_TIME_ENABLED|PERF_FORMAT_TOTAL_TIME_RUNNING;
+            a.disabled=(g.leader==-1)?1:0;
+            int fd=perfEventOpen(&a,g.leader);
+            if (fd<0){
+                #pragma omp critical(hardwareCountersMessage)
+                if (_reason.empty())_reason=std::string("perf_event_open failed: ")+strerror(errno);
+                continue;
+            }
+            if (g.leader==-1)g.leader=fd;
+            g.order.push_back(c);
+            g.fds.push_back(fd);
+        }
+        #pragma omp critical(hardwareCountersMessage)
+        {
+            if (g.leader==-1)_available=false;
+            //a counter is only reported if every thread could open it
+            for (int c=0;c<nCounters;c++)_has[c]=_has[c] && std::find(g.order.begin(),g.order.end(),c)!=g.order.end();
+        }
+        if (g.leader!=-1){
+            ioctl(g.leader,PERF_EVENT_IOC_RESET,PERF_IOC_FLAG_GROUP);
+            ioctl(g.leader,PERF_EVENT_IOC_ENABLE,PERF_IOC_FLAG_GROUP);
+        }
+    }
+public:
+    /** @brief set up to count cycles, instructions, last level cache misses and data TLB read misses */
+    hardwareCounters(){
+        setEvents({{{PERF_TYPE_HARDWARE,PERF_COUNT_HW_CPU_CYCLES},
+                    {PERF_TYPE_HARDWARE,PERF_COUNT_HW_INSTRUCTIONS},
+                    {PERF_TYPE_HARDWARE,PERF_COUNT_HW_CACHE_MISSES},
+                    {PERF_TYPE_HW_CACHE,PERF_COUNT_HW_CACHE_DTLB|(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_MISS<<16)}}});
+    }
+    /** @brief close the counters of every thread */
+    ~hardwareCounters(){
+        for (auto& g:_groups)close(g.second);
+    }
+    /** @brief the counters belong to the threads that opened them, so no copies */
+    hardwareCounters(const hardwareCounters&)=delete;
+    /** @brief no assignment either */
+    hardwareCounters& operator=(const hardwareCounters&)=delete;
+    /** @brief the number of file descriptors held open for counters, over all threads */
+    int openDescriptors(){
+        std::lock_guard<std::mutex> lock(_groupsLock);
+        int n=0;
+        for (auto& g:_groups)n+=g.second.fds.size();
+        return n;
+    }
+    /** @brief count different events - mainly for testing on machines without hardware counters (e.g. with PERF_TYPE_SOFTWARE events)
+        @param events the event for each of the counters, in the order of \ref counterNames */
+    void setEvents(std::array<eventType,nCounters> events){
+        _events=events;
+        _available=true;
+        _has.fill(true);
+        _reason.clear();
+        _generation++;
+    }
+    /** @brief read the counters for the calling thread, opening them if this is the first time on this thread
+        @return the value of each counter - zero for those not available */
+    values read(){
+        values v={0,0,0,0};
+        if (!_available)return v;
+        threadGroup* g;
+        {
+            std::lock_guard<std::mutex> lock(_groupsLock);
+            g=&_groups[std::this_thread::get_id()];
+        }
+        if (g->generation!=_generation){
+            g->generation=_generation;
+            open(*g);
+        }
+        if (g->leader==-1)return v;
+        uint64_t buffer[3+nCounters];
+        ssize_t n=::read(g->leader,buffer,sizeof(buffer));
+        if (n<ssize_t(3*sizeof(uint64_t)))return v;
+        //buffer holds the number of counters, the time enabled, the time running, then the values
+        double scale=(buffer[2]>0)?double(buffer[1])/double(buffer[2]):1;
+        for (unsigned k=0;k<buffer[0] && k<g->order.size();k++)v[g->order[k]]=uint64_t(buffer[3+k]*scale);
+        return v;
+    }
+    /** @brief the change in each counter between two readings */
+    static values difference(const values& start,const values& end){
+        values d;
+        for (int c=0;c<nCounters;c++)d[c]=(end[c]>start[c])?end[c]-start[c]:0;
+        return d;
+    }
+    /** @brief check whether any counters can be read - only known for certain once \ref read has been called */
+    bool available(){
+        return _available;
+    }
+    /** @brief check whether a particular counter could be opened */
+    bool has(int counter){
+        return _available && _has[counter];
+    }
+    /** @brief why some or all counters are not available - empty if they all are */
+    std::string reason(){
+        return _reason;
+    }
+    /** @brief a short name for each counter */
+    static std::string name(int counter){
+        static const char* names[nCounters]={"cycles","instructions","llcMisses","dtlbMisses"};
+        return names[counter];
+    }
+};
+#endif // HARDWARECOUNTERS_H_INCLUDED
@@ -28,6 +28,7 @@
 #include<vector>
 #include<set>
 #include<string>
+#include<sstream>
 #include<assert.h>
 #include<omp.h>
 #include"parameters.h"
@@ -45,7 +46,47 @@
 
 //------------------------------------------------------------------------
 //------------------------------------------------------------------------
-/** set up and run the model 
+/** @brief run a set of scenario branches, each copied from the model at the branch step
+ @details Each branch reads its own parameter file over the top of the main run parameters, so the file need only list\n
+ the values that change. The branches run one after another to the end of the run, each from an independent copy of the base model.\n
+ The static disease and date settings are changed by each branch, so they are put back afterwards ready for the main run to carry on.
+ @param base The model that has been run up to the branch step
+ @param parameters The parameters of the main run
+ @param branchStep The step at which the branches start */
+void runBranches(model& base,parameterSettings& parameters,int branchStep){
+    //keep the current date so each branch (and the main run) can start from the same point in time
+    int year=timeStep::getYear(),month=timeStep::getMonth(),weekDay=timeStep::getDayOfWeek(),monthDay=timeStep::getDayOfMonth();
+    int hour=timeStep::getTimeOfDay()/100,minute=timeStep::getTimeOfDay()%100,second=timeStep::getSeconds();
+    int stepNumber=timeStep::getStepNumber();
+    std::stringstream files(parameters("run.branchParameterFiles"));
+    std::string fileName;
+    int branchNumber=0;
+    while(std::getline(files,fileName,',')){
+        fileName.erase(std::remove_if(fileName.begin(), fileName.end(), ::isspace), fileName.end());
+        if (fileName.empty())continue;
+        std::cout<<"Starting branch "<<branchNumber<<" at step "<<branchStep<<" using "<<fileName<<std::endl;
+        parameterSettings branchParameters=parameters;
+        branchParameters.readParameters(fileName);
+        disease d(branchParameters);
+        model branch(base,branchParameters,branchNumber);
+        auto start=timeReporter::getTime();
+        for (int step=branchStep;step<branchParameters.get<int>("run.nSteps");step++){
+            if (step%100==0)std::cout<<"Branch "<<branchNumber<<" start of step "<<step<<std::endl;
+            branch.step(step,branchParameters);
+        }
+        branch.end(branchParameters);
+        auto end=timeReporter::getTime();
+        timeReporter::showInterval("Branch execution time: ",start,end);
+        timeStep::setDate(year,month,weekDay,monthDay,hour,minute,second);
+        timeStep::setStepNumber(stepNumber);
+        branchNumber++;
+    }
+    //back to the main run settings
+    disease d(parameters);
+}
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** set up and run the model
  @param argc The number of command line arguments - at the moment 1 is the parameter file and (optionally) 2 is the MPI domain name
  @param argv The argument values - 1 is expected to be just the name of the parameter file, 2 is an arbitrary string */
 int main(int argc, char **argv) {
@@ -107,8 +148,17 @@ int main(int argc, char **argv) {
         model m(parameters,domain);
         //start a timer to record the execution time
         auto start=timeReporter::getTime();
+        //if there are scenario branches, run up to the branch step, run the branches, then carry on
+        int nSteps=parameters.get<int>("run.nSteps");
+        int branchStep=parameters.get<int>("run.branchStep");
+        bool branching=(branchStep>=0 && branchStep<nSteps);
+# ifdef COUPLER
+        if (branching)std::cout<<"Scenario branches are ignored when using the MPI coupler"<<std::endl;
+        branching=false;
+# endif
         //loop over time steps
-        for (int step=0;step<parameters.get<int>("run.nSteps");step++){
+        for (int step=0;step<nSteps;step++){
+            if (branching && step==branchStep)runBranches(m,parameters,branchStep);
             if (step%100==0)std::cout<<"Start of step "<<step<<std::endl;
             m.step(step,parameters);
         }
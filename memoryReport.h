@@ -0,0 +1,160 @@
+#ifndef MEMORYREPORT_H_INCLUDED
+#define MEMORYREPORT_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file memoryReport.h
+ * @brief File containing the definition of the \ref memoryReport class, which adds up the memory used by each part of the model
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<iostream>
+#include<iomanip>
+#include<malloc.h>
+#include<sys/resource.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief A table of the memory used by each part of the model, compared with what the operating system says the program is using
+    @details Each part adds a line giving the number of items and the bytes they use. Objects created with new cost more than their\n
+    sizeof, as the allocator rounds up and adds its own header - \ref allocatedSize measures this for a sample object.\n
+    The table is shown along with the resident set size (RSS - the memory actually in use) and its peak, and the difference between\n
+    the RSS and the total of the table (memory not accounted for - e.g. the program code, thread stacks and memory freed but not\n
+    returned to the system). From the bytes per agent and per place a run of any size can then be estimated - see \ref show.
+    \code
+    memoryReport m;
+    m.add("agents",agents.size(),agents.size()*memoryReport::allocatedSize(agents[0]),memoryReport::perAgent);
+    m.show("after initialisation",agents.size(),places.size(),100000000);
+    \endcode
+*/
+class memoryReport{
+public:
+    /** @brief how a line scales when the model gets bigger - used to estimate the memory for a larger run */
+    enum scaling{perAgent,perPlace,fixed};
+private:
+    /** @brief one line of the table */
+    struct entry{
+        /** @brief what the memory is used for */
+        std::string name;
+        /** @brief how many items */
+        uint64_t count;
+        /** @brief the total bytes */
+        uint64_t bytes;
+        /** @brief how it scales with model size */
+        scaling scale;
+        /** @brief true if this is a breakdown of the line above, and so not added to the total */
+        bool detail;
+    };
+    /** @brief the lines of the table */
+    std::vector<entry> _entries;
+    /** @brief read a value in kB from /proc/self/status
+        @param key the name of the line, e.g. "VmRSS:"
+        @return the value in bytes, or 0 if not found */
+    static uint64_t procStatus(const char* key){
+        FILE* f=fopen("/proc/self/status","r");
+        if (f==nullptr)return 0;
+        char line[256];
+        uint64_t kB=0;
+        size_t n=strlen(key);
+        while (fgets(line,sizeof(line),f)){
+            if (strncmp(line,key,n)==0){kB=strtoull(line+n,nullptr,10);break;}
+        }
+        fclose(f);
+        return kB*1024;
+    }
+public:
+    /** @brief add a line to the table
+        @param name what the memory is used for
+        @param count the number of items
+        @param bytes the total bytes used
+        @param scale whether this grows with the number of agents, the number of places, or not at all */
+    void add(std::string name,uint64_t count,uint64_t bytes,scaling scale){
+        _entries.push_back({name,count,bytes,scale,false});
+    }
+    /** @brief add a line that breaks down part of the line above (e.g. the fields within an object) - shown indented, and not added to the total
+        @param name what the memory is used for
+        @param count the number of items
+        @param bytes the total bytes used */
+    void addDetail(std::string name,uint64_t count,uint64_t bytes){
+        _entries.push_back({"  "+name,count,bytes,fixed,true});
+    }
+    /** @brief the total of all lines */
+    uint64_t total(){
+        uint64_t sum=0;
+        for (auto& e:_entries)if (!e.detail)sum+=e.bytes;
+        return sum;
+    }
+    /** @brief the total of the lines that scale in a given way */
+    uint64_t total(scaling scale){
+        uint64_t sum=0;
+        for (auto& e:_entries)if (!e.detail && e.scale==scale)sum+=e.bytes;
+        return sum;
+    }
+    /** @brief the memory really taken up by an object made with new, including the allocator's header
+        @param p a pointer to the object - if null, the size is estimated from sizeof
+        @return the size in bytes */
+    template<typename T> static uint64_t allocatedSize(T* p){
+        if (p==nullptr)return sizeof(T);
+        return malloc_usable_size((void*)p)+sizeof(size_t);
+    }
+    /** @brief the resident set size - memory the program is actually using now, in bytes */
+    static uint64_t residentBytes(){
+        return procStatus("VmRSS:");
+    }
+    /** @brief the largest resident set size so far, in bytes
+        @details This uses getrusage, which is a cheap system call, so can be used every step */
+    static uint64_t peakResidentBytes(){
+        rusage usage;
+        getrusage(RUSAGE_SELF,&usage);
+        return uint64_t(usage.ru_maxrss)*1024;
+    }
+    //------------------------------------------------------------------------
+    /** @brief print the table, the RSS, and an estimate of the memory needed for a run of a given size
+        @param title printed at the top, e.g. "after initialisation"
+        @param nAgents the number of agents in this model
+        @param nPlaces the number of places in this model
+        @param projectedAgents the number of agents to estimate the memory for - places are assumed to grow in proportion */
+    void show(std::string title,uint64_t nAgents,uint64_t nPlaces,uint64_t projectedAgents){
+        const double MB=1024.*1024.;
+        std::cout<<"Memory use "<<title<<":"<<std::endl;
+        std::cout<<"  "<<std::left<<std::setw(32)<<"part"<<std::right<<std::setw(14)<<"items"<<std::setw(12)<<"MB"<<std::setw(14)<<"bytes/item"<<std::setw(14)<<"bytes/agent"<<std::endl;
+        std::cout<<std::fixed<<std::setprecision(1);
+        for (auto& e:_entries){
+            std::cout<<"  "<<std::left<<std::setw(32)<<e.name<<std::right<<std::setw(14)<<e.count<<std::setw(12)<<e.bytes/MB
+                     <<std::setw(14)<<(e.count>0?double(e.bytes)/e.count:0.)<<std::setw(14)<<(nAgents>0?double(e.bytes)/nAgents:0.)<<std::endl;
+        }
+        uint64_t rss=residentBytes(),peak=peakResidentBytes();
+        std::cout<<"  "<<std::left<<std::setw(32)<<"total accounted for"<<std::right<<std::setw(26)<<total()/MB<<std::setw(28)<<(nAgents>0?double(total())/nAgents:0.)<<std::endl;
+        std::cout<<"  "<<std::left<<std::setw(32)<<"resident (RSS)"<<std::right<<std::setw(26)<<rss/MB<<std::endl;
+        std::cout<<"  "<<std::left<<std::setw(32)<<"peak resident"<<std::right<<std::setw(26)<<peak/MB<<std::endl;
+        std::cout<<"  "<<std::left<<std::setw(32)<<"not accounted for"<<std::right<<std::setw(26)<<(rss>total()?(rss-total())/MB:0.)<<std::endl;
+        if (nAgents>0 && projectedAgents>0){
+            double scale=double(projectedAgents)/nAgents;
+            double projected=total(perAgent)*scale+total(perPlace)*scale+total(fixed);
+            std::cout<<"  Estimated for "<<projectedAgents<<" agents (and "<<uint64_t(nPlaces*scale)<<" places): "
+                     <<projected/(1024*MB)<<" GB, plus whatever is not accounted for"<<std::endl;
+        }
+        std::cout<<std::defaultfloat<<std::setprecision(6);
+    }
+};
+#endif // MEMORYREPORT_H_INCLUDED
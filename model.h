@@ -1,7 +1,11 @@
 #ifndef MODEL_H_INCLUDED
 #define MODEL_H_INCLUDED
 #include<filesystem>
+#include<unordered_map>
+#include<unordered_set>
+#include<iomanip>
 #include<omp.h>
+#include<unistd.h>
 /* A program to model agents moving between places
     Copyright (C) 2021  Mike Bithell
 
@@ -34,6 +38,16 @@
 */
 #include"modelFactory.h"
 #include"timereporter.h"
+#include"asyncWriter.h"
+#include"seriesWriter.h"
+#include"snapshotWriter.h"
+#include"eventLog.h"
+#include"profiler.h"
+#include"memoryReport.h"
+#include"threadAffinity.h"
+#include"placePartition.h"
+#include"adaptiveGrain.h"
+#include"threadTuner.h"
 #ifdef COUPLER
 #include "fetchall.h"
 #endif
@@ -53,8 +67,44 @@ class model{
     std::string _filePrefix;
     /** @brief A string containing any extra default characters to come after the filename */
     std::string _filePostfix;
-    /** @brief The output file stream */
-    std::ofstream output;
+    /** @brief The output file - rows are buffered in memory and written by a background thread, see \ref asyncWriter */
+    asyncWriter output;
+    /** @brief Times each phase of every step, and the busy time of each thread - see \ref profiler */
+    profiler prof;
+    /** @brief profiler phase numbers for the parts of the step */
+    int _couplerPhase=0,_totalsPhase=0,_outputPhase=0,_placesPhase=0,_coughPhase=0,_diseasePhase=0,_agentsPhase=0;
+    /** @brief totals counted at the start of the current step, added to by every thread */
+    long _infected=0,_recovered=0,_dead=0;
+    /** @brief the owning thread of each place, if places.partitioned is true - see \ref placePartition */
+    placePartition _partition;
+    /** @brief true if each place is only changed by its owning thread */
+    bool _partitioned=false;
+    /** @brief true if the disease and agent updates share out agents dynamically, rather than in equal fixed blocks */
+    bool _dynamicSchedule=false;
+    /** @brief chunk sizes for the dynamically scheduled disease and agent updates, adjusted each step - see \ref adaptiveGrain */
+    adaptiveGrain _diseaseGrain,_agentsGrain;
+    /** @brief picks the number of threads for each phase, if run.tuneThreads is true - see \ref threadTuner */
+    threadTuner _tuner;
+    /** @brief thread tuner phase numbers for the parts of the step - the traveller loops of every phase are tuned together */
+    int _totalsTune=0,_placesTune=0,_coughTune=0,_diseaseTune=0,_agentsTune=0,_travellersTune=0;
+    /** @brief The full path of the output file - kept so that a branch can start from a copy of the output so far */
+    std::string _outputFileName;
+    /** @brief Binary version of the output file, used if outputFormat is binary or both - see \ref seriesWriter */
+    seriesWriter series;
+    /** @brief The full path of the binary output file */
+    std::string _seriesFileName;
+    /** @brief Snapshots of the contamination (and optionally occupancy) of every place - see \ref snapshotWriter */
+    snapshotWriter snapshots;
+    /** @brief Take a snapshot every this many steps - zero for none */
+    int _snapshotInterval=0;
+    /** @brief Log of every infection (when, who and where) - see \ref eventLog */
+    eventLog events;
+    /** @brief Show the memory used by each part of the model after initialisation and at the end of the run - see \ref memoryReport */
+    bool _memoryReport=true;
+    /** @brief The number of agents to estimate the memory for in the memory report */
+    long _projectAgents=0;
+    /** @brief The schedule type the agents were given - a branch only re-initialises schedules if its own value differs */
+    std::string _scheduleType;
     /** @brief variable to hold the random number generator for this model
         @details This is currently directly created with default seed 0, rather than being a singleton (accessible from anywhere in the code)\n
         see \ref randomizerSingleton.h for singleton code. At the moment a singleton is not used as it seems a little tricky in multi-threaded cases\n
@@ -73,6 +123,10 @@ class model{
         For example, one might divide the world into two sections (e.g. North and southern hemisphere) - agents then have to cross domain if they travel \n
         from NH to SH.*/
     MUIcoupler* coupler;
+    /** @brief the time spent in the parallel part of the step since the last rebalance, in seconds - time waiting for other domains is not included */
+    double _computeSeconds=0;
+    /** @brief true if this domain has only its share of a population split between domains (model.columnar.domains>1) - see \ref MUIcoupler::setupSharedPlaces */
+    bool _splitPopulation=false;
 #endif
     /** @brief The name of the MPI domain for use with MUI and this copy of the model */ 
     std::string domain;
@@ -92,7 +146,10 @@ public:
          //If using the MUI coupler, initialise the domain
 #ifdef COUPLER
 
-        coupler=new MUIcoupler(domain);
+        coupler=new MUIcoupler(domain,parameters("coupler.protocol"),parameters.get<int>("coupler.exchangeLag"));
+        //so that travel locations can be given the domain that owns them
+        travelList::domains=coupler->domains();
+        _splitPopulation=parameters("model.type")=="columnar" && parameters.get<int>("model.columnar.domains")>1;
 
 #endif
         leavers=false;
@@ -104,24 +161,157 @@ public:
             randomizer r(parameters.get<int>("run.randomSeed")+i);
             randoms.push_back(r);
         }
+        //pin the threads before anything is created, so that each thread stays next to the memory it first touches
+        threadAffinity::pin(parameters("run.pinThreads"),parameters.get<int>("run.nThreads"));
 
         //create the directories and paths for the current experiment
         setOutputFilePaths(parameters);
-        //output file
-        output.open(_filePrefix+parameters("outputFile")+_filePostfix+".csv");
-        //header line
-        output<<"step,time(hours),susceptible,infected,recovered,dead"<<std::endl;
+        //start the timeline before anything else, so it includes the set-up and the background writers
+        if (parameters.get<bool>("trace.enabled")){
+            //a ring for each OpenMP thread, plus some for the background writers - a writer that ends hands its ring on to the next one
+            //started, so scenario branches opening their own writers don't run out (see traceRecorder::nameThread)
+            traceRecorder::enable(parameters.get<long>("trace.eventsPerThread"),std::max(omp_get_max_threads(),parameters.get<int>("run.nThreads"))+16);
+            traceRecorder::setProcess(getpid(),"mopatop "+domain);
+        }else{
+            traceRecorder::disable();
+        }
+        //output files - csv, binary or both
+        _outputFileName=_filePrefix+parameters("outputFile")+_filePostfix+".csv";
+        _seriesFileName=_filePrefix+parameters("outputFile")+_filePostfix+".mts";
+        std::string format=parameters("outputFormat");
+        if (format!="csv" && format!="binary" && format!="both"){
+            std::cout<<"Unknown outputFormat "<<format<<" - should be csv, binary or both"<<std::endl;
+            exit(1);
+        }
+        if (format!="binary"){
+            output.open(_outputFileName);
+            //header line
+            output<<"step,time(hours),susceptible,infected,recovered,dead\n";
+        }
+        if (format!="csv"){
+            series.open(_seriesFileName,{"step","time(hours)","susceptible","infected","recovered","dead"},{'i','d','i','i','i','i'});
+        }
+        _scheduleType=parameters("schedule.type");
         //Initialisation can be slow - check the timing
         auto start=timeReporter::getTime();
         init(parameters,domain);
+        openSnapshots(parameters);
+        openEventLog(parameters);
+        setupProfiler(parameters);
+        setupPartition(parameters);
+        setupSchedule(parameters);
+#ifdef COUPLER
+        coupler->setupSharedPlaces(_splitPopulation,agents,places);
+        coupler->setupRebalance(parameters.get<int>("coupler.rebalanceInterval"),parameters.get<double>("coupler.rebalanceTolerance"),
+                                parameters.get<int>("coupler.rebalanceCooldown"),places);
+#endif
         auto end=timeReporter::getTime();
         timeReporter::showInterval("Initialisation took: ", start,end);
+        reportMemory("after initialisation");
+    }
+    //------------------------------------------------------------------------
+    /** @brief Constructor for a scenario branch - copy the complete state of an existing model part way through a run
+        @details This allows a set of scenarios that share the same start (e.g. some weeks of baseline spread) to only run that start once.\n
+        The base model is run up to the branch step, and then one copy is made for each scenario - see \ref main.cpp.\n
+        Places and agents are copied in parallel and agent place pointers are re-directed to the copied places, so the branch is completely independent\n
+        of the base model. The random number generators are copied too, so that any differences between branches come only from their parameters.\n
+        The branch parameters are applied to the places, and to the agent schedules if the schedule type differs from the base model\n
+        (static classes such as \ref disease need to be set up with the branch parameters by the caller).\n
+        Output goes to the sub-directory branch_nnnn of the base model run directory, starting with a copy of the base output so far.\n
+        Branching is not currently possible when using the MPI coupler, as the copy would need its own partner on the remote domain.
+        @param base The model to be copied - should be at the end of a complete timestep
+        @param parameters The parameter settings for this branch
+        @param branchNumber Used to label the branch output directory */
+    model(model& base,parameterSettings& parameters,int branchNumber):domain(base.domain){
+#ifdef COUPLER
+        std::cout<<"Scenario branches cannot be used with the MPI coupler"<<std::endl;
+        assert(false);
+#endif
+        auto start=timeReporter::getTime();
+        nAgents=base.nAgents;
+        leavers=base.leavers;
+        r=base.r;
+        randoms=base.randoms;
+        //output goes in a sub-directory of the base run, starting from the base output up to this point
+        std::stringstream ss;
+        ss<<"branch_"<<std::setfill('0')<<std::setw(4)<<branchNumber;
+        _filePrefix=base._filePrefix+ss.str()+"/";
+        _filePostfix=base._filePostfix;
+        if (!std::filesystem::exists(_filePrefix))std::filesystem::create_directories(_filePrefix);
+        std::cout<<"Branch outputfiles will be named "<<_filePrefix<<"<Data Name>"<<_filePostfix<<".<filenameExtension>"<<std::endl;
+        parameters.saveParameters(_filePrefix);
+        base.flush();
+        _outputFileName=_filePrefix+std::filesystem::path(base._outputFileName).filename().string();
+        _seriesFileName=_filePrefix+std::filesystem::path(base._seriesFileName).filename().string();
+        if (base.output.is_open()){
+            std::filesystem::copy_file(base._outputFileName,_outputFileName,std::filesystem::copy_options::overwrite_existing);
+            output.open(_outputFileName,true);
+        }
+        if (base.series.is_open()){
+            std::filesystem::copy_file(base._seriesFileName,_seriesFileName,std::filesystem::copy_options::overwrite_existing);
+            series.open(_seriesFileName,{"step","time(hours)","susceptible","infected","recovered","dead"},{'i','d','i','i','i','i'},true);
+        }
+        //copy the places, with branch values for the contamination parameters
+        double fractionalDecrement=parameters.get<double>("places.disease.simplistic.fractionalDecrement");
+        bool clean=parameters.get<bool>("places.cleanContamination");
+        places.resize(base.places.size());
+        placePartition::parallelBlocks(places.size(),[&](long i){
+            places[i]=new place(*base.places[i]);
+            places[i]->setFractionalDecrement(fractionalDecrement);
+            if (clean)places[i]->setCleanEveryStep();else places[i]->unsetCleanEveryStep();
+        });
+        //look-up from base places to their copies, so that agents can be pointed at the right place
+        std::unordered_map<place*,place*> copyOf;
+        copyOf.reserve(places.size());
+        for (long i=0;i<places.size();i++)copyOf[base.places[i]]=places[i];
+        _scheduleType=parameters("schedule.type");
+        bool newSchedule=(_scheduleType!=base._scheduleType);
+        copyAgents(base.agents,agents,copyOf,parameters,newSchedule);
+        copyAgents(base.travellers,travellers,copyOf,parameters,newSchedule);
+        //branch snapshots, events and timings start from the branch step - earlier ones are in the base run directory
+        openSnapshots(parameters);
+        openEventLog(parameters);
+        setupProfiler(parameters);
+        setupPartition(parameters);
+        setupSchedule(parameters);
+        auto end=timeReporter::getTime();
+        timeReporter::showInterval("Branch copy took: ", start,end);
     }
     //------------------------------------------------------------------------
-    /** @brief destructor - make sure output files are properly closed */
+    /** @brief destructor - make sure output files are properly closed, and free the agents and places */
     ~model(){
         output.close();
+        series.close();
+        snapshots.close();
+        events.close();
         randoms.clear();
+        #pragma omp parallel for
+        for (long i=0;i<agents.size();i++)delete agents[i];
+        for (auto a:travellers)delete a;
+        #pragma omp parallel for
+        for (long i=0;i<places.size();i++)delete places[i];
+    }
+    //------------------------------------------------------------------------
+    /** @brief Copy a list of agents for a scenario branch, pointing their places at the copied places
+        @param from The agents to copy
+        @param to The list that will hold the copies
+        @param copyOf A look-up from each original place to its copy
+        @param parameters The branch parameter settings
+        @param newSchedule If true, the copies get their travel schedule set up from the branch parameters*/
+    void copyAgents(std::vector<agent*>& from,std::vector<agent*>& to,std::unordered_map<place*,place*>& copyOf,parameterSettings& parameters,bool newSchedule){
+        to.resize(from.size());
+        placePartition::parallelBlocks(from.size(),[&](long i){
+            //the copy keeps the original ID
+            agent* a=new agent(*from[i]);
+            for (int k=0;k<3;k++){
+                auto p=copyOf.find(a->places[k]);
+                a->places[k]=(p==copyOf.end())?nullptr:p->second;
+                auto c=copyOf.find(a->placeCache[k]);
+                a->placeCache[k]=(c==copyOf.end())?nullptr:c->second;
+            }
+            if (newSchedule)a->initTravelSchedule(parameters);
+            to[i]=a;
+        });
     }
     //------------------------------------------------------------------------
     /** @brief Create the system of directories for model experiments and their outputs
@@ -175,14 +365,34 @@ public:
      */
     void init(parameterSettings& parameters,std::string domain){
         timeStep::reportDate();
+        //agent IDs start from zero in every model run
+        agent::setIDbaseValue(0);
         modelFactory& F=modelFactorySelector::select(parameters("model.type"));
         //create the distribution of agents, places and transport
-        F.createAgents(parameters,agents,places,domain);
+        {
+            traceRecorder::span s("factory","init");
+            F.createAgents(parameters,agents,places,domain);
+        }
         //set off the disease! - some number of agents (default 1) is infected at the start.
-        //shuffle things so agents are allocated at random
-        random_shuffle(agents.begin(),agents.end());
+        //pick agents at random using a shuffled order - the same agents get picked whatever the number of threads
+#ifdef COUPLER
+        //a population split between domains is infected as if it were whole - the agents are picked from all of them, by their ID (their
+        //position in the population file, see columnarFactory)
+        if (_splitPopulation){
+            long total=coupler->sumOverDomains(agents.size());
+            long num=std::min((long)parameters.get<long>("disease.simplistic.initialNumberInfected"),total);
+            randomPermutation shuffle(total,parameters.get<int>("run.randomSeed")+1);
+            std::unordered_set<unsigned long> picked;
+            for (long i=0;i<num;i++)picked.insert(shuffle(i));
+            #pragma omp parallel for
+            for (long i=0;i<agents.size();i++)if (picked.count(agents[i]->getID()))agents[i]->becomeInfected();
+            return;
+        }
+#endif
         long num=std::min((long)parameters.get<long>("disease.simplistic.initialNumberInfected"),(long)agents.size());
-        for (long i=0;i<num;i++)agents[i]->becomeInfected();
+        randomPermutation shuffle(agents.size(),parameters.get<int>("run.randomSeed")+1);
+        #pragma omp parallel for
+        for (long i=0;i<num;i++)agents[shuffle(i)]->becomeInfected();
     }
     //------------------------------------------------------------------------
     /** @brief Finish off model including any final output etc. \n
@@ -203,145 +413,506 @@ public:
         }
         //output a summary .csv file
         int stepNumber=parameters.get<int>("run.nSteps");
-        output<<stepNumber<<","<<stepNumber*timeStep::hoursPerTimeStep()<<","<<agents.size()-infected-recovered-dead<<","<<infected<<","<<recovered<<","<<dead<<std::endl;
-        
+        writeSummary(stepNumber,agents.size()-infected-recovered-dead,infected,recovered,dead);
+        flush();
+        prof.setItems(agents.size()+travellers.size());
+        prof.report();
+        prof.write(_filePrefix);
+        _tuner.write(_filePrefix+"threadTuning.csv");
+        std::cout<<"Run time on file I/O in the step loop: "<<prof.totalSeconds(_outputPhase)<<" seconds"<<std::endl;
+        std::cout<<"Background file writing time: "<<output.writeSeconds()+series.writeSeconds()<<" seconds"<<std::endl;
+        if (snapshots.is_open()){
+            snapshots.close();
+            std::cout<<"Background snapshot compression and writing time: "<<snapshots.writeSeconds()<<" seconds"<<std::endl;
+            std::cout<<"Snapshots compressed to "<<100*snapshots.compressionRatio()<<"% of full size"<<std::endl;
+        }
+        if (events.is_open()){
+            events.close();
+            std::cout<<"Infection events logged: "<<events.written()<<", lost for lack of memory: "<<events.dropped()<<std::endl;
+            std::cout<<"Time spent waiting for event log memory: "<<events.blockedSeconds()<<" seconds"<<std::endl;
+        }
+        if (_partitioned){
+            uint64_t local=_partition.local(),routed=_partition.routed();
+            std::cout<<"Contamination updates made by the owning thread: "<<local<<", passed to another thread: "<<routed
+                     <<" ("<<(local+routed>0?100.*routed/(local+routed):0.)<<"% crossed partitions)"<<std::endl;
+        }
+        reportMemory("at the end of the run");
+#ifdef COUPLER
+        coupler->finish();
+#endif
+        if (traceRecorder::enabled()){
+            //the timeline covers the whole program so far - so a base run with scenario branches includes the branches
+            traceRecorder::write(_filePrefix+"trace.json");
+            std::cout<<"Timeline saved with "<<traceRecorder::held()<<" spans ("<<traceRecorder::lost()<<" lost to full buffers)"<<std::endl;
+        }
+    }
+    //------------------------------------------------------------------------
+    /** @brief Name the profiler phases, switch the profiler off if profile.enabled is false, and start the hardware counters if profile.counters is true
+        @param parameters the model parameter settings */
+    void setupProfiler(parameterSettings& parameters){
+        prof.enable(parameters.get<bool>("profile.enabled"));
+        prof.setThreads(std::max(omp_get_max_threads(),parameters.get<int>("run.nThreads")));
+        prof.enableCounters(parameters.get<bool>("profile.counters"));
+        _memoryReport=parameters.get<bool>("memory.report");
+        _projectAgents=parameters.get<long>("memory.projectAgents");
+        prof.enableMemory(_memoryReport);
+#ifdef COUPLER
+        _couplerPhase=prof.phase("coupler");
+#endif
+        _totalsPhase =prof.phase("totals");
+        _outputPhase =prof.phase("output");
+        _placesPhase =prof.phase("places");
+        _coughPhase  =prof.phase("cough");
+        _diseasePhase=prof.phase("disease");
+        _agentsPhase =prof.phase("agents");
+    }
+    //------------------------------------------------------------------------
+    /** @brief If places.partitioned is true, give each place an owning thread, so that contamination is added without atomic updates
+        @details The partition is made for the number of threads the step will run with - if the step is run with a different number\n
+        (e.g. by a test) the shared, atomic, updates are used instead. See \ref placePartition.
+        @param parameters the model parameter settings */
+    void setupPartition(parameterSettings& parameters){
+        _partitioned=parameters.get<bool>("places.partitioned");
+        if (!_partitioned)return;
+        auto start=timeReporter::getTime();
+        _partition.build(agents,places,omp_get_max_threads());
+        timeReporter::showInterval("Places shared out between "+std::to_string(_partition.threads())+" threads in: ",start,timeReporter::getTime());
+    }
+    /** @brief Choose how agents are shared between threads for the disease and agent updates, from run.schedule
+        @details "static" gives each thread the same fixed block of agents in every loop, so the agent update can follow the disease\n
+        with no barrier, each thread keeps to the memory it first touched, and runs are reproducible for a given number of threads.\n
+        "dynamic" hands out chunks of agents as threads become free, which evens out skewed work at the cost of a barrier between the\n
+        two updates, and of reproducibility, as an agent's random numbers then come from whichever thread takes it.
+        @param parameters the model parameter settings */
+    void setupSchedule(parameterSettings& parameters){
+        std::string schedule=parameters("run.schedule");
+        if (schedule!="static" && schedule!="dynamic"){
+            std::cout<<"Unknown run.schedule "<<schedule<<" - should be static or dynamic"<<std::endl;
+            exit(1);
+        }
+        _dynamicSchedule=(schedule=="dynamic");
+        _diseaseGrain.setTarget(parameters.get<double>("run.chunkMicroseconds"));
+        _agentsGrain.setTarget(parameters.get<double>("run.chunkMicroseconds"));
+        //owned places and dynamically scheduled agents have to be shared by the whole team
+        _tuner.setup(parameters.get<bool>("run.tuneThreads"),omp_get_max_threads(),parameters.get<int>("run.tuneRounds"));
+        _totalsTune    =_tuner.add("totals",true);
+        _placesTune    =_tuner.add("places",!_partitioned);
+        _coughTune     =_tuner.add("cough",!_partitioned);
+        _diseaseTune   =_tuner.add("disease",!_dynamicSchedule);
+        _agentsTune    =_tuner.add("agents",!_dynamicSchedule);
+        _travellersTune=_tuner.add("travellers",true);
+    }
+    /** @brief after a dynamically scheduled step, set the chunk sizes for the next from the time each update took */
+    void adaptGrain(){
+        if (!_dynamicSchedule)return;
+        _diseaseGrain.adapt(agents.size()+travellers.size());
+        _agentsGrain.adapt(agents.size()+travellers.size());
+    }
+    /** @brief share a loop between the number of threads chosen by the thread tuner
+        @details the threads used take equal contiguous blocks, and the rest skip the loop. The blocks come from \ref placePartition::blockStart\n
+        rather than from schedule(static), whose split is up to the OpenMP library - so with the whole team each thread gets exactly the\n
+        same block here as in every other loop of the step, including those over the place partition.
+        @param n the number of items
+        @param workers the number of threads to use
+        @param f called with the number of each item */
+    template<typename F> void shareLoop(long n,int workers,F f){
+        workers=std::min(workers,omp_get_num_threads());
+        int t=omp_get_thread_num();
+        if (t>=workers)return;
+        for (long i=placePartition::blockStart(t,workers,n);i<placePartition::blockStart(t+1,workers,n);i++)f(i);
+    }
+    /** @brief give the thread tuner the size of each phase for the coming step */
+    void resizeTuner(){
+        for (int p:{_totalsTune,_coughTune,_diseaseTune,_agentsTune})_tuner.resize(p,agents.size());
+        _tuner.resize(_placesTune,places.size());
+        _tuner.resize(_travellersTune,travellers.size());
+    }
+    /** @brief check whether the owner-computes place updates can be used by the current parallel region */
+    bool usePartition(){
+        return _partitioned && _partition.threads()==omp_get_num_threads();
+    }
+    /** @brief Print the memory used by each part of the model, if memory.report is true, along with an estimate for a run with memory.projectAgents agents
+        @details Agents and places are measured from one sample object each (all agents are the same size, as are all places), including\n
+        the memory allocator's overhead. Agent schedules are held inside each agent (there are no per-agent schedule structures), so they are shown\n
+        as a breakdown of the agent size, along with the place pointers. Remote travel destinations are places, so are included with the places.
+        @param when printed in the heading, e.g. "after initialisation" */
+    void reportMemory(std::string when){
+        if (!_memoryReport)return;
+        memoryReport m;
+        agent* a=agents.empty()?nullptr:agents[0];
+        m.add("agents",agents.size(),agents.size()*memoryReport::allocatedSize(a),memoryReport::perAgent);
+        m.addDetail("place pointers and cache",agents.size(),agents.size()*sizeof(place*)*6);
+        m.addDetail("schedule state",agents.size(),agents.size()*(sizeof(unsigned)+2*sizeof(agent::scheduleTypes)+sizeof(double)));
+        m.add("agent list",agents.capacity(),agents.capacity()*sizeof(agent*),memoryReport::perAgent);
+        agent* t=travellers.empty()?nullptr:travellers[0];
+        m.add("travellers",travellers.size(),travellers.size()*memoryReport::allocatedSize(t),memoryReport::perAgent);
+        m.add("traveller list",travellers.capacity(),travellers.capacity()*sizeof(agent*),memoryReport::perAgent);
+        place* p=places.empty()?nullptr:places[0];
+        m.add("places",places.size(),places.size()*memoryReport::allocatedSize(p),memoryReport::perPlace);
+        m.add("place list",places.capacity(),places.capacity()*sizeof(place*),memoryReport::perPlace);
+        m.add("random number generators",randoms.size(),randoms.size()*sizeof(randomizer),memoryReport::fixed);
+        m.add("summary output buffers",2,output.memoryUsed()+series.memoryUsed(),memoryReport::fixed);
+        m.add("snapshot buffers",snapshots.is_open()?2:0,snapshots.memoryUsed(),memoryReport::perPlace);
+        m.add("infection event log",events.is_open()?1:0,events.memoryUsed(),memoryReport::fixed);
+        m.add("profiler",prof.nSteps(),prof.memoryUsed(),memoryReport::fixed);
+        if (_partitioned)m.add("place partition",_partition.threads(),_partition.memoryUsed(),memoryReport::perPlace);
+        m.add("timeline",traceRecorder::held(),traceRecorder::memoryUsed(),memoryReport::fixed);
+#ifdef COUPLER
+        m.add("coupler exchange buffers (peak)",1,coupler->memoryUsed(),memoryReport::perAgent);
+#endif
+        m.show(when,agents.size()+travellers.size(),places.size(),_projectAgents);
+    }
+    //------------------------------------------------------------------------
+    /** @brief Open the infection event log, if wanted (events.log is true)
+        @param parameters the model parameter settings */
+    void openEventLog(parameterSettings& parameters){
+        if (!parameters.get<bool>("events.log"))return;
+        int nThreads=std::max(omp_get_max_threads(),parameters.get<int>("run.nThreads"));
+        events.open(_filePrefix+"infectionEvents"+_filePostfix+".evt",nThreads,parameters.get<long>("events.memoryBudgetMB"),parameters("events.policy"));
+    }
+    //------------------------------------------------------------------------
+    /** @brief Open the place snapshot file, if snapshots are wanted (snapshot.interval > 0)
+        @param parameters the model parameter settings */
+    void openSnapshots(parameterSettings& parameters){
+        _snapshotInterval=parameters.get<int>("snapshot.interval");
+        if (_snapshotInterval<=0)return;
+        std::vector<uint64_t> IDs(places.size());
+        for (long i=0;i<places.size();i++)IDs[i]=places[i]->getID();
+        snapshots.open(_filePrefix+"placeSnapshots"+_filePostfix+".snp",IDs,parameters.get<bool>("snapshot.occupancy"));
+    }
+    //------------------------------------------------------------------------
+    /** @brief Copy the current state of every place into a snapshot buffer, to be compressed and written in the background
+        @param stepNumber the current step */
+    void takeSnapshot(long stepNumber){
+        uint64_t* buffer=snapshots.buffer();
+        long n=places.size();
+        bool occupancy=(snapshots.nColumns()>1);
+        #pragma omp parallel for
+        for (long i=0;i<n;i++){
+            double c=places[i]->getContaminationLevel();
+            memcpy(buffer+i,&c,sizeof(double));
+            if (occupancy)buffer[n+i]=places[i]->getNumberOfOccupants();
+        }
+        snapshots.submit(stepNumber);
+    }
+    //------------------------------------------------------------------------
+    /** @brief add one row to the summary output, in whichever of the csv and binary formats are in use
+        @param stepNumber the current step
+        @param susceptible the number of agents that have not yet had the disease
+        @param infected the number currently infected
+        @param recovered the number recovered
+        @param dead the number that have died */
+    void writeSummary(long stepNumber,unsigned long susceptible,long infected,long recovered,long dead){
+        if (output.is_open())output<<stepNumber<<","<<stepNumber*timeStep::hoursPerTimeStep()<<","<<susceptible<<","<<infected<<","<<recovered<<","<<dead<<"\n";
+        if (series.is_open())series.row({stepNumber,stepNumber*timeStep::hoursPerTimeStep(),susceptible,infected,recovered,dead});
+    }
+    //------------------------------------------------------------------------
+    /** @brief make sure all output so far is written to disk
+        @details Output is otherwise only written when the in-memory buffer fills up, so call this before reading the output files, or at a checkpoint */
+    void flush(){
+        output.flush();
+        series.flush();
     }
     //------------------------------------------------------------------------
     /** @brief Advance the model time step \n
     *   @details split up the timestep into update of places, contamination of places by agents, infection and progress of disease and finally update of agent locations \n
-        These loops are separated so they can be individually timed and so that they can in principle be individually parallelised with openMP \n
-        Also to avoid any systematic biases, agents need to all finish their contamination step before any can get infected. 
+        These phases are separated so they can be individually timed (see \ref profiler).\n
+        All the phases run inside one openMP parallel region, so the threads are started once per step rather than once per loop, and the threads\n
+        only wait for each other where the next phase depends on the last:-\n
+        - counting the totals only reads the agents, so threads go straight on to update the places\n
+        - places must finish losing contamination before agents add more, so there is a barrier after the place update\n
+        - to avoid any systematic biases, agents need to all finish their contamination step before any can get infected - a barrier after the cough\n
+        - disease and the agent update each only change the agent itself, and use the same static schedule, so each thread updates exactly the\n
+          agents whose disease it has just processed and can carry straight on. With run.schedule dynamic, or if the thread tuner has chosen\n
+          different thread counts for the two (see \ref threadTuner), there is a barrier between them instead.\n
+        The summary line is written after the region, using the totals counted at the start of the step. A snapshot (if due) is taken before the region,\n
+        as it needs the place contamination at the start of the step.
         @param stepNumber The timestep number passed in from the model class
         @param parameters A \b reference to a class that holds all the possible parameter settings for the model.\n Using a reference ensures the values don't need to be copied*/
     void step(int stepNumber, parameterSettings& parameters){
-
+        prof.startStep(stepNumber);
+        traceRecorder::span stepSpan("step","step");
 #ifdef COUPLER
         //If using the MUI coupler, exchange data. agents may leave to become travellers, and travellers may return
-        coupler->exchange(stepNumber,agents,travellers,leavers);
+        exchange(stepNumber);
+        //every so often, move agents from the slowest domains to the quickest
+        rebalance(stepNumber);
 #endif
         //count tests whether anything needs to be exchanged with the coupler *from* this domain - still need to run coupler to check for arrivals
         leavers=false;
 
         //Note where travellers are referred to, these include ONLY agents that have travelled to here from another MUI domain
-        
-        //set some timers so loop relative times can be compared - note disease loop tends to get slower as more agents get infected.
-
-        auto start=timeReporter::getTime();
-        auto end=start;
 
+        //note disease loop tends to get slower as more agents get infected.
+        if (_snapshotInterval>0 && stepNumber%_snapshotInterval==0){
+            profiler::scope timer(prof,_outputPhase);
+            takeSnapshot(stepNumber);
+        }
+        _infected=0;_recovered=0;_dead=0;
+        resizeTuner();
+        //unless each thread gets the same agents in both loops, the disease update must finish first
+        bool diseaseBarrier=_dynamicSchedule || _tuner.threads(_diseaseTune)!=_tuner.threads(_agentsTune);
+#ifdef COUPLER
+        auto computeStart=timeReporter::getTime();
+#endif
+        #pragma omp parallel
+        {
+            totalsShare(false);
+            placesShare(true);
+#ifdef COUPLER
+            //places used by agents on other domains as well need their contamination added up over the domains
+            if (coupler->sharesPlaces())coupler->noteContamination();
+#endif
+            coughShare(true);
+#ifdef COUPLER
+            if (coupler->sharesPlaces())coupler->shareContamination();
+#endif
+            diseaseShare(stepNumber,diseaseBarrier);
+            agentsShare(false);
+        }
+#ifdef COUPLER
+        _computeSeconds+=std::chrono::duration<double>(timeReporter::getTime()-computeStart).count();
+#endif
+        adaptGrain();
+        _tuner.endStep(stepNumber);
+        for (int p:{_totalsPhase,_placesPhase,_coughPhase,_diseasePhase,_agentsPhase})prof.finishPhase(p);
+        {
+            profiler::scope timer(prof,_outputPhase);
+            //output a summary line - this just formats the line into memory, the actual writing is done in the background
+            writeSummary(stepNumber,agents.size()-_infected-_recovered-_dead,_infected,_recovered,_dead);
+        }
 
-        //timereporters are used to check how long parts of the model take to run...at least for the first step
-        if (stepNumber==0)start=timeReporter::getTime();
-        //counts the totals
-        long infected=0,recovered=0,dead=0;
+        //show places - just for testing really so commented out at present
+        for (long i=0;i<places.size();i++){
+            //places[i]->show();
+        }
+        //The timestep class needs to know the current time step so that this can be used in thing like calculating the day of the week
+        timeStep::update();
+    }
+    //------------------------------------------------------------------------
+    //The phases of a step, each in its own parallel region - so that they can be run and timed separately (see tools/benchmark.cpp)
+    //------------------------------------------------------------------------
+    /** @brief count the agents (and travellers) that are infected, recovered and dead
+        @param infected set to the number currently infected
+        @param recovered set to the number recovered
+        @param dead set to the number dead */
+    void countTotals(long& infected,long& recovered,long& dead){
+        _infected=0;_recovered=0;_dead=0;
+        #pragma omp parallel
+        totalsShare(true);
+        prof.finishPhase(_totalsPhase);
+        infected=_infected;recovered=_recovered;dead=_dead;
+    }
+    /** @brief update the places - changes contamination level */
+    void updatePlaces(){
+        #pragma omp parallel
+        placesShare(true);
+        prof.finishPhase(_placesPhase);
+    }
+    /** @brief every active agent contaminates its current place */
+    void coughAll(){
+        #pragma omp parallel
+        coughShare(true);
+        prof.finishPhase(_coughPhase);
+    }
+    /** @brief the disease progresses in every active agent - new infections are logged if the event log is open
+        @param stepNumber the current time step, saved with each infection event */
+    void processDisease(int stepNumber){
+        #pragma omp parallel
+        diseaseShare(stepNumber,true);
+        prof.finishPhase(_diseasePhase);
+        if (_dynamicSchedule)_diseaseGrain.adapt(agents.size()+travellers.size());
+    }
+    /** @brief agents move around and do other things in a location
+        @details if either agents or travellers indicate they want to leave the domain at the start of the next step, the leavers flag is set. */
+    void updateAgents(){
+        #pragma omp parallel
+        agentsShare(true);
+        prof.finishPhase(_agentsPhase);
+        if (_dynamicSchedule)_agentsGrain.adapt(agents.size()+travellers.size());
+    }
+#ifdef COUPLER
+    /** @brief exchange agents with other MPI domains through the MUI coupler - agents may leave to become travellers, and travellers may return
+        @param stepNumber the current time step */
+    void exchange(int stepNumber){
+        profiler::scope timer(prof,_couplerPhase);
+        coupler->exchange(stepNumber,agents,travellers,leavers);
+    }
+    /** @brief if a rebalance is due, move agents between MPI domains so that each takes about the same time - see \ref MUIcoupler::rebalance
+        @details the place partition (if used) is made again if any agents came or went, as the blocks of agents handled by each thread change
+        @param stepNumber the current time step */
+    void rebalance(int stepNumber){
+        if (!coupler->rebalanceDue(stepNumber))return;
+        profiler::scope timer(prof,_couplerPhase);
+        long moved=coupler->rebalance(stepNumber,agents,places,_computeSeconds);
+        if (moved>0 && _partitioned)_partition.build(agents,places,omp_get_max_threads());
+        _computeSeconds=0;
+    }
+#endif
+private:
+    //------------------------------------------------------------------------
+    //Each thread's share of the phases - called by every thread of a parallel region. The loops use nowait, and the profiler::teamScope
+    //records how long each thread was busy, then waits at a barrier only if asked to. Travellers are often absent, so their loops are
+    //skipped when empty (every thread sees the same size, so they all skip together).
+    //Every loop shares its items out in the blocks given by placePartition::blockStart - the same ones used when the agents and places were
+    //created (see modelFactory.h) - so each thread works on the objects it first touched, whose memory is on its own socket (as long as
+    //threads are pinned, see run.pinThreads).
+    //If run.tuneThreads is true a phase may be run on just the first few threads, the rest skipping straight on (see shareLoop).
+    //------------------------------------------------------------------------
+    /** @brief count the totals into _infected, _recovered and _dead - these must be zeroed first
+        @param barrier true if the threads should wait for each other at the end */
+    void totalsShare(bool barrier){
+        profiler::teamScope timer(prof,_totalsPhase,barrier);
         //accumulate totals - at the start of the step - so the step 0 is initial data
-        //NB in very large runs (100s of millions of agents) this becomes very inefficient - so use a reduction
-        #pragma omp parallel for reduction(+:infected,recovered,dead) 
-        for (long i=0;i<agents.size();i++){
-            if (agents[i]->active()){
-                if (agents[i]->alive()){
-                    if (agents[i]->diseased())infected++;
-                    if (agents[i]->recovered())recovered++;
+        //each thread counts its own share, then adds it in once
+        long infected=0,recovered=0,dead=0;
+        auto count=[&](agent* a){
+            if (a->active()){
+                if (a->alive()){
+                    if (a->diseased())infected++;
+                    if (a->recovered())recovered++;
                 }else{
                     dead++;
                 }
             }
+        };
+        {
+            threadTuner::scope tuneTimer(_tuner,_totalsTune);
+            shareLoop(agents.size(),_tuner.threads(_totalsTune),[&](long i){count(agents[i]);});
         }
         //travellers have come here from a remote MPI domain
-        #pragma omp parallel for reduction(+:infected,recovered,dead) 
-        for (long i=0;i<travellers.size();i++){
-            if (travellers[i]->active()){
-                if (travellers[i]->alive()){
-                    if (travellers[i]->diseased())infected++;
-                    if (travellers[i]->recovered())recovered++;
-                }else{
-                    dead++;
-                }
-            }
-        }
-        if (stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Run time on accumulating disease totals: ",start,end);
-            start=end;
+        if (!travellers.empty()){
+            threadTuner::scope tuneTimer(_tuner,_travellersTune);
+            shareLoop(travellers.size(),_tuner.threads(_travellersTune),[&](long i){count(travellers[i]);});
         }
-        //output a summary .csv file
-        output<<stepNumber<<","<<stepNumber*timeStep::hoursPerTimeStep()<<","<<agents.size()-infected-recovered-dead<<","<<infected<<","<<recovered<<","<<dead<<std::endl;
-        //update the places - changes contamination level
-        //note the pragma statement here allows openmp to parallelise this loop over several threads 
-        #pragma omp parallel for
-        for (long i=0;i<places.size();i++){
-            places[i]->update();
+        #pragma omp atomic
+        _infected+=infected;
+        #pragma omp atomic
+        _recovered+=recovered;
+        #pragma omp atomic
+        _dead+=dead;
+    }
+    /** @brief update the places
+        @param barrier true if the threads should wait for each other at the end */
+    void placesShare(bool barrier){
+        profiler::teamScope timer(prof,_placesPhase,barrier);
+        if (usePartition()){
+            //each thread updates just the places it owns
+            for (auto p:_partition.owned(omp_get_thread_num()))p->update();
+            return;
         }
-        if (stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Time updating places: ",start,end);
-            start=end;
+        threadTuner::scope tuneTimer(_tuner,_placesTune);
+        shareLoop(places.size(),_tuner.threads(_placesTune),[&](long i){places[i]->update();});
+    }
+    /** @brief agents contaminate their places
+        @param barrier true if the threads should wait for each other at the end */
+    void coughShare(bool barrier){
+        if (usePartition()){
+            coughPartitioned(barrier);
+            return;
         }
-        //do disease - synchronous update (i.e. all agents contaminate before getting infected) so that no agent gets to infect ahead of others.
+        profiler::teamScope timer(prof,_coughPhase,barrier);
         //alternatively could be randomized...depends on the idea of how a location works...places could be sub-divided to mimic spatial extent for example.
-        #pragma omp parallel for
-        for (long i=0;i<agents.size();i++){
-            if (agents[i]->active())agents[i]->cough();
+        {
+            threadTuner::scope tuneTimer(_tuner,_coughTune);
+            shareLoop(agents.size(),_tuner.threads(_coughTune),[&](long i){if (agents[i]->active())agents[i]->cough();});
         }
-        #pragma omp parallel for
-        for (long i=0;i<travellers.size();i++){
-            if (travellers[i]->active())travellers[i]->cough();
+        if (!travellers.empty()){
+            threadTuner::scope tuneTimer(_tuner,_travellersTune);
+            shareLoop(travellers.size(),_tuner.threads(_travellersTune),[&](long i){if (travellers[i]->active())travellers[i]->cough();});
         }
-        if(stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Run time coughing: ",start,end);
-            start=end;
+    }
+    /** @brief agents contaminate their places, with each place only changed by its owning thread - see \ref placePartition
+        @details Contamination for places owned by another thread is queued, and applied by the owner after a barrier.
+        @param barrier true if the threads should wait for each other at the end */
+    void coughPartitioned(bool barrier){
+        int t=omp_get_thread_num();
+        {
+            profiler::teamScope timer(prof,_coughPhase,true);
+            long n=agents.size();
+            for (long i=_partition.first(t,n);i<_partition.first(t+1,n);i++){
+                if (agents[i]->active())_partition.contaminate(t,agents[i]->getCurrentPlace(),agents[i]->shedding());
+            }
+            n=travellers.size();
+            for (long i=_partition.first(t,n);i<_partition.first(t+1,n);i++){
+                if (travellers[i]->active())_partition.contaminate(t,travellers[i]->getCurrentPlace(),travellers[i]->shedding());
+            }
         }
-        //the disease progresses
+        profiler::teamScope timer(prof,_coughPhase,barrier);
+        _partition.deliver(t);
+    }
+    /** @brief the disease progresses - uses a static schedule, so that \ref agentsShare can follow without a barrier, unless run.schedule is dynamic
+        @param stepNumber the current time step, saved with each infection event
+        @param barrier true if the threads should wait for each other at the end */
+    void diseaseShare(int stepNumber,bool barrier){
+        profiler::teamScope timer(prof,_diseasePhase,barrier);
         //This is faster here using an RNG separate for each thread
-        #pragma omp parallel for
-        for (long i=0;i<agents.size();i++){
-            if (agents[i]->active())agents[i]->process_disease(randoms[omp_get_thread_num()]);
-            //agents[i]->process_disease(randoms[0]);
+        //new infections can be logged - each thread has its own event buffer, so this needs no locks
+        bool logging=events.is_open();
+        int t=omp_get_thread_num();
+        auto disease=[&](agent* a){
+            if (a->active() && a->process_disease(randoms[t]) && logging){
+                events.record(t,stepNumber,a->getID(),a->getCurrentPlace()->getID(),a->currentPlace);
+            }
+        };
+        if (_dynamicSchedule){
+            //infections cluster in contaminated places, so some chunks of agents cost far more than others
+            int64_t start=adaptiveGrain::now();
+            #pragma omp for schedule(dynamic,_diseaseGrain.grain(agents.size(),omp_get_num_threads())) nowait
+            for (long i=0;i<agents.size();i++)disease(agents[i]);
+            if (!travellers.empty()){
+                #pragma omp for schedule(dynamic,_diseaseGrain.grain(travellers.size(),omp_get_num_threads())) nowait
+                for (long i=0;i<travellers.size();i++)disease(travellers[i]);
+            }
+            _diseaseGrain.record(adaptiveGrain::now()-start);
+            return;
         }
-        #pragma omp parallel for
-        for (long i=0;i<travellers.size();i++){
-            if (travellers[i]->active())travellers[i]->process_disease(randoms[omp_get_thread_num()]);
+        {
+            threadTuner::scope tuneTimer(_tuner,_diseaseTune);
+            shareLoop(agents.size(),_tuner.threads(_diseaseTune),[&](long i){disease(agents[i]);});
         }
-        if (stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Run time being diseased: ",start,end);
-            start=end;
+        if (!travellers.empty()){
+            threadTuner::scope tuneTimer(_tuner,_travellersTune);
+            shareLoop(travellers.size(),_tuner.threads(_travellersTune),[&](long i){disease(travellers[i]);});
         }
-        //move around, do other things in a location
-        // if either agents or travellers indicate they want to leave the domain at the start of the next step, set leavers flag.
-        #pragma omp parallel for 
-        for (long i=0;i<agents.size();i++){
-            if (agents[i]->active()){
-                agents[i]->update();
-                if (agents[i]->leaver()) leavers=true;;
+    }
+    /** @brief agents move - uses the same static schedule as \ref diseaseShare, so each thread updates the agents whose disease it processed
+        @details with run.schedule dynamic, chunks of agents are handed out as threads become free instead
+        @param barrier true if the threads should wait for each other at the end */
+    void agentsShare(bool barrier){
+        profiler::teamScope timer(prof,_agentsPhase,barrier);
+        bool leaving=false;
+        auto move=[&](agent* a){
+            if (a->active()){
+                a->update();
+                if (a->leaver()) leaving=true;
             }
-        }
-        #pragma omp parallel for 
-        for (long i=0;i<travellers.size();i++){
-            if (travellers[i]->active()){
-                travellers[i]->update();
-                if (travellers[i]->leaver()) leavers=true;
+        };
+        if (_dynamicSchedule){
+            int64_t start=adaptiveGrain::now();
+            #pragma omp for schedule(dynamic,_agentsGrain.grain(agents.size(),omp_get_num_threads())) nowait
+            for (long i=0;i<agents.size();i++)move(agents[i]);
+            if (!travellers.empty()){
+                #pragma omp for schedule(dynamic,_agentsGrain.grain(travellers.size(),omp_get_num_threads())) nowait
+                for (long i=0;i<travellers.size();i++)move(travellers[i]);
+            }
+            _agentsGrain.record(adaptiveGrain::now()-start);
+        }else{
+            {
+                threadTuner::scope tuneTimer(_tuner,_agentsTune);
+                shareLoop(agents.size(),_tuner.threads(_agentsTune),[&](long i){move(agents[i]);});
+            }
+            if (!travellers.empty()){
+                threadTuner::scope tuneTimer(_tuner,_travellersTune);
+                shareLoop(travellers.size(),_tuner.threads(_travellersTune),[&](long i){move(travellers[i]);});
             }
         }
-        if (stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Run time updating agents: ",start,end);
-            start=end;
-        }
-        //show the step number every 10 steps
-        if (stepNumber==0){
-            end=timeReporter::getTime();
-            timeReporter::showInterval("Run time on file I/O: ",start,end);
-        }
-      
-        //show places - just for testing really so commented out at present
-        for (long i=0;i<places.size();i++){
-            //places[i]->show();
+        if (leaving){
+            #pragma omp atomic write
+            leavers=true;
         }
-        //The timestep class needs to know the current time step so that this can be used in thing like calculating the day of the week
-        timeStep::update();
     }
+public:
     /** @brief report current number of agents in the model - includes both active and inactive */
     unsigned long numberOfAgents(){
         return agents.size();
@@ -3,6 +3,17 @@
 #include "agent.h"
 #include "places.h"
 #include "remoteTravel.h"
+#include "permutation.h"
+#include "populationFile.h"
+#include "domainPartition.h"
+#include "placePartition.h"
+#include<fstream>
+#include<sstream>
+#include<algorithm>
+#include<climits>
+#ifdef COUPLER
+#include<mpi.h>
+#endif
 /* A program to model agents moving between places
     Copyright (C) 2021  Mike Bithell
 
@@ -40,12 +51,24 @@ class travelList{
 public:
     /** @brief a keyed list of travel locations using their \b unique name */
     static std::map<std::string,remoteTravel*> travelLocations;
+    /** @brief the names of all the MPI domains, in rank order - set from \ref MUIcoupler::domains when coupled, otherwise empty */
+    inline static std::vector<std::string> domains;
+    /** @brief the number of a named domain, to pass to \ref add
+        @param owner the name of the domain the location is on
+        @param here the name of this domain
+        @return the rank of the owning domain, or -1 if it is this domain, or not one of the running domains */
+    static int domainNumber(std::string owner,std::string here){
+        if (owner==here)return -1;
+        auto it=std::find(domains.begin(),domains.end(),owner);
+        if (it==domains.end())return -1;
+        return it-domains.begin();
+    }
     /** @brief static function to add named locations to the list 
         @param name the unique name of the location
         @param parameters the model parmeter settings - needs to be passed to the \ref remoteTravel object
-        @param otherDomain a flag to denote whether this location is actually located in another MPI domain*/
-    static void add(std::string name,parameterSettings& parameters,std::vector<place*>& places,bool otherDomain=false){
-        travelLocations[name]=new remoteTravel(parameters,places,otherDomain);
+        @param domain the MPI domain (its rank) the location is actually located in, or -1 if it is on this domain*/
+    static void add(std::string name,parameterSettings& parameters,std::vector<place*>& places,int domain=-1){
+        travelLocations[name]=new remoteTravel(parameters,places,domain);
     }
 };
 /** @brief The modelFactory itself is a (virtual) base class
@@ -65,6 +88,32 @@ public:
       @param places* A reference to the model object's list of places
         */
     virtual void createAgents(parameterSettings& parameters,std::vector<agent*>& agents,std::vector<place*>& places,std::string domain)=0;
+protected:
+    /** @brief create places in parallel as copies of a prototype place, with IDs the same as their index in the place list
+        @details Copying a prototype is much faster than setting up every place from the parameterSettings (which would otherwise be copied and parsed for each place)\n
+        The place list must already be big enough.
+        @param prototype A place with the required settings
+        @param places A reference to the model object's list of places
+        @param first The index of the first place to create
+        @param last One more than the index of the last place to create*/
+    void createPlaces(place& prototype,std::vector<place*>& places,long first,long last){
+        placePartition::parallelBlocks(last-first,[&](long k){
+            place* p=new place(prototype);
+            p->setID(first+k);
+            places[first+k]=p;
+        });
+    }
+    /** @brief report progress through a (possibly parallel) loop every time another 10% is complete
+        @details Only the iteration that lands on each 10% boundary prints anything, so this is thread-safe without needing a shared counter - \n
+        in parallel loops the numbers may just come out of order.
+        @param i the current loop index
+        @param fraction the number of iterations making up 10% of the loop*/
+    void reportProgress(long i,long fraction){
+        if (i>0 && i%fraction==0){
+            #pragma omp critical
+            std::cout<<i<<"..."<<std::flush;
+        }
+    }
 };
 /** @brief Create a set of agents that all know only about one place, and remain there for all time, irespective of travel schedule\n 
     @details First the place is created, then agents, who all set this one place as home, work and transport. The latter two are set\n
@@ -83,6 +132,7 @@ class simpleOnePlaceFactory:public modelFactory{
       @param places* A reference to the model object's list of places*/
     void createAgents(parameterSettings& parameters,std::vector<agent*>& agents,std::vector<place*>& places,std::string domain){
 
+        long nAgents=parameters.get<long>("run.nAgents");
         std::cout<<"Starting simple one place generator..."<<std::endl;
         std::cout<<"Creating places ...";
         //create homes - just a single location for everyone in this case!
@@ -91,41 +141,37 @@ class simpleOnePlaceFactory:public modelFactory{
         places[0]->setID(0);
         std::cout<<std::endl;
         std::cout<<"Creating agents ...";
-        long k=0;
         //fraction indicates when each extra 10% of agents have been created
-        long fr=parameters.get<long>("run.nAgents")/10;
+        long fr=nAgents/10;
         //check for tiny numbers of agents
-        if (fr==0)fr=parameters.get<long>("run.nAgents");
+        if (fr==0)fr=nAgents;
+        //agent IDs are taken as a block, so they can be set in parallel
+        unsigned long firstID=agent::reserveIDs(nAgents);
         //allocate all agents the same home - no travel in this case
-        agents.resize(parameters.get<long>("run.nAgents"));
-        #pragma omp parallel for
-        for (long i=0;i<parameters.get<long>("run.nAgents");i++){
-            agent* a=new agent();
+        agents.resize(nAgents);
+        placePartition::parallelBlocks(nAgents,[&](long i){
+            agent* a=new agent(firstID+i);
             a->setHome(places[0]);
             //some rules assume that work and tranport exist - set these so as not to cause a model crash
             a->setTransport(places[0]);
             a->setWork(places[0]);
-            //agent internal thread ID counter not thread safe, so set explicitly
-            a->setID(i);
-            k++;
-            if (k%fr==0)std::cout<<k<<"...";
+            //set up travel schedule - same for every agent at the moment -  at home at exactly the same times
+            a->initTravelSchedule(parameters);
+            reportProgress(i,fr);
             agents[i]=a;
-        }
+        });
         std::cout<<std::endl;
-
-        //set up travel schedule - same for every agent at the moment -  at home at exactly the same times
-        #pragma omp parallel for
-        for (long i=0;i<agents.size();i++){
-            agents[i]->initTravelSchedule(parameters);
-        }
         //report intialization to std out 
         std::cout<<"Built "<<agents.size()<<" agents and "<<places.size()<<" places."<<std::endl;
 
     }
 };
 /** @brief Create a set of agents that all have three places they know about, home, work and transport\n 
-    @details First the home place is created, then agents, who all set this one place as home. Work places and transport vary by agent \n
+    @details First all the places are created - homes, then workplaces, then transport. Then the agents are created and given their places, all in a single parallel loop. \n
     Currently there are 3 agenst per home, 10 agents per work place, and 30 per tranport (a bus!)\n
+    Agents are put into homes in order. So that household members get different workplaces, work and transport are allocated using a \ref randomPermutation\n
+    of the agents (seeded with run.randomSeed) rather than shuffling the agent list - this can be done in parallel, and gives the same population whatever the number of threads.\n
+    Since work and transport use the same permutation, those in similar workplaces will tend to share buses.\n
     If the travel schedule is set to stationary, however, only the home place will get used.\n
      \ref modelFactorySelector knows this as "simpleMobile".Use this class by creating a pointer to the sub-class:-
      \code
@@ -152,7 +198,7 @@ class simpleMobileFactory:public modelFactory{
         long nHomes=nAgents/agentsPerHome+excess;
         //now get number of workplaces
         excess=((nAgents % agentsPerWorkPlace)>0);//as with homes, allow for not divisible by 10
-        int nWork=nAgents/agentsPerWorkPlace+excess;
+        long nWork=nAgents/agentsPerWorkPlace+excess;
         //and number of transport vehciles, assumed buses
         excess=((nAgents % agentsPerBus)>0);//allow for not exactly 30 agents per bus
         long nBus=nAgents/agentsPerBus+excess;
@@ -162,99 +208,350 @@ class simpleMobileFactory:public modelFactory{
         if (nBus==0) nBus=1;
         //faster to resize the array here, then create places in a parallel loop (individual place memory allocations get done in parallel, but loop is thread-safe)
         //Currently 4.5e9 agents + 2.1 e9 places on 64 threads on HPC takes about 45 minutes.
-        //one could also subdivide this resizing and gain something in speed by making indiviual sub-vectors on each thread in an omp parallel loop then concatenating them in an omp critical section?
-        //something like this might gain a little bit: - but only seems to save about a minute on the above time...
-        //#pragma omp parallel
-        //{
-        //    long z=(nHomes+nWork+nBus)/omp_get_num_threads();//allocate part of the vector on each thread
-        //    //this variable is private to the thread
-        //    std::vector<place*> vec_private(z);
-        //    //add to the global vector, but avoid races.
-        //    #pragma omp critical
-        //    places.insert(places.end(), vec_private.begin(), vec_private.end());
-        //}
-        //even so after the above, need to make sure we really are the right size in case the number of threads doesn't exactly divide the the size of the vector
-
         places.resize(nHomes+nWork+nBus);
         
         std::cout<<"Starting simple mobile generator..."<<std::endl;
-        std::cout<<"Creating homes ..."<<std::endl;
+        //all places are copies of this one
+        place prototype(parameters);
+        //homes come first, then work places - (nAgents / agentsPerWorkPlace) - then buses - (nAgents / agentsPerBus) since agentsPerBus agents per bus.
+        //All are made in one loop, so that each thread creates the same block of places it will update in the model step
+        std::cout<<"Creating "<<nHomes<<" homes, "<<nWork<<" workplaces and "<<nBus<<" buses ..."<<std::endl;
+        createPlaces(prototype,places,0,nHomes+nWork+nBus);
 
-        #pragma omp parallel for
-        for (long i=0;i<nHomes;i++){
-            place* p=new place(parameters);
-            p->setID(i);
-            places[i]=p;
-        }
-        
         std::cout<<"Creating agents ...";
-        long k=0;
         //fraction indicates when each extra 10% of agents have been created
         long fr=nAgents/10;
         //check for tiny numbers of agents
         if (fr==0)fr=nAgents;
+        //agent IDs are taken as a block, so they can be set in parallel
+        unsigned long firstID=agent::reserveIDs(nAgents);
+        //shuffled order of agents for allocation to work and transport
+        randomPermutation shuffle(nAgents,parameters.get<int>("run.randomSeed"));
         //allocate agentsPerHome agents per home - as far as possible - any excess over nAgents/agentsPerHome go into the excess Home as defined above (either one or two if agentsPerHome==3 for example)
+        //then agentsPerWorkPlace agents per workplace and agentsPerBus agents per bus, in shuffled order
         agents.resize(nAgents);
-        #pragma omp parallel for
-        for (long i=0;i<nAgents;i++){
-            agent* a=new agent();
-            //set the agent ID explicitly - internal agent ID counter is not thread safe 
-            a->setID(i);
+        placePartition::parallelBlocks(nAgents,[&](long i){
+            agent* a=new agent(firstID+i);
             assert(places[i/agentsPerHome]!=0);
             a->setHome(places[i/agentsPerHome]);
-            k++;
-            if (k%fr==0)std::cout<<k<<"...";         
+            long j=shuffle(i);
+            assert(places[j/agentsPerWorkPlace+nHomes]!=0);
+            a->setWork(places[j/agentsPerWorkPlace+nHomes]);
+            assert(places[j/agentsPerBus+nHomes+nWork]!=0);
+            a->setTransport(places[j/agentsPerBus+nHomes+nWork]);
+            //set up travel schedule - same for every agent at the moment - so agents are all on the bus, at work or at home at exactly the same times
+            a->initTravelSchedule(parameters);
+            reportProgress(i,fr);
             agents[i]=a;
-        }
+        });
         std::cout<<std::endl;
-        //create work places - (nAgents / agentsPerWorkPlace)  as many as agents - add them on to the end of the place list.
-        std::cout<<"Creating workplaces ..."<<std::endl;
+        //report intialization to std out 
+        std::cout<<"Built "<<agents.size()<<" agents and "<<places.size()<<" places."<<std::endl;
+        //create some remote places to travel to - local ones are on this MPI domain, remote ones on another.
+        //Each location is given the domain that owns it - domainNumber gives -1 if that is this domain, otherwise its rank,
+        //so agents going there are sent straight to the right domain however many there are.
+        
+        //on domain b
+        //travelList::add("NewYork",parameters,places,travelList::domainNumber("b",domain));
+        //on domain a
+        //travelList::add("London",parameters,places,travelList::domainNumber("a",domain));
 
-        #pragma omp parallel for
-        for (long i=nHomes;i<nHomes+nWork;i++){
-            place* p=new place(parameters);
-            p->setID(i);          
-            places[i]=p;
+    }
+};
+/** @brief A discrete distribution of sizes for one type of place (e.g. the number of people in each household)
+    @details Sizes are added with a relative weight, being the fraction of places of that type that have that size (the weights need not add up to one).\n
+    Sizes are then drawn at random by picking a uniform random number and finding where it falls in the cumulative weights.
+*/
+class sizeDistribution{
+    /** @brief the possible sizes */
+    std::vector<long> _sizes;
+    /** @brief cumulative weights, normalised once all sizes are added so that the last value is 1 */
+    std::vector<double> _cumulative;
+public:
+    /** @brief add a possible size
+        @param size the number of agents in the place
+        @param weight the relative number of places of this size */
+    void add(long size,double weight){
+        double total=_cumulative.empty()?0:_cumulative.back();
+        _sizes.push_back(size);
+        _cumulative.push_back(total+weight);
+    }
+    /** @brief normalise the cumulative weights - call once all sizes have been added */
+    void normalise(){
+        for (auto& c:_cumulative)c/=_cumulative.back();
+    }
+    /** @brief remove all the sizes */
+    void clear(){
+        _sizes.clear();
+        _cumulative.clear();
+    }
+    /** @brief check whether any sizes have been added */
+    bool empty(){
+        return _sizes.empty();
+    }
+    /** @brief draw a size at random
+        @param r a random number generator
+        @return one of the sizes, picked in proportion to its weight */
+    long draw(randomizer& r){
+        double x=r.number();
+        unsigned k=std::lower_bound(_cumulative.begin(),_cumulative.end(),x)-_cumulative.begin();
+        if (k>=_sizes.size())k=_sizes.size()-1;
+        return _sizes[k];
+    }
+    /** @brief the largest possible size */
+    long maxSize(){
+        return *std::max_element(_sizes.begin(),_sizes.end());
+    }
+};
+/** @brief Create a population using distributions of household, workplace and vehicle sizes read from a table, in the style of a census\n
+    @details The table (set by model.census.sizeTable) has one line per size, each with the place type (home, work or vehicle), a size, and a weight\n
+    giving the relative number of places of that size e.g.
+    \code
+    #type,size,weight
+    home,1,0.29
+    home,2,0.35
+    work,1000,0.0001
+    \endcode
+    Lines starting with # are comments. All three place types are needed. Any distribution can be used, so heavy-tailed workplace sizes are fine.\n
+    Agents are placed into homes in order, and into workplaces and vehicles in an order shuffled by a \ref randomPermutation (the same one for both, so\n
+    agents in a workplace will tend to share vehicles). The agents are taken in chunks (of model.census.chunkSize agents) - within a chunk places are\n
+    filled one after another, each with a size drawn at random, until the chunk is used up (so the last place in a chunk may be a bit smaller than its draw).\n
+    Each chunk has its own random number generator, seeded from the run seed, the place type and the chunk number, so:-\n
+    - chunks can be built in parallel, and the result is the same whatever the number of threads\n
+    - the sizes need not be stored - a first pass over the chunks just counts the places, so that the place list can be allocated, and a second\n
+    pass draws exactly the same sizes again to create the places and allocate the agents. Memory use is then just the agents and places themselves.\n
+     \ref modelFactorySelector knows this as "census".Use this class by creating a pointer to the sub-class:-
+     \code
+     modelFactory* F=new censusFactory();
+     \endcode
+    See \ref modelFactorySelector
+*/
+class censusFactory:public modelFactory{
+    /** @brief the size distributions, in the order home, work, vehicle (the same as \ref agent::placeTypes) */
+    sizeDistribution distributions[3];
+    /** @brief read in the table of sizes
+        @param fileName the path to the table */
+    void readTable(std::string fileName){
+        std::ifstream infile(fileName);
+        if (infile.fail()){
+            std::cout<<"Census size table "<<fileName<<" not found"<<std::endl;
+            exit(1);
         }
-        //shuffle agents so household members get different workplaces - can this be parallelised?
-        random_shuffle(agents.begin(),agents.end());
-        //allocate agentsPerWorkPlace agents per workplace
-        #pragma omp parallel for        
-        for (long i=0;i<agents.size();i++){
-            assert(places[i/agentsPerWorkPlace+nHomes]!=0);
-            agents[i]->setWork(places[i/agentsPerWorkPlace+nHomes]);
+        //the factory may be re-used, so start again each time
+        for (int k=0;k<3;k++)distributions[k].clear();
+        std::string line;
+        while (std::getline(infile,line)){
+            line.erase(std::remove_if(line.begin(), line.end(), ::isspace), line.end());
+            if (line.empty() || line[0]=='#')continue;
+            std::stringstream ss(line);
+            std::string type,size,weight;
+            std::getline(ss,type,',');std::getline(ss,size,',');std::getline(ss,weight,',');
+            int k=-1;
+            if (type=="home")k=agent::home;
+            if (type=="work")k=agent::work;
+            if (type=="vehicle")k=agent::vehicle;
+            if (k<0 || stol(size)<=0 || stod(weight)<0){
+                std::cout<<"Invalid line in census size table "<<fileName<<": "<<line<<std::endl;
+                exit(1);
+            }
+            distributions[k].add(stol(size),stod(weight));
         }
-        std::cout<<"Creating transport ..."<<std::endl;
-        //create buses - (nAgents / agentsPerBus) since agentsPerBus agents per bus. add them to the end of the place list again
-
-        #pragma omp parallel for  
-        for (long i=nHomes+nWork;i<nHomes+nWork+nBus;i++){
-            place* p=new place(parameters);
-            p->setID(i);
-            places[i]=p;
+        for (int k=0;k<3;k++){
+            if (distributions[k].empty()){
+                std::cout<<"Census size table "<<fileName<<" needs at least one size for each of home, work and vehicle"<<std::endl;
+                exit(1);
+            }
+            distributions[k].normalise();
         }
-        //allocate agentsPerBus agents per bus - since agents aren't shuffled again, those in similar workplaces will tend to share buses. 
-        #pragma omp parallel for
-        for (long i=0;i<agents.size();i++){
-            assert(places[i/agentsPerBus+nHomes+nWork]!=0);
-            agents[i]->setTransport(places[i/agentsPerBus+nHomes+nWork]);
+    }
+    /** @brief set up the random number generator for one chunk of one place type
+        @param seed the run random seed
+        @param type the place type
+        @param chunk the chunk number */
+    randomizer chunkRandomizer(int seed,int type,long chunk){
+        return randomizer(int(unsigned(seed)*2654435761u+unsigned(type)*40503u+unsigned(chunk)*2246822519u));
+    }
+    /** @brief count the places needed for each chunk of agents, for one place type
+        @param type the place type
+        @param seed the run random seed
+        @param nAgents the total number of agents
+        @param chunkSize the number of agents per chunk
+        @param first On return, the index in the place list of the first place in each chunk, with one extra value at the end for the total */
+    void countPlaces(int type,int seed,long nAgents,long chunkSize,std::vector<long>& first){
+        long nChunks=(nAgents+chunkSize-1)/chunkSize;
+        first.assign(nChunks+1,0);
+        #pragma omp parallel for schedule(dynamic)
+        for (long c=0;c<nChunks;c++){
+            randomizer r=chunkRandomizer(seed,type,c);
+            long remaining=std::min(chunkSize,nAgents-c*chunkSize);
+            long count=0;
+            while (remaining>0){remaining-=distributions[type].draw(r);count++;}
+            first[c+1]=count;
         }
-        //set up travel schedule - same for every agent at the moment - so agents are all on the bus, at work or at home at exactly the same times
-        #pragma omp parallel for
-        for (long i=0;i<agents.size();i++){
-            agents[i]->initTravelSchedule(parameters);
+        for (long c=0;c<nChunks;c++)first[c+1]+=first[c];
+    }
+    /** @brief method to overlaod the createAgents method in the base class
+        @details This method has to be accessed by creating a pointer to this sub-class.
+        @param parameters A reference to the model parameterSettings object
+        @param agents A reference to the model object's list of agents
+        @param places* A reference to the model object's list of places*/
+    void createAgents(parameterSettings& parameters, std::vector<agent*>& agents,std::vector<place*>& places,std::string domain){
+        long nAgents=parameters.get<long>("run.nAgents");
+        long chunkSize=parameters.get<long>("model.census.chunkSize");
+        if (chunkSize<=0)chunkSize=nAgents;
+        int seed=parameters.get<int>("run.randomSeed");
+        std::cout<<"Starting census generator..."<<std::endl;
+        readTable(parameters("model.census.sizeTable"));
+        long nChunks=(nAgents+chunkSize-1)/chunkSize;
+        //first pass - count places of each type in each chunk, so the place list can be allocated in one go
+        std::vector<long> firstPlace[3];
+        for (int k=0;k<3;k++)countPlaces(k,seed,nAgents,chunkSize,firstPlace[k]);
+        long offset[3]={0,firstPlace[0].back(),firstPlace[0].back()+firstPlace[1].back()};
+        places.resize(offset[2]+firstPlace[2].back());
+        std::cout<<"Creating "<<firstPlace[0].back()<<" homes, "<<firstPlace[1].back()<<" workplaces and "<<firstPlace[2].back()<<" vehicles ..."<<std::endl;
+        place prototype(parameters);
+        createPlaces(prototype,places,0,places.size());
+        //second pass - draw the same sizes again and fill the places
+        std::cout<<"Creating agents ..."<<std::endl;
+        unsigned long firstID=agent::reserveIDs(nAgents);
+        randomPermutation shuffle(nAgents,seed);
+        agents.resize(nAgents);
+        //the agents are made in fixed blocks - the chunks below are not the same size, so are shared out dynamically,
+        //but the model step uses fixed blocks, and each thread should create the agents it will later update
+        placePartition::parallelBlocks(nAgents,[&](long i){agents[i]=new agent(firstID+i);});
+        for (int k=0;k<3;k++){
+            #pragma omp parallel for schedule(dynamic)
+            for (long c=0;c<nChunks;c++){
+                randomizer r=chunkRandomizer(seed,k,c);
+                long i=c*chunkSize,last=std::min(i+chunkSize,nAgents);
+                long p=offset[k]+firstPlace[k][c];
+                while (i<last){
+                    long end=std::min(i+distributions[k].draw(r),last);
+                    for (;i<end;i++){
+                        if (k==agent::home){
+                            agents[i]->setHome(places[p]);
+                            agents[i]->initTravelSchedule(parameters);
+                        }
+                        //work and vehicles are filled in shuffled order
+                        if (k==agent::work)   agents[shuffle.inverse(i)]->setWork(places[p]);
+                        if (k==agent::vehicle)agents[shuffle.inverse(i)]->setTransport(places[p]);
+                    }
+                    p++;
+                }
+            }
         }
         //report intialization to std out 
         std::cout<<"Built "<<agents.size()<<" agents and "<<places.size()<<" places."<<std::endl;
-        //create some remote places to travel to - local ones are on this MPI domain, remote another one.
-        //If domain!="b"  is true, the location is remote to MPI domain b - otherwise it is labelled as local i.e. the current domain is indeed "b"
-        //hmmm - this needs some thought if there are more than two domains - also means that only "a" and "b" are recognised
-        
-        //local to domain not b, i.e. a, currently.
-        //travelList::add("NewYork",parameters,places,domain!="b");
-        //local only to domain b
-        //travelList::add("London",parameters,places,domain!="a");
-
+    }
+};
+/** @brief Create a population by loading it from a binary column file (see \ref populationFile)\n
+    @details The file (set by model.columnar.populationFile) gives the home, work and vehicle of every agent as indices into a list of places,\n
+    along with each agent's initial disease status. Files can be made from a csv file with the populationConverter tool (see \ref populationFile::convertCSV).\n
+    The file is memory mapped, and agents and places are then created in parallel straight from the mapped columns. run.nAgents is ignored - the\n
+    number of agents comes from the file. Places keep their original IDs from the file.\n
+    If model.columnar.domains is more than one, the population is split between that many MPI domains with a \ref domainPartition, and the\n
+    edge cut and number of shared places are reported. When coupled, the split is worked out once, on rank 0, and each domain then only builds\n
+    the agents it was given - every domain still has all the places, and places used by agents of more than one domain have their contamination\n
+    added up over the domains every step (see \ref MUIcoupler::setupSharedPlaces). Agent IDs are their position in the file, on any number of\n
+    domains. Without the coupler the split is only reported, and every agent is built.\n
+     \ref modelFactorySelector knows this as "columnar".Use this class by creating a pointer to the sub-class:-
+     \code
+     modelFactory* F=new columnarFactory();
+     \endcode
+    See \ref modelFactorySelector
+*/
+class columnarFactory:public modelFactory{
+#ifdef COUPLER
+    /** @brief split the population between the coupled domains (one per MPI rank) and find the agents this domain builds
+        @details the partition is only worked out on rank 0, which then sends each rank the positions in the file of its agents (MPI_Scatterv),\n
+        so the graph of the whole population is built once rather than on every domain
+        @param nDomains the number of domains asked for - must be the number running
+        @param pop the population
+        @param imbalance the largest number of agents on a domain, as a fraction above its share
+        @return the positions in the population file of this domain's agents, in file order */
+    std::vector<uint32_t> partition(int nDomains,populationFile& pop,double imbalance){
+        if (int(travelList::domains.size())!=nDomains){
+            std::cout<<"model.columnar.domains is "<<nDomains<<", but "<<travelList::domains.size()<<" domains are running"<<std::endl;
+            exit(1);
+        }
+        if (pop.nAgents()>uint64_t(INT_MAX)){
+            std::cout<<"Can't split more than "<<INT_MAX<<" agents between domains - the population has "<<pop.nAgents()<<std::endl;
+            exit(1);
+        }
+        int rank=0;
+        MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+        std::vector<int> counts(nDomains,0),starts(nDomains,0);
+        std::vector<uint32_t> order;
+        if (rank==0){
+            domainPartition D;
+            D.build(pop.nPlaces(),pop.nAgents(),pop.home(),pop.work(),pop.vehicle(),nDomains,imbalance);
+            D.report();
+            //the agents of each domain in turn, each in file order
+            for (uint64_t i=0;i<pop.nAgents();i++)counts[D.agentDomain(i)]++;
+            for (int d=1;d<nDomains;d++)starts[d]=starts[d-1]+counts[d-1];
+            order.resize(pop.nAgents());
+            std::vector<int> next=starts;
+            for (uint64_t i=0;i<pop.nAgents();i++)order[next[D.agentDomain(i)]++]=i;
+        }
+        int n=0;
+        MPI_Scatter(counts.data(),1,MPI_INT,&n,1,MPI_INT,0,MPI_COMM_WORLD);
+        std::vector<uint32_t> mine(n);
+        MPI_Scatterv(order.data(),counts.data(),starts.data(),MPI_UINT32_T,mine.data(),n,MPI_UINT32_T,0,MPI_COMM_WORLD);
+        return mine;
+    }
+#endif
+    /** @brief method to overlaod the createAgents method in the base class
+        @details This method has to be accessed by creating a pointer to this sub-class.
+        @param parameters A reference to the model parameterSettings object
+        @param agents A reference to the model object's list of agents
+        @param places* A reference to the model object's list of places*/
+    void createAgents(parameterSettings& parameters, std::vector<agent*>& agents,std::vector<place*>& places,std::string domain){
+        std::cout<<"Loading population from "<<parameters("model.columnar.populationFile")<<std::endl;
+        populationFile pop(parameters("model.columnar.populationFile"));
+        long nAgents=pop.nAgents(),nPlaces=pop.nPlaces();
+        places.resize(nPlaces);
+        place prototype(parameters);
+        createPlaces(prototype,places,0,nPlaces);
+        const uint64_t* placeID=pop.placeID();
+        placePartition::parallelBlocks(nPlaces,[&](long i){places[i]->setID(placeID[i]);});
+        const uint32_t* home=pop.home();
+        const uint32_t* work=pop.work();
+        const uint32_t* vehicle=pop.vehicle();
+        const uint8_t* status=pop.status();
+        //the agents built here - all of them, unless the population is split between domains
+        std::vector<uint32_t> mine;
+        int nDomains=parameters.get<int>("model.columnar.domains");
+        //agent IDs are their position in the file, so they are the same however the population is split
+        unsigned long firstID=agent::reserveIDs(nAgents);
+        if (nDomains>1){
+            if (travelList::domains.empty()){
+                domainPartition D;
+                D.build(nPlaces,nAgents,home,work,vehicle,nDomains,parameters.get<double>("model.columnar.imbalance"));
+                D.report();
+                std::cout<<"Not coupled to other domains - building every agent"<<std::endl;
+            }else{
+#ifdef COUPLER
+                mine=partition(nDomains,pop,parameters.get<double>("model.columnar.imbalance"));
+#endif
+                nAgents=mine.size();
+                std::cout<<"Domain "<<domain<<" builds "<<nAgents<<" agents"<<std::endl;
+            }
+        }
+        agents.resize(nAgents);
+        placePartition::parallelBlocks(nAgents,[&](long k){
+            long i=mine.empty()?k:mine[k];
+            agent* a=new agent(firstID+i);
+            a->setHome(places[home[i]]);
+            a->setWork(places[work[i]]);
+            a->setTransport(places[vehicle[i]]);
+            if (status[i]==1)a->becomeInfected();
+            if (status[i]==2)a->recover();
+            if (status[i]==3)a->die();
+            a->initTravelSchedule(parameters);
+            agents[k]=a;
+        });
+        //report intialization to std out 
+        std::cout<<"Built "<<agents.size()<<" agents and "<<places.size()<<" places."<<std::endl;
     }
 };
 /** @brief A class to pick one of a number of possible agent factories 
@@ -279,6 +576,8 @@ public:
         modelFactory* F=nullptr;
         if (name=="simpleOnePlace")F=new simpleOnePlaceFactory();
         if (name=="simpleMobile")  F=new simpleMobileFactory();
+        if (name=="census")        F=new censusFactory();
+        if (name=="columnar")      F=new columnarFactory();
         if (F==nullptr)std::cout<<"Name "<<name<<" not recognised in modelFactorySelector"<<std::endl;
         assert(F!=nullptr);
         return *F;
@@ -130,6 +130,16 @@ public:
         //number of OMP threads to use. increase the number here if using openmp to parallelise any loops.
         //Note number of threads needs to be <= to number of cores/threads supported on the local machine
         _parameters["run.nThreads"]="1";_parameterType["run.nThreads"]=i;
+        //pin each thread to its own core - none, close (fill one socket first) or spread (spaced evenly over the cores)
+        _parameters["run.pinThreads"]="none";_parameterType["run.pinThreads"]=s;
+        //share agents between threads in fixed blocks (static) or hand out chunks as threads become free (dynamic)
+        _parameters["run.schedule"]="static";_parameterType["run.schedule"]=s;
+        //with a dynamic schedule, the time in microseconds each chunk of agents should take - chunk sizes are adjusted every step to match
+        _parameters["run.chunkMicroseconds"]="50";_parameterType["run.chunkMicroseconds"]=d;
+        //time each phase of the first few steps with different numbers of threads, then use the fastest for each phase
+        _parameters["run.tuneThreads"]="false";_parameterType["run.tuneThreads"]=b;
+        //the number of steps each thread count is timed for when tuning
+        _parameters["run.tuneRounds"]="2";_parameterType["run.tuneRounds"]=i;
         //random seed
         _parameters["run.randomSeed"]="0";_parameterType["run.randomSeed"]=i;
         //the units for the timestep - valid are years,months,days,hours,minutes or seconds
@@ -140,6 +150,30 @@ public:
         _parameters["timeStep.startdate"]="Mon 01/01/1900 00:00:00";_parameterType["timeStep.startdate"]=s;
         //path to the output file
         _parameters["outputFile"]="diseaseSummary";_parameterType["outputFile"]=s;
+        //format of the output file - csv, binary (see seriesWriter.h) or both
+        _parameters["outputFormat"]="csv";_parameterType["outputFormat"]=s;
+        //save the contamination of every place every this many steps - 0 for no snapshots (see snapshotWriter.h)
+        _parameters["snapshot.interval"]="0";_parameterType["snapshot.interval"]=i;
+        //include the number of occupants of each place in the snapshots
+        _parameters["snapshot.occupancy"]="false";_parameterType["snapshot.occupancy"]=b;
+        //log every infection - step, agent, place and place type (see eventLog.h)
+        _parameters["events.log"]="false";_parameterType["events.log"]=b;
+        //most memory the event log can use for events waiting to be written, in MB
+        _parameters["events.memoryBudgetMB"]="64";_parameterType["events.memoryBudgetMB"]=l;
+        //what to do if the event log memory runs out - block (wait for the writer) or drop (lose events)
+        _parameters["events.policy"]="block";_parameterType["events.policy"]=s;
+        //time every phase of every step, and save the timings at the end of the run (see profiler.h)
+        _parameters["profile.enabled"]="true";_parameterType["profile.enabled"]=b;
+        //also read the CPU performance counters (cycles, instructions, cache and TLB misses) for each phase (see hardwareCounters.h)
+        _parameters["profile.counters"]="false";_parameterType["profile.counters"]=b;
+        //print the memory used by each part of the model after initialisation and at the end of the run (see memoryReport.h)
+        _parameters["memory.report"]="true";_parameterType["memory.report"]=b;
+        //the number of agents to estimate the memory needed for, in the memory report
+        _parameters["memory.projectAgents"]="100000000";_parameterType["memory.projectAgents"]=l;
+        //save a timeline of what every thread is doing, for viewing in perfetto or chrome://tracing (see traceRecorder.h)
+        _parameters["trace.enabled"]="false";_parameterType["trace.enabled"]=b;
+        //number of spans each thread keeps for the timeline - the oldest are overwritten after this
+        _parameters["trace.eventsPerThread"]="20000";_parameterType["trace.eventsPerThread"]=l;
         //path to location of output files
         _parameters["experiment.output.directory"]="./output";_parameterType["experiment.output.directory"]=s;
         //a name for all runs in this experiment
@@ -156,6 +190,10 @@ public:
         _parameters["run.nRepeats"]="1";_parameterType["run.nRepeats"]=i;
         //Number of times the run will be repeated with the same parameter set but different random seeds
         _parameters["run.randomIncrement"]="1";_parameterType["run.randomIncrement"]=i;
+        //step at which scenario branches are copied from the running model - negative means no branching
+        _parameters["run.branchStep"]="-1";_parameterType["run.branchStep"]=i;
+        //comma separated list of parameter files, one per branch, each holding the parameter values that differ from the main run
+        _parameters["run.branchParameterFiles"]="";_parameterType["run.branchParameterFiles"]=s;
         //settings for the simplest possible disease parameterisation
         _parameters["disease.simplistic.recoveryRate"]="0.0007";_parameterType["disease.simplistic.recoveryRate"]=d;
         _parameters["disease.simplistic.deathRate"]="0.0007";_parameterType["disease.simplistic.deathRate"]=d;
@@ -165,10 +203,29 @@ public:
         _parameters["places.disease.simplistic.fractionalDecrement"]="1";_parameterType["places.disease.simplistic.fractionalDecrement"]=d;
         //if set this flag will cause contamination to be reset to zero every timestep
         _parameters["places.cleanContamination"]="false";_parameterType["places.cleanContamination"]=b;
+        //give each place an owning thread, so that contamination is added without atomic updates
+        _parameters["places.partitioned"]="false";_parameterType["places.partitioned"]=b;
+        //how agents are sent between MPI domains by the coupler - packed (one MPI message per step) or mui (one MUI push per value)
+        _parameters["coupler.protocol"]="packed";_parameterType["coupler.protocol"]=s;
+        //steps between moving agents from slow MPI domains to quick ones (0 for never), how far above the mean time a domain must be, and how many rebalances before agents can go back
+        _parameters["coupler.rebalanceInterval"]="0";_parameterType["coupler.rebalanceInterval"]=i;
+        _parameters["coupler.rebalanceTolerance"]="0.1";_parameterType["coupler.rebalanceTolerance"]=d;
+        _parameters["coupler.rebalanceCooldown"]="3";_parameterType["coupler.rebalanceCooldown"]=i;
+        //the number of steps between a domain finding it has leavers and the exchange - domains can run this many steps apart
+        _parameters["coupler.exchangeLag"]="0";_parameterType["coupler.exchangeLag"]=i;
         //set up the default schedule type - expected to be mobile or stationary
         _parameters["schedule.type"]="mobile";_parameterType["schedule.type"]=s;
-        //set up how the model is created - model type is simpleMobile or simpleOnePlace
+        //set up how the model is created - model type is simpleMobile, simpleOnePlace, census or columnar
         _parameters["model.type"]="simpleMobile";_parameterType["model.type"]=s;
+        //table of household, workplace and vehicle size distributions for the census model type
+        _parameters["model.census.sizeTable"]="../censusSizeTable";_parameterType["model.census.sizeTable"]=s;
+        //number of agents generated together by the census model type - limits the work done in each parallel chunk
+        _parameters["model.census.chunkSize"]="1000000";_parameterType["model.census.chunkSize"]=l;
+        //binary population file read by the columnar model type - see populationFile.h
+        _parameters["model.columnar.populationFile"]="../population.mop";_parameterType["model.columnar.populationFile"]=s;
+        //number of MPI domains to split the columnar population between, and how far above its share of the agents and places a domain may go
+        _parameters["model.columnar.domains"]="1";_parameterType["model.columnar.domains"]=i;
+        _parameters["model.columnar.imbalance"]="0.03";_parameterType["model.columnar.imbalance"]=d;
     }
     //------------------------------------------------------------------------
     /** @brief reset the value of an existing parameter
@@ -0,0 +1,106 @@
+#ifndef PERMUTATION_H_INCLUDED
+#define PERMUTATION_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file permutation.h
+ * @brief File containing the definition of the \ref randomPermutation class
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @brief A pseudo-random re-ordering of the numbers 0 to n-1 that can be looked up one value at a time
+ * @details Shuffling a vector (e.g. with random_shuffle) has to be done on a single thread, and for billions of agents this gets slow.\n
+ * Instead this class calculates where any one value ends up directly, using a small Feistel network (the kind of mixing function used in block ciphers)\n
+ * on the bits of the value. The network is a one-to-one mapping on the next power of four above n - any result that lands above n-1 is just mixed\n
+ * again until it lands in range, which keeps the mapping one-to-one on 0 to n-1 (on average this needs less than four goes).\n
+ * Each value can be looked up independently, so the permutation can be used inside parallel loops, and the result only depends on n and the seed\n
+ * - not on the number of threads.
+ * \code
+ * randomPermutation shuffle(nAgents,seed);
+ * #pragma omp parallel for
+ * for (long i=0;i<nAgents;i++) agents[i]->setWork(places[shuffle(i)/agentsPerWorkPlace]);
+ * \endcode
+*/
+class randomPermutation{
+    /** @brief the number of values to be permuted */
+    uint64_t _n;
+    /** @brief the number of bits in each half of a value */
+    unsigned _halfBits;
+    /** @brief mask to pick out the lower half of the bits */
+    uint64_t _mask;
+    /** @brief one key per round of the network, derived from the seed */
+    uint64_t _keys[4];
+    /** @brief mixing function (the splitmix64 finaliser) - turns similar inputs into very different outputs */
+    static uint64_t mix(uint64_t x){
+        x^=x>>30;x*=0xbf58476d1ce4e5b9ULL;
+        x^=x>>27;x*=0x94d049bb133111ebULL;
+        x^=x>>31;
+        return x;
+    }
+    /** @brief one pass through the Feistel network - one-to-one on values up to 2^(2*halfBits) */
+    uint64_t encrypt(uint64_t x)const{
+        uint64_t left=x>>_halfBits, right=x&_mask;
+        for (int k=0;k<4;k++){
+            uint64_t next=left^(mix(right^_keys[k])&_mask);
+            left=right;right=next;
+        }
+        return (left<<_halfBits)|right;
+    }
+    /** @brief undo one pass through the Feistel network */
+    uint64_t decrypt(uint64_t x)const{
+        uint64_t left=x>>_halfBits, right=x&_mask;
+        for (int k=3;k>=0;k--){
+            uint64_t previous=right^(mix(left^_keys[k])&_mask);
+            right=left;left=previous;
+        }
+        return (left<<_halfBits)|right;
+    }
+public:
+    /** @brief set up the permutation
+        @param n the values 0 to n-1 will be permuted
+        @param seed a different seed gives a different ordering */
+    randomPermutation(uint64_t n,uint64_t seed=0):_n(n){
+        _halfBits=1;
+        while ((uint64_t(1)<<(2*_halfBits))<_n)_halfBits++;
+        _mask=(uint64_t(1)<<_halfBits)-1;
+        for (int k=0;k<4;k++)_keys[k]=mix(seed*4+k+1);
+    }
+    /** @brief find where value i goes to in the permutation
+        @param i a value from 0 to n-1
+        @return the permuted value, also from 0 to n-1 */
+    uint64_t operator()(uint64_t i)const{
+        do{i=encrypt(i);}while(i>=_n);
+        return i;
+    }
+    /** @brief find which value goes to position j - i.e. the inverse of the permutation, so that inverse(p(i))==i
+        @param j a value from 0 to n-1
+        @return the value that the permutation sends to j */
+    uint64_t inverse(uint64_t j)const{
+        do{j=decrypt(j);}while(j>=_n);
+        return j;
+    }
+    /** @brief the number of values being permuted */
+    uint64_t size()const{
+        return _n;
+    }
+};
+#endif // PERMUTATION_H_INCLUDED
@@ -0,0 +1,183 @@
+#ifndef PLACEPARTITION_H_INCLUDED
+#define PLACEPARTITION_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file placePartition.h
+ * @brief File containing the definition of the \ref placePartition class, which shares the places out between threads so each is only changed by one thread
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<vector>
+#include<utility>
+#include<omp.h>
+#include"agent.h"
+#include"places.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Gives every place an owning thread, so that contamination can be added without atomic updates ("owner computes")
+    @details Normally any thread can cough into any place, so \ref place::increaseContamination has to use an atomic update, and the\n
+    cache line holding the place moves between cores each time a different thread writes to it. With a partition, agents are shared\n
+    out in fixed contiguous blocks (see \ref first), and each place is owned by the thread whose block holds the first agent that uses it.\n
+    As agents are created home by home, homes end up owned by the thread that handles their occupants, while shared workplaces and\n
+    vehicles go to the first thread that uses them.\n
+    When an agent coughs into a place its own thread owns, the contamination is added directly. Otherwise it is queued for the owner -\n
+    each thread has one queue for every other thread, so no queue is ever written by two threads. After a barrier, each thread applies\n
+    everything queued for it, in the order of the sending threads, so the result does not depend on thread timing.\n
+    The owner also does the place update, so each place is only ever touched by one thread in the step.\n
+    The fraction of contamination updates that had to be queued is reported as a measure of how well the partition fits the population.
+    \code
+    placePartition P;
+    P.build(agents,places,nThreads);
+    #pragma omp parallel
+    {
+        int t=omp_get_thread_num();
+        for (long i=P.first(t,agents.size());i<P.first(t+1,agents.size());i++)P.contaminate(t,agents[i]->getCurrentPlace(),agents[i]->shedding());
+        #pragma omp barrier
+        P.deliver(t);
+    }
+    \endcode
+*/
+class placePartition{
+    /** @brief contamination queued by one thread, padded so that threads don't share cache lines */
+    struct alignas(64) outbox{
+        /** @brief one queue for each owning thread */
+        std::vector<std::vector<std::pair<place*,double>>> to;
+        /** @brief the number of updates made directly */
+        uint64_t local=0;
+        /** @brief the number of updates queued for another thread */
+        uint64_t routed=0;
+    };
+    /** @brief the number of threads the partition was made for */
+    int _nThreads=0;
+    /** @brief the places owned by each thread */
+    std::vector<std::vector<place*>> _owned;
+    /** @brief the queues of each sending thread */
+    std::vector<outbox> _out;
+public:
+    /** @brief the first item in the block handled by a thread, when n items are shared between nThreads threads
+        @details every loop in the model step shares out its items with this (see model::shareLoop), so each thread gets the same agents in every loop
+        @param t the thread number - use t+1 to get one past the end of the block
+        @param nThreads the number of threads sharing the items
+        @param n the number of items being shared out */
+    static long blockStart(int t,int nThreads,long n){
+        return (n*long(t))/nThreads;
+    }
+    /** @brief call f(i) for every i from 0 to n-1 in a new parallel region, each thread taking its block from \ref blockStart
+        @details used by the loops that create agents and places, so that each thread first touches the objects it will update in the model step */
+    template<typename F> static void parallelBlocks(long n,F f){
+        #pragma omp parallel
+        {
+            int t=omp_get_thread_num(),nThreads=omp_get_num_threads();
+            for (long i=blockStart(t,nThreads,n);i<blockStart(t+1,nThreads,n);i++)f(i);
+        }
+    }
+    /** @brief the first item in the block handled by a thread
+        @param t the thread number - use t+1 to get one past the end of the block
+        @param n the number of items being shared out */
+    long first(int t,long n){
+        return blockStart(t,_nThreads,n);
+    }
+    /** @brief share the places out between threads
+        @details Runs serially through the agents, so that the owners are the same on every run with the same number of threads.\n
+        Places that no agent uses are shared out in blocks by their position in the list.
+        @param agents the agents - each is handled by the thread whose block (see \ref first) it falls in
+        @param places all the places
+        @param nThreads the number of threads that will run the step */
+    void build(std::vector<agent*>& agents,std::vector<place*>& places,int nThreads){
+        _nThreads=std::max(nThreads,1);
+        for (auto p:places)p->setOwner(-1);
+        long n=agents.size();
+        for (int t=0;t<_nThreads;t++){
+            for (long i=first(t,n);i<first(t+1,n);i++){
+                for (int k=0;k<3;k++){
+                    place* p=agents[i]->places[k];
+                    if (p!=nullptr && p->getOwner()<0)p->setOwner(t);
+                }
+            }
+        }
+        _owned.assign(_nThreads,std::vector<place*>());
+        long nPlaces=places.size();
+        for (long i=0;i<nPlaces;i++){
+            if (places[i]->getOwner()<0)places[i]->setOwner((i*_nThreads)/std::max(nPlaces,1L));
+            _owned[places[i]->getOwner()].push_back(places[i]);
+        }
+        _out.assign(_nThreads,outbox());
+        for (auto& o:_out)o.to.resize(_nThreads);
+    }
+    /** @brief check whether the partition has been built */
+    bool built(){
+        return _nThreads>0;
+    }
+    /** @brief the number of threads the partition was made for */
+    int threads(){
+        return _nThreads;
+    }
+    /** @brief the places owned by a thread */
+    std::vector<place*>& owned(int t){
+        return _owned[t];
+    }
+    /** @brief add contamination to a place, directly if this thread owns it, otherwise by queueing it for the owner
+        @param t the calling thread
+        @param p the place - places not in the partition (e.g. owner -1) are updated atomically
+        @param amount the contamination to add - nothing is done if this is zero */
+    void contaminate(int t,place* p,double amount){
+        if (amount==0.)return;
+        int o=p->getOwner();
+        if (o==t){
+            p->increaseContaminationOwned(amount);
+            _out[t].local++;
+        }else if (o>=0 && o<_nThreads){
+            _out[t].to[o].push_back({p,amount});
+            _out[t].routed++;
+        }else{
+            p->increaseContamination(amount);
+            _out[t].routed++;
+        }
+    }
+    /** @brief apply all the contamination queued for a thread by the others - call after a barrier
+        @param t the calling thread */
+    void deliver(int t){
+        for (int s=0;s<_nThreads;s++){
+            auto& q=_out[s].to[t];
+            for (auto& m:q)m.first->increaseContaminationOwned(m.second);
+            q.clear();
+        }
+    }
+    /** @brief the number of contamination updates made directly by the owning thread so far */
+    uint64_t local(){
+        uint64_t n=0;
+        for (auto& o:_out)n+=o.local;
+        return n;
+    }
+    /** @brief the number of contamination updates that had to be passed to another thread so far */
+    uint64_t routed(){
+        uint64_t n=0;
+        for (auto& o:_out)n+=o.routed;
+        return n;
+    }
+    /** @brief the memory used by the owned place lists and the queues, in bytes */
+    uint64_t memoryUsed(){
+        uint64_t bytes=_out.capacity()*sizeof(outbox);
+        for (auto& o:_owned)bytes+=o.capacity()*sizeof(place*);
+        for (auto& o:_out)for (auto& q:o.to)bytes+=q.capacity()*sizeof(std::pair<place*,double>)+sizeof(q);
+        return bytes;
+    }
+};
+#endif // PLACEPARTITION_H_INCLUDED
@@ -25,6 +25,7 @@
  * @date 17/08/2021
  **/
 #include<set>
+#include<algorithm>
 #include<math.h>
 #include "timestep.h"
 //------------------------------------------------------------------------
@@ -59,6 +60,9 @@ class place{
      * of agents in a place at the opint where agents test for infection, set this to true.  
      */
     bool cleanEveryStep;
+    /** @brief The thread that updates this place when places are partitioned between threads (see \ref placePartition) - -1 if not assigned \n
+     * fits in the padding after cleanEveryStep, so costs no memory */
+    int owner;
     /** unique list of current people in this place - intended for direct agent-agent interaction \n
      * For the current disease model this is not needed, as the agents need only know where they are to contaminate a place \n
      * currently this is not used...seems to add about 20% to memory requirement if populated. \n
@@ -75,6 +79,7 @@ public:
         contaminationLevel=0.;
         fractionalDecrement=0.1;
         cleanEveryStep=false;
+        owner=-1;
     }
     /** @brief set up the place. 
      *  @param p parameter Settings read from the parameter file 
@@ -84,6 +89,7 @@ public:
         contaminationLevel=0.;
         fractionalDecrement=p.get<double>("places.disease.simplistic.fractionalDecrement");
         cleanEveryStep=p.get<bool>("places.cleanContamination");        
+        owner=-1;
     }
     /** @brief set the place ID number
      *  @details care shoudl be taken that ths value set here is unique! */
@@ -114,12 +120,31 @@ public:
         contaminationLevel+=amount;
         if (contaminationLevel<0) contaminationLevel=0;
     }
+    /** @brief Add contamination without the atomic update - only safe for the thread that owns the place, see \ref placePartition
+     *  @param amount the contamination to add */
+    void increaseContaminationOwned(double amount){
+        contaminationLevel+=amount;
+        if (contaminationLevel<0) contaminationLevel=0;
+    }
+    /** @brief set the thread that owns this place, see \ref placePartition */
+    void setOwner(int t){
+        owner=t;
+    }
+    /** @brief the thread that owns this place, or -1 */
+    int getOwner(){
+        return owner;
+    }
     /** A function to allow agents (or any other thing that points at this place) to completely clean up the contamination in a given place.
      * The level gets reset to zero
      * */
     void cleanContamination(){
         contaminationLevel=0.;
     }
+    /** @brief Set the contamination level directly - used to make the copies of a place on different MPI domains agree, see \ref MUIcoupler::shareContamination
+     *  @param level the new level - negative values are set to zero */
+    void setContaminationLevel(double level){
+        contaminationLevel=std::max(level,0.);
+    }
     /** Get the current level of contamination here
      *@return Floating point value of current contamination level. */
     double getContaminationLevel(){
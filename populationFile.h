@@ -0,0 +1,289 @@
+#ifndef POPULATIONFILE_H_INCLUDED
+#define POPULATIONFILE_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file populationFile.h
+ * @brief File containing the definition of the \ref populationFile class, for reading and writing populations in a binary column format
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstring>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<fstream>
+#include<iostream>
+#include<unordered_map>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief A population held as one array per field, ready to be written to a \ref populationFile
+    @details Agent i lives at home[i], works at work[i] and travels in vehicle[i] - these are indices into the place arrays, which hold\n
+    the original ID of each place (e.g. from a census) and its type (see \ref agent::placeTypes).
+*/
+struct populationColumns{
+    /** @brief the home place index of each agent */
+    std::vector<uint32_t> home;
+    /** @brief the work place index of each agent */
+    std::vector<uint32_t> work;
+    /** @brief the vehicle place index of each agent */
+    std::vector<uint32_t> vehicle;
+    /** @brief the disease status of each agent - 0 susceptible, 1 infected, 2 recovered, 3 dead */
+    std::vector<uint8_t> status;
+    /** @brief the ID of each place in the original data */
+    std::vector<uint64_t> placeID;
+    /** @brief the type of each place - home, work or vehicle */
+    std::vector<uint8_t> placeType;
+};
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Read-only access to a population stored in a binary column file
+    @details The file is a fixed size header followed by one array per field (see \ref populationColumns), each starting on a 64 byte boundary:-
+    \code
+    magic "MOPATOP" | version | byte order check | nAgents | nPlaces | offset of each column
+    home[nAgents] (uint32) | work[nAgents] (uint32) | vehicle[nAgents] (uint32) | status[nAgents] (uint8) | placeID[nPlaces] (uint64) | placeType[nPlaces] (uint8)
+    \endcode
+    The file is mapped into memory with mmap, and the column pointers point straight into the mapping, so nothing is read or copied until the values\n
+    are used, and reading in order goes at disk speed. The mapping is read-only and shared, so several runs using the same file share one copy\n
+    in the operating system page cache. Columns are written in the byte order of the machine that wrote them - a file from a machine with the\n
+    other byte order is rejected.\n
+    Use \ref write to make a file from \ref populationColumns, or \ref convertCSV (also available as the populationConverter tool) to make one from a csv file.
+    \code
+    populationFile pop("population.mop");
+    const uint32_t* homes=pop.home();
+    for (uint64_t i=0;i<pop.nAgents();i++) agents[i]->setHome(places[homes[i]]);
+    \endcode
+*/
+class populationFile{
+public:
+    /** @brief the columns in the file, in the order they are written */
+    enum columns{homeColumn,workColumn,vehicleColumn,statusColumn,placeIDColumn,placeTypeColumn,nColumns};
+private:
+    /** @brief the start of the file - all fixed width so it can be read straight from the mapping */
+    struct header{
+        /** @brief identifies the file type */
+        char magic[8];
+        /** @brief format version number */
+        uint32_t version;
+        /** @brief set to 0x01020304 - reads differently if the file was written with the other byte order */
+        uint32_t byteOrder;
+        /** @brief the number of agents */
+        uint64_t nAgents;
+        /** @brief the number of places */
+        uint64_t nPlaces;
+        /** @brief where each column starts, in bytes from the start of the file */
+        uint64_t offset[nColumns];
+    };
+    /** @brief the start of the mapped file */
+    char* _data;
+    /** @brief the size of the mapped file in bytes */
+    size_t _size;
+    /** @brief the file header, which points into the mapping */
+    const header* _header;
+    /** @brief the size of one value in each column */
+    static size_t width(int c){
+        static const size_t w[nColumns]={4,4,4,1,8,1};
+        return w[c];
+    }
+    /** @brief the number of values in each column */
+    static uint64_t length(int c,uint64_t nAgents,uint64_t nPlaces){
+        return (c<placeIDColumn)?nAgents:nPlaces;
+    }
+    /** @brief round up to the next 64 byte boundary, so each column starts on a cache line */
+    static uint64_t align(uint64_t x){
+        return (x+63)&~uint64_t(63);
+    }
+    /** @brief stop with a message if the file is not usable */
+    void fail(std::string fileName,std::string reason){
+        std::cout<<"Population file "<<fileName<<" "<<reason<<std::endl;
+        exit(1);
+    }
+    /** @brief get a pointer to the start of a column */
+    template<typename T> const T* column(int c)const{
+        return reinterpret_cast<const T*>(_data+_header->offset[c]);
+    }
+    /** @brief stop with a message if any agent has a place index past the end of the places, or an unknown disease status
+        @details done once when the file is opened, so that code reading the columns can use them as indices without checking
+        @param fileName the path to the file, for the message */
+    void checkValues(std::string fileName){
+        uint64_t nAgents=_header->nAgents,nPlaces=_header->nPlaces;
+        const uint32_t* h=home();
+        const uint32_t* w=work();
+        const uint32_t* v=vehicle();
+        const uint8_t* s=status();
+        //the first bad agent of each kind, or nAgents if there are none
+        uint64_t badPlace=nAgents,badStatus=nAgents;
+        #pragma omp parallel for schedule(static) reduction(min:badPlace,badStatus)
+        for (uint64_t i=0;i<nAgents;i++){
+            if ((h[i]>=nPlaces || w[i]>=nPlaces || v[i]>=nPlaces) && i<badPlace)badPlace=i;
+            if (s[i]>3 && i<badStatus)badStatus=i;
+        }
+        if (badPlace<nAgents){
+            fail(fileName,"is corrupt - agent "+std::to_string(badPlace)+" has home, work or vehicle "+std::to_string(h[badPlace])+", "
+                 +std::to_string(w[badPlace])+", "+std::to_string(v[badPlace])+", but there are only "+std::to_string(nPlaces)+" places");
+        }
+        if (badStatus<nAgents){
+            fail(fileName,"is corrupt - agent "+std::to_string(badStatus)+" has disease status "+std::to_string(s[badStatus])+" (should be 0 to 3)");
+        }
+    }
+public:
+    /** @brief map a population file into memory
+        @details the header, the column lengths and the values in the place index and status columns are all checked - a bad file stops\n
+        the run with a message
+        @param fileName the path to the file */
+    populationFile(std::string fileName){
+        int fd=open(fileName.c_str(),O_RDONLY);
+        if (fd<0)fail(fileName,"could not be opened");
+        struct stat s;
+        fstat(fd,&s);
+        _size=s.st_size;
+        if (_size<sizeof(header))fail(fileName,"is too short");
+        void* m=mmap(nullptr,_size,PROT_READ,MAP_SHARED,fd,0);
+        //the mapping stays valid once the file is closed
+        close(fd);
+        if (m==MAP_FAILED)fail(fileName,"could not be mapped into memory");
+        _data=static_cast<char*>(m);
+        //the columns are mostly read from start to end, so let the operating system read ahead
+        madvise(_data,_size,MADV_SEQUENTIAL);
+        _header=reinterpret_cast<const header*>(_data);
+        if (strncmp(_header->magic,"MOPATOP",8)!=0)fail(fileName,"is not a population file");
+        if (_header->byteOrder!=0x01020304)fail(fileName,"was written on a machine with a different byte order");
+        if (_header->version!=1)fail(fileName,"has an unknown version number");
+        for (int c=0;c<nColumns;c++){
+            if (_header->offset[c]+width(c)*length(c,_header->nAgents,_header->nPlaces)>_size)fail(fileName,"is truncated");
+        }
+        checkValues(fileName);
+    }
+    /** @brief unmap the file */
+    ~populationFile(){
+        munmap(_data,_size);
+    }
+    /** @brief the mapping can't be shared between objects, so no copies */
+    populationFile(const populationFile&)=delete;
+    /** @brief no assignment either */
+    populationFile& operator=(const populationFile&)=delete;
+    /** @brief the number of agents in the file */
+    uint64_t nAgents()const{return _header->nAgents;}
+    /** @brief the number of places in the file */
+    uint64_t nPlaces()const{return _header->nPlaces;}
+    /** @brief the home place index of each agent */
+    const uint32_t* home()const{return column<uint32_t>(homeColumn);}
+    /** @brief the work place index of each agent */
+    const uint32_t* work()const{return column<uint32_t>(workColumn);}
+    /** @brief the vehicle place index of each agent */
+    const uint32_t* vehicle()const{return column<uint32_t>(vehicleColumn);}
+    /** @brief the disease status of each agent - 0 susceptible, 1 infected, 2 recovered, 3 dead */
+    const uint8_t* status()const{return column<uint8_t>(statusColumn);}
+    /** @brief the original ID of each place */
+    const uint64_t* placeID()const{return column<uint64_t>(placeIDColumn);}
+    /** @brief the type of each place - see \ref agent::placeTypes */
+    const uint8_t* placeType()const{return column<uint8_t>(placeTypeColumn);}
+    //------------------------------------------------------------------------
+    /** @brief write a population to a file in the column format
+        @param fileName the path of the file to write
+        @param pop the population - all the agent columns need to be the same length, as do the place columns */
+    static void write(std::string fileName,const populationColumns& pop){
+        header h;
+        memset(&h,0,sizeof(h));
+        strncpy(h.magic,"MOPATOP",8);
+        h.version=1;
+        h.byteOrder=0x01020304;
+        h.nAgents=pop.home.size();
+        h.nPlaces=pop.placeID.size();
+        const char* data[nColumns]={(const char*)pop.home.data(),(const char*)pop.work.data(),(const char*)pop.vehicle.data(),
+                                    (const char*)pop.status.data(),(const char*)pop.placeID.data(),(const char*)pop.placeType.data()};
+        uint64_t position=align(sizeof(header));
+        for (int c=0;c<nColumns;c++){
+            h.offset[c]=position;
+            position=align(position+width(c)*length(c,h.nAgents,h.nPlaces));
+        }
+        std::ofstream out(fileName,std::ios::binary);
+        if (out.fail()){
+            std::cout<<"Unable to write population file "<<fileName<<std::endl;
+            exit(1);
+        }
+        out.write((const char*)&h,sizeof(h));
+        const char zeros[64]={0};
+        uint64_t written=sizeof(h);
+        for (int c=0;c<nColumns;c++){
+            out.write(zeros,h.offset[c]-written);
+            out.write(data[c],width(c)*length(c,h.nAgents,h.nPlaces));
+            written=h.offset[c]+width(c)*length(c,h.nAgents,h.nPlaces);
+        }
+    }
+    //------------------------------------------------------------------------
+    /** @brief convert a csv file of agents to the column format
+        @details Each line of the csv file is one agent, with the IDs of its home, work and vehicle, and optionally its disease status:-
+        \code
+        #home,work,vehicle,status
+        1001,52,9003,0
+        1001,77,9003,1
+        \endcode
+        Place IDs can be any (non-negative) integers, and need not be contiguous - they are numbered in the order they first appear, and the\n
+        original IDs are kept in the placeID column. Places are typed by the column in which they first appear. Lines starting with # or a letter\n
+        (i.e. a header line) are skipped. Agents keep the order of the lines in the file.
+        @param csvName the path of the csv file
+        @param fileName the path of the population file to write
+        @return the number of agents converted */
+    static uint64_t convertCSV(std::string csvName,std::string fileName){
+        std::ifstream in(csvName);
+        if (in.fail()){
+            std::cout<<"Unable to open csv file "<<csvName<<std::endl;
+            exit(1);
+        }
+        populationColumns pop;
+        std::unordered_map<uint64_t,uint32_t> index;
+        std::string line;
+        std::vector<uint32_t>* agentColumn[3]={&pop.home,&pop.work,&pop.vehicle};
+        while (std::getline(in,line)){
+            if (line.empty() || line[0]=='#' || isalpha(line[0]))continue;
+            //parse the numbers in place - much quicker than a stringstream for very large files
+            const char* p=line.c_str();
+            for (int k=0;k<3;k++){
+                char* end;
+                uint64_t id=strtoull(p,&end,10);
+                if (end==p){
+                    std::cout<<"Too few columns in csv file "<<csvName<<": "<<line<<std::endl;
+                    exit(1);
+                }
+                auto it=index.find(id);
+                if (it==index.end()){
+                    if (pop.placeID.size()==UINT32_MAX){
+                        std::cout<<"Too many places in csv file "<<csvName<<std::endl;
+                        exit(1);
+                    }
+                    it=index.emplace(id,pop.placeID.size()).first;
+                    pop.placeID.push_back(id);
+                    pop.placeType.push_back(k);
+                }
+                agentColumn[k]->push_back(it->second);
+                p=end;
+                if (*p==',')p++;
+            }
+            pop.status.push_back(strtoul(p,nullptr,10));
+        }
+        write(fileName,pop);
+        return pop.home.size();
+    }
+};
+#endif // POPULATIONFILE_H_INCLUDED
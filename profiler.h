@@ -0,0 +1,471 @@
+#ifndef PROFILER_H_INCLUDED
+#define PROFILER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file profiler.h
+ * @brief File containing the definition of the \ref profiler class, for timing each phase of every model step
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<string>
+#include<vector>
+#include<map>
+#include<algorithm>
+#include<fstream>
+#include<iostream>
+#include<iomanip>
+#include<optional>
+#include<omp.h>
+#include"traceRecorder.h"
+#include"hardwareCounters.h"
+#include"memoryReport.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Records how long each phase of each model step takes, and how evenly the work is spread over the threads
+    @details Phases are named once with \ref phase, which gives back a number used to refer to them after that. Timing uses RAII - a \ref scope\n
+    object measures from its creation to the end of the enclosing block, in nanoseconds, and adds this to the phase total for the current step:-
+    \code
+    int places=prof.phase("places");
+    prof.startStep(step);
+    {
+        profiler::scope s(prof,places);
+        #pragma omp parallel
+        {
+            profiler::threadScope busy(prof,places);
+            #pragma omp for nowait
+            for (long i=0;i<n;i++)...
+        }
+    }
+    \endcode
+    The \ref threadScope inside the parallel region measures how long each thread was busy with its share of the loop (the nowait means\n
+    a thread stops its timer as soon as it finishes, rather than after waiting for the others). At the end of the phase the busiest thread\n
+    is compared to the average - an imbalance of 1 means the work was evenly spread, 2 means the slowest thread took twice the average.\n
+    At the end of the run \ref write saves a csv file with one row per step, and a json summary with totals, percentiles and a histogram\n
+    (in powers of two nanoseconds) for each phase, along with the total busy time of each thread. If the profiler is disabled the scopes do nothing.\n
+    If the \ref traceRecorder is enabled each scope also adds a span to the timeline, whether or not the profiler itself is enabled.\n
+    If \ref enableCounters is used, each \ref threadScope also reads the CPU performance counters of its thread (see \ref hardwareCounters),\n
+    and the report adds the instructions per cycle and the cache and TLB misses per agent for each parallel phase - showing whether a phase\n
+    is limited by memory latency (low IPC, few misses per agent) or by memory bandwidth (many bytes fetched per agent).\n
+    If \ref enableMemory is used, each \ref scope also checks the peak resident memory at its end, so the report shows which phases make it grow.
+*/
+class profiler{
+    /** @brief per-thread busy times, padded to a cache line so that threads don't slow each other down */
+    struct alignas(64) threadTimes{
+        /** @brief busy time in the current step for each phase, in ns */
+        std::vector<int64_t> step;
+        /** @brief total busy time over the run for each phase, in ns */
+        std::vector<int64_t> total;
+        /** @brief total of each performance counter over the run for each phase */
+        std::vector<hardwareCounters::values> counts;
+    };
+    /** @brief true if timings are being recorded */
+    bool _enabled=true;
+    /** @brief the names of the phases */
+    std::vector<std::string> _names;
+    /** @brief the names of the phases as used for the timeline, see \ref traceRecorder::intern */
+    std::vector<const char*> _traceNames;
+    /** @brief the step numbers recorded */
+    std::vector<long> _steps;
+    /** @brief time for each phase in each step in ns, indexed [phase][step] */
+    std::vector<std::vector<int64_t>> _times;
+    /** @brief busiest thread time over mean thread time, for each phase in each step, indexed [phase][step] - zero if not a parallel phase */
+    std::vector<std::vector<float>> _imbalance;
+    /** @brief busy time for each thread */
+    std::vector<threadTimes> _threads;
+    /** @brief the CPU performance counters */
+    hardwareCounters _hw;
+    /** @brief true if the performance counters are being read */
+    bool _counting=false;
+    /** @brief the number of agents, for the per agent counter figures */
+    long _items=0;
+    /** @brief true if the peak resident memory is checked after each phase */
+    bool _memory=false;
+    /** @brief the peak resident memory when last checked, in bytes */
+    uint64_t _lastPeak=0;
+    /** @brief the growth in peak resident memory during each phase over the run, in bytes */
+    std::vector<uint64_t> _peakGrowth;
+    /** @brief the peak resident memory at the end of each phase, in bytes */
+    std::vector<uint64_t> _peakAfter;
+    /** @brief add up a counter for a phase over all threads */
+    uint64_t counterTotal(int p,int c){
+        uint64_t sum=0;
+        for (auto& t:_threads)sum+=t.counts[p][c];
+        return sum;
+    }
+    /** @brief nanoseconds since an arbitrary start */
+    static int64_t now(){
+        return traceRecorder::now();
+    }
+    /** @brief add a time to the current step of a phase */
+    void add(int p,int64_t ns){
+        if (_steps.empty())startStep(0);
+        _times[p].back()+=ns;
+    }
+    /** @brief work out the thread imbalance for a phase in this step, and move the thread times into the totals */
+    void endPhase(int p){
+        int64_t maximum=0,sum=0;
+        int n=0;
+        for (auto& t:_threads){
+            if (t.step[p]>0){
+                maximum=std::max(maximum,t.step[p]);
+                sum+=t.step[p];
+                n++;
+                t.total[p]+=t.step[p];
+                t.step[p]=0;
+            }
+        }
+        if (n>0 && sum>0)_imbalance[p].back()=float(maximum)/(float(sum)/n);
+    }
+    /** @brief see if the peak resident memory has grown, and if so put the growth down to a phase */
+    void checkMemory(int p){
+        uint64_t peak=memoryReport::peakResidentBytes();
+        if (peak>_lastPeak)_peakGrowth[p]+=peak-_lastPeak;
+        _lastPeak=std::max(peak,_lastPeak);
+        _peakAfter[p]=std::max(_peakAfter[p],peak);
+    }
+    /** @brief the value below which a given fraction of the values lie */
+    static int64_t percentile(std::vector<int64_t> v,double fraction){
+        if (v.empty())return 0;
+        size_t k=std::min(v.size()-1,size_t(fraction*v.size()));
+        std::nth_element(v.begin(),v.begin()+k,v.end());
+        return v[k];
+    }
+public:
+    //------------------------------------------------------------------------
+    /** @brief times a phase from creation to the end of the enclosing block - use outside parallel regions */
+    class scope{
+        /** @brief the profiler to report to */
+        profiler& _p;
+        /** @brief the phase being timed */
+        int _phase;
+        /** @brief the start time */
+        int64_t _start;
+    public:
+        /** @brief start timing
+            @param p the profiler
+            @param phase the phase number from \ref profiler::phase */
+        scope(profiler& p,int phase):_p(p),_phase(phase){
+            _start=(_p._enabled || traceRecorder::enabled())?now():0;
+        }
+        /** @brief stop timing, and add the time to the phase */
+        ~scope(){
+            if (!_p._enabled && !traceRecorder::enabled())return;
+            int64_t end=now();
+            traceRecorder::record(_p._traceNames[_phase],"step",_start,end);
+            if (!_p._enabled)return;
+            _p.add(_phase,end-_start);
+            _p.endPhase(_phase);
+            if (_p._memory)_p.checkMemory(_phase);
+        }
+    };
+    //------------------------------------------------------------------------
+    /** @brief times one thread's work in a phase - create at the start of a parallel region, and use nowait on the loops inside */
+    class threadScope{
+        /** @brief the profiler to report to */
+        profiler& _p;
+        /** @brief the phase being timed */
+        int _phase;
+        /** @brief the start time */
+        int64_t _start;
+        /** @brief the performance counters at the start */
+        hardwareCounters::values _startCounts;
+    public:
+        /** @brief start timing this thread
+            @param p the profiler
+            @param phase the phase number from \ref profiler::phase */
+        threadScope(profiler& p,int phase):_p(p),_phase(phase){
+            if (_p._counting)_startCounts=_p._hw.read();
+            _start=(_p._enabled || traceRecorder::enabled())?now():0;
+        }
+        /** @brief stop timing, and add the time to this thread's busy time */
+        ~threadScope(){
+            if (!_p._enabled && !traceRecorder::enabled())return;
+            int64_t end=now();
+            traceRecorder::record(_p._traceNames[_phase],"thread",_start,end);
+            if (!_p._enabled)return;
+            unsigned t=omp_get_thread_num();
+            if (t>=_p._threads.size())return;
+            _p._threads[t].step[_phase]+=end-_start;
+            if (_p._counting){
+                auto used=hardwareCounters::difference(_startCounts,_p._hw.read());
+                for (int c=0;c<hardwareCounters::nCounters;c++)_p._threads[t].counts[_phase][c]+=used[c];
+            }
+        }
+    };
+    //------------------------------------------------------------------------
+    /** @brief times a phase inside a parallel region that runs several phases one after another - every thread creates one
+        @details Each thread's busy time is recorded as for \ref threadScope. If the phase ends with a barrier (because the next phase\n
+        depends on it) the barrier is done here, after the busy time is stopped, so waiting does not count as busy. Thread 0 times the phase\n
+        from start to finish - for a phase without a barrier this is just its own share, as the other threads carry straight on to the next phase.\n
+        The imbalance can only be worked out once every thread has finished, so call \ref finishPhase for each phase after the region ends.
+        \code
+        #pragma omp parallel
+        {
+            {
+                profiler::teamScope s(prof,places,true);
+                #pragma omp for nowait
+                for (long i=0;i<n;i++)...
+            }
+            {
+                profiler::teamScope s(prof,cough,false);
+                ...
+            }
+        }
+        prof.finishPhase(places);
+        prof.finishPhase(cough);
+        \endcode */
+    class teamScope{
+        /** @brief the profiler to report to */
+        profiler& _p;
+        /** @brief the phase being timed */
+        int _phase;
+        /** @brief true if all threads wait for each other at the end of the phase */
+        bool _barrier;
+        /** @brief the start time on thread 0 */
+        int64_t _start=0;
+        /** @brief this thread's busy time */
+        std::optional<threadScope> _busy;
+    public:
+        /** @brief start timing
+            @param p the profiler
+            @param phase the phase number from \ref profiler::phase
+            @param barrier if true, threads wait for each other at the end of the phase */
+        teamScope(profiler& p,int phase,bool barrier):_p(p),_phase(phase),_barrier(barrier){
+            if (omp_get_thread_num()==0 && (_p._enabled || traceRecorder::enabled()))_start=now();
+            _busy.emplace(p,phase);
+        }
+        /** @brief stop this thread's busy time, wait for the other threads if needed, and on thread 0 add the time to the phase */
+        ~teamScope(){
+            _busy.reset();
+            if (_barrier){
+                #pragma omp barrier
+            }
+            if (omp_get_thread_num()!=0 || (!_p._enabled && !traceRecorder::enabled()))return;
+            int64_t end=now();
+            traceRecorder::record(_p._traceNames[_phase],"step",_start,end);
+            if (!_p._enabled)return;
+            _p.add(_phase,end-_start);
+            if (_p._memory)_p.checkMemory(_phase);
+        }
+    };
+    //------------------------------------------------------------------------
+    /** @brief set up the profiler
+        @param enabled if false, nothing is recorded */
+    profiler(bool enabled=true):_enabled(enabled){
+        _threads.resize(omp_get_max_threads());
+    }
+    /** @brief turn recording on or off */
+    void enable(bool enabled){
+        _enabled=enabled;
+    }
+    /** @brief make sure there is space for at least this many threads - call outside any parallel region */
+    void setThreads(int nThreads){
+        if (nThreads<=int(_threads.size()))return;
+        _threads.resize(nThreads);
+        for (auto& t:_threads){t.step.resize(_names.size(),0);t.total.resize(_names.size(),0);t.counts.resize(_names.size(),{0,0,0,0});}
+    }
+    /** @brief start or stop reading the CPU performance counters in each \ref threadScope
+        @details If the counters can't be read on this machine a message is printed and the profiler carries on with times only.
+        @param on true to read the counters
+        @return true if the counters are being read */
+    bool enableCounters(bool on){
+        _counting=false;
+        if (!on || !_enabled)return false;
+        //open the counters on every thread now, rather than part way through the first step
+        #pragma omp parallel
+        _hw.read();
+        if (!_hw.available()){
+            std::cout<<"Hardware performance counters are not available ("<<_hw.reason()<<") - timing phases only"<<std::endl;
+            return false;
+        }
+        if (!_hw.reason().empty())std::cout<<"Some hardware performance counters are not available ("<<_hw.reason()<<")"<<std::endl;
+        _counting=true;
+        return true;
+    }
+    /** @brief start or stop checking the peak resident memory at the end of each phase
+        @param on true to check the memory */
+    void enableMemory(bool on){
+        _memory=on && _enabled;
+        _lastPeak=memoryReport::peakResidentBytes();
+    }
+    /** @brief the growth in peak resident memory during a phase, over the whole run, in bytes */
+    uint64_t peakGrowth(int p){
+        return _peakGrowth[p];
+    }
+    /** @brief the memory used by the profiler's own records, in bytes */
+    size_t memoryUsed(){
+        size_t bytes=_steps.capacity()*sizeof(long);
+        for (auto& t:_times)bytes+=t.capacity()*sizeof(int64_t);
+        for (auto& i:_imbalance)bytes+=i.capacity()*sizeof(float);
+        for (auto& t:_threads)bytes+=sizeof(threadTimes)+(t.step.capacity()+t.total.capacity())*sizeof(int64_t)+t.counts.capacity()*sizeof(hardwareCounters::values);
+        return bytes;
+    }
+    /** @brief the counters, e.g. to count different events with \ref hardwareCounters::setEvents */
+    hardwareCounters& counters(){
+        return _hw;
+    }
+    /** @brief set the number of agents, used to give the counter figures per agent */
+    void setItems(long n){
+        _items=n;
+    }
+    /** @brief the total of a performance counter over a run for a phase, summed over all threads
+        @param p the phase number
+        @param c the counter - see \ref hardwareCounters::counterNames */
+    uint64_t counter(int p,int c){
+        return counterTotal(p,c);
+    }
+    /** @brief get the number of a phase, adding it if it is new
+        @param name the name of the phase
+        @return the phase number, to be used with \ref scope and \ref threadScope */
+    int phase(std::string name){
+        auto it=std::find(_names.begin(),_names.end(),name);
+        if (it!=_names.end())return it-_names.begin();
+        _names.push_back(name);
+        _traceNames.push_back(traceRecorder::intern(name));
+        _times.push_back(std::vector<int64_t>(_steps.size(),0));
+        _imbalance.push_back(std::vector<float>(_steps.size(),0));
+        _peakGrowth.push_back(0);
+        _peakAfter.push_back(0);
+        for (auto& t:_threads){t.step.push_back(0);t.total.push_back(0);t.counts.push_back({0,0,0,0});}
+        return _names.size()-1;
+    }
+    /** @brief work out the thread imbalance of a phase timed with \ref teamScope - call outside the parallel region, once every thread has finished
+        @param p the phase number */
+    void finishPhase(int p){
+        if (!_enabled || _steps.empty())return;
+        endPhase(p);
+    }
+    /** @brief start recording a new step
+        @param step the step number */
+    void startStep(long step){
+        if (!_enabled)return;
+        _steps.push_back(step);
+        for (auto& t:_times)t.push_back(0);
+        for (auto& i:_imbalance)i.push_back(0);
+    }
+    /** @brief the total time recorded for a phase, in seconds */
+    double totalSeconds(int p){
+        int64_t sum=0;
+        for (auto t:_times[p])sum+=t;
+        return sum*1.e-9;
+    }
+    /** @brief the number of steps recorded */
+    size_t nSteps(){
+        return _steps.size();
+    }
+    /** @brief the time recorded for a phase in one of the recorded steps, in ns */
+    int64_t time(int p,size_t k){
+        return _times[p][k];
+    }
+    //------------------------------------------------------------------------
+    /** @brief print a short table of the time in each phase */
+    void report(){
+        if (!_enabled || _steps.empty())return;
+        std::cout<<"Time per phase over "<<_steps.size()<<" steps (seconds total, milliseconds mean per step, mean thread imbalance):"<<std::endl;
+        for (unsigned p=0;p<_names.size();p++){
+            double imbalance=0;int n=0;
+            for (auto i:_imbalance[p])if (i>0){imbalance+=i;n++;}
+            std::cout<<"  "<<std::left<<std::setw(12)<<_names[p]<<std::right<<std::setw(12)<<totalSeconds(p)
+                     <<std::setw(12)<<1000*totalSeconds(p)/_steps.size();
+            if (n>0)std::cout<<std::setw(8)<<imbalance/n;
+            std::cout<<std::endl;
+        }
+        if (_memory){
+            std::cout<<"Peak resident memory per phase (MB growth over the run, MB peak at the end of the phase):"<<std::endl;
+            for (unsigned p=0;p<_names.size();p++){
+                std::cout<<"  "<<std::left<<std::setw(12)<<_names[p]<<std::right<<std::setw(12)<<_peakGrowth[p]/(1024.*1024.)
+                         <<std::setw(12)<<_peakAfter[p]/(1024.*1024.)<<std::endl;
+            }
+        }
+        if (!_counting)return;
+        //LLC misses are taken to fetch one 64 byte cache line each from memory
+        double perAgent=(_items>0)?1./(double(_items)*_steps.size()):0;
+        std::cout<<"Hardware counters per phase (instructions per cycle, then per agent per step: LLC misses, dTLB misses, bytes from memory):"<<std::endl;
+        for (unsigned p=0;p<_names.size();p++){
+            uint64_t cyc=counterTotal(p,hardwareCounters::cycles);
+            if (cyc==0)continue;
+            std::cout<<"  "<<std::left<<std::setw(12)<<_names[p]<<std::right
+                     <<std::setw(10)<<double(counterTotal(p,hardwareCounters::instructions))/cyc
+                     <<std::setw(12)<<counterTotal(p,hardwareCounters::llcMisses)*perAgent
+                     <<std::setw(12)<<counterTotal(p,hardwareCounters::dtlbMisses)*perAgent
+                     <<std::setw(12)<<64*counterTotal(p,hardwareCounters::llcMisses)*perAgent<<std::endl;
+        }
+    }
+    //------------------------------------------------------------------------
+    /** @brief save the timings
+        @details Writes prefix+"profile.csv", with the time in ns for each phase and the thread imbalance of each parallel phase, one row per step,\n
+        and prefix+"profileSummary.json", with the totals, mean, min, max and percentiles for each phase, a histogram of step times\n
+        (the count of steps taking 2^k to 2^(k+1) ns, for each k), and the total busy time of each thread in each phase.\n
+        If the performance counters are in use, their totals for each phase are added (null for any not available on this machine).
+        @param prefix the path and start of the file names */
+    void write(std::string prefix){
+        if (!_enabled || _steps.empty())return;
+        std::ofstream csv(prefix+"profile.csv");
+        csv<<"step";
+        for (auto& n:_names)csv<<","<<n<<"(ns)";
+        for (auto& n:_names)csv<<","<<n<<"(imbalance)";
+        csv<<"\n";
+        for (size_t k=0;k<_steps.size();k++){
+            csv<<_steps[k];
+            for (auto& t:_times)csv<<","<<t[k];
+            for (auto& i:_imbalance)csv<<","<<i[k];
+            csv<<"\n";
+        }
+        std::ofstream json(prefix+"profileSummary.json");
+        json<<"{\n  \"steps\": "<<_steps.size()<<",\n  \"threads\": "<<_threads.size()<<",\n  \"phases\": [\n";
+        for (unsigned p=0;p<_names.size();p++){
+            auto& t=_times[p];
+            int64_t sum=0;
+            std::map<int,long> histogram;
+            for (auto v:t){
+                sum+=v;
+                int k=0;
+                while ((int64_t(2)<<k)<=v)k++;
+                histogram[k]++;
+            }
+            double imbalance=0;int n=0;
+            for (auto i:_imbalance[p])if (i>0){imbalance+=i;n++;}
+            json<<"    {\"name\": \""<<_names[p]<<"\", \"total_ns\": "<<sum<<", \"mean_ns\": "<<sum/int64_t(t.size())
+                <<", \"min_ns\": "<<*std::min_element(t.begin(),t.end())<<", \"max_ns\": "<<*std::max_element(t.begin(),t.end())
+                <<", \"p50_ns\": "<<percentile(t,0.5)<<", \"p95_ns\": "<<percentile(t,0.95)<<", \"p99_ns\": "<<percentile(t,0.99)
+                <<", \"mean_imbalance\": "<<(n>0?imbalance/n:0)<<",\n     \"histogram_log2_ns\": {";
+            bool first=true;
+            for (auto& h:histogram){
+                json<<(first?"":", ")<<"\""<<h.first<<"\": "<<h.second;
+                first=false;
+            }
+            json<<"},\n     \"thread_busy_ns\": [";
+            for (unsigned k=0;k<_threads.size();k++)json<<(k>0?", ":"")<<_threads[k].total[p];
+            json<<"]";
+            if (_counting){
+                json<<",\n     \"counters\": {";
+                for (int c=0;c<hardwareCounters::nCounters;c++){
+                    json<<(c>0?", ":"")<<"\""<<hardwareCounters::name(c)<<"\": ";
+                    if (_hw.has(c))json<<counterTotal(p,c);else json<<"null";
+                }
+                json<<", \"agents\": "<<_items<<"}";
+            }
+            if (_memory)json<<",\n     \"peak_rss_growth_bytes\": "<<_peakGrowth[p]<<", \"peak_rss_bytes\": "<<_peakAfter[p];
+            json<<"}"<<(p+1<_names.size()?",":"")<<"\n";
+        }
+        json<<"  ]\n}\n";
+    }
+};
+#endif // PROFILER_H_INCLUDED
@@ -41,17 +41,18 @@ class remoteTravel {
         place* plane;
         /** @brief place to stay while away */
         place* hotel;
-        /** @brief flag to say if this place is on a remote MPI domain
-            @details All places are defined on every domain, so that travellers can find out about them, but also so that they can be used for return trips from the remote domain*/
-        bool _remoteDomain;
+        /** @brief the MPI domain this place is on, if it is on a remote domain, or -1 if it is local
+            @details All places are defined on every domain, so that travellers can find out about them, but also so that they can be used for return trips from the remote domain\n
+            With more than two domains, agents travelling here are sent to this domain - see \ref travelList::domainNumber to find it from the domain name*/
+        int _domain;
 public:
         /** @brief default constructor is an empty place - agents should not be allowed to travel here! */
-        remoteTravel(){_remoteDomain=false;plane=nullptr;hotel=nullptr;}
+        remoteTravel(){_domain=-1;plane=nullptr;hotel=nullptr;}
         /** @brief Sets up a travel location and transport, and adds its places to the place list (so that the places update function has effect)  
             @param parameters the model parameters, used in setting up a place
             @param places the vector of all places
-            @param remote set the flag for a remote MPI domain - defaults to false if not set by the caller*/
-        remoteTravel(parameterSettings& parameters,std::vector<place*>& places,bool remote=false):_remoteDomain(remote){
+            @param domain the remote MPI domain the location is on - defaults to -1 (this domain) if not set by the caller*/
+        remoteTravel(parameterSettings& parameters,std::vector<place*>& places,int domain=-1):_domain(domain){
             plane=new place(parameters);plane->setID(places.size());places.push_back(plane);
             hotel=new place(parameters);hotel->setID(places.size());places.push_back(hotel);
         }
@@ -69,7 +70,11 @@ public:
          *  so that they can manage a return trip on a local plane. Named locations therefore need to be setup on each\n
             domain consistently (e.g. so that "London" is remote on one domain, but local on another)*/ 
         bool isOnRemoteDomain(){
-            return _remoteDomain;
+            return _domain>=0;
+        }
+        /** @brief the MPI domain the location is on, or -1 if it is on this one - agents visiting it should \ref agent::setDestination to this */
+        int domain(){
+            return _domain;
         }
 };
 #endif
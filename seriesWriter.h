@@ -0,0 +1,163 @@
+#ifndef SERIESWRITER_H_INCLUDED
+#define SERIESWRITER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file seriesWriter.h
+ * @brief File containing the definition of the \ref seriesWriter class for binary time series output
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<initializer_list>
+#include"asyncWriter.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief One value in a row of a \ref seriesWriter - converts automatically from the usual number types */
+struct seriesValue{
+    /** @brief the value if it is an integer */
+    int64_t i;
+    /** @brief the value if it is floating point */
+    double d;
+    /** @brief which of the two is set */
+    bool isInteger;
+    /** @brief from an int */
+    seriesValue(int v):i(v),d(v),isInteger(true){}
+    /** @brief from a long */
+    seriesValue(long v):i(v),d(v),isInteger(true){}
+    /** @brief from an unsigned long */
+    seriesValue(unsigned long v):i(v),d(v),isInteger(true){}
+    /** @brief from a double */
+    seriesValue(double v):i(v),d(v),isInteger(false){}
+};
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Binary output of a set of time series, one row per step
+    @details Writing and then re-reading large numbers of csv files is slow - this writes the same values as fixed width binary columns instead.\n
+    The file starts with a header that describes the columns, and the rows are then appended in blocks, each block holding the rows in column order:-
+    \code
+    header:  "MOPSERIE" | version (uint32) | byte order check 0x01020304 (uint32) | number of columns (uint32) | header size in bytes (uint32)
+             then for each column: name (32 chars, zero padded) | type ('i' int64 or 'd' float64) | 7 bytes padding
+    block:   number of rows n (uint64) | column 0 values [n] | column 1 values [n] | ...
+    \endcode
+    All values are 8 bytes, so a block can be read straight into an array with no parsing (see experiments/mopatopReader.py). Blocks are\n
+    independent, so a file can be appended to (e.g. by a scenario branch continuing from a copy of the base run output). The output is written\n
+    through an \ref asyncWriter, so the disk is only touched in the background.
+    \code
+    seriesWriter s;
+    s.open("diseaseSummary.mts",{"step","infected"},{'i','i'});
+    s.row({step,infected});
+    s.flush();
+    \endcode
+*/
+class seriesWriter{
+    /** @brief the output file */
+    asyncWriter _out;
+    /** @brief the type of each column - 'i' for 64 bit integer, 'd' for double */
+    std::vector<char> _types;
+    /** @brief rows so far in the current block, one vector per column, each value stored as its 8 bytes */
+    std::vector<std::vector<uint64_t>> _columns;
+    /** @brief number of rows in the current block */
+    uint64_t _rows=0;
+    /** @brief number of rows after which a block is written out */
+    uint64_t _blockRows=4096;
+    /** @brief write the rows so far as a block */
+    void writeBlock(){
+        if (_rows==0)return;
+        _out.write((const char*)&_rows,sizeof(_rows));
+        for (auto& c:_columns){
+            _out.write((const char*)c.data(),c.size()*sizeof(uint64_t));
+            c.clear();
+        }
+        _rows=0;
+    }
+public:
+    /** @brief write out any remaining rows */
+    ~seriesWriter(){
+        close();
+    }
+    /** @brief open a file and write the header
+        @param fileName the path of the file
+        @param names the name of each column (up to 31 characters)
+        @param types the type of each column - 'i' for integer, 'd' for double
+        @param append if true, add blocks to the end of an existing file that already has a header with the same columns */
+    void open(std::string fileName,std::vector<std::string> names,std::vector<char> types,bool append=false){
+        _out.open(fileName,append);
+        _types=types;
+        _columns.assign(names.size(),std::vector<uint64_t>());
+        for (auto& c:_columns)c.reserve(_blockRows);
+        _rows=0;
+        if (append)return;
+        uint32_t header[4]={1,0x01020304,uint32_t(names.size()),uint32_t(8+4*4+40*names.size())};
+        _out.write("MOPSERIE",8);
+        _out.write((const char*)header,sizeof(header));
+        for (unsigned c=0;c<names.size();c++){
+            char description[40]={0};
+            strncpy(description,names[c].c_str(),31);
+            description[32]=types[c];
+            _out.write(description,40);
+        }
+    }
+    /** @brief add a row - there needs to be one value per column, in the same order as the column names
+        @param values the values, converted to the column types */
+    void row(std::initializer_list<seriesValue> values){
+        unsigned c=0;
+        for (auto& v:values){
+            uint64_t bits;
+            if (_types[c]=='i'){
+                int64_t i=v.isInteger?v.i:int64_t(v.d);
+                memcpy(&bits,&i,8);
+            }else{
+                double d=v.isInteger?double(v.i):v.d;
+                memcpy(&bits,&d,8);
+            }
+            _columns[c++].push_back(bits);
+        }
+        _rows++;
+        if (_rows>=_blockRows)writeBlock();
+    }
+    /** @brief write out all rows so far and wait for them to reach the file */
+    void flush(){
+        writeBlock();
+        _out.flush();
+    }
+    /** @brief write out all rows so far and close the file */
+    void close(){
+        if (!_out.is_open())return;
+        writeBlock();
+        _out.close();
+    }
+    /** @brief the memory held in the current block and the output buffers, in bytes */
+    size_t memoryUsed(){
+        size_t bytes=_out.memoryUsed();
+        for (auto& c:_columns)bytes+=c.capacity()*sizeof(uint64_t);
+        return bytes;
+    }
+    /** @brief check whether a file is open */
+    bool is_open(){
+        return _out.is_open();
+    }
+    /** @brief the total time spent writing to disk in the background so far, in seconds */
+    double writeSeconds(){
+        return _out.writeSeconds();
+    }
+};
+#endif // SERIESWRITER_H_INCLUDED
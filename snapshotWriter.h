@@ -0,0 +1,222 @@
+#ifndef SNAPSHOTWRITER_H_INCLUDED
+#define SNAPSHOTWRITER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file snapshotWriter.h
+ * @brief File containing the definition of the \ref snapshotWriter class, for compressed snapshots of every place
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstdio>
+#include<cstring>
+#include<string>
+#include<vector>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<chrono>
+#include<iostream>
+#include"traceRecorder.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Saves the state of every place (contamination, and optionally occupancy) every so many steps, compressing and writing in the background
+    @details The model copies the values for every place into one of two buffers (see \ref buffer and \ref submit) - this is all the step has to pay for.\n
+    A background thread then compresses the buffer and writes it out while the model carries on, and the model only waits if it comes back to\n
+    the same buffer before the previous snapshot in it has been written.\n
+    Compression: most places have no contamination, and many don't change between snapshots, so each value is XORed with its value in the\n
+    previous snapshot (giving zero wherever nothing has changed) and the result is then run-length encoded as a sequence of tokens:-\n
+    a 64 bit word holding (number of zero values)<<32 | (number of non-zero values), followed by the non-zero values themselves.\n
+    File layout - all values are 64 bit:-
+    \code
+    header:   "MOPSNAPS" | version | byte order check 0x01020304 | number of places n | number of columns | place IDs[n]
+    snapshot: step | for each column: number of words m | the m compressed words
+    \endcode
+    Column 0 is the contamination level (as the bits of a double), and column 1 (if present) the occupancy count. The first snapshot is\n
+    compared against all zeros. See experiments/mopatopReader.py for a reader.
+*/
+class snapshotWriter{
+    /** @brief the file being written */
+    FILE* _file=nullptr;
+    /** @brief number of places in each snapshot */
+    uint64_t _nPlaces=0;
+    /** @brief number of values stored for each place */
+    int _nColumns=1;
+    /** @brief the two buffers the model copies the place values into, each holding all the columns one after another */
+    std::vector<uint64_t> _buffers[2];
+    /** @brief the step number for each buffer */
+    long _steps[2];
+    /** @brief true when a buffer has been filled and not yet written */
+    bool _full[2]={false,false};
+    /** @brief the buffer the model will fill next */
+    int _next=0;
+    /** @brief the previous snapshot, used by the background thread for the XOR */
+    std::vector<uint64_t> _previous;
+    /** @brief space for the compressed snapshot */
+    std::vector<uint64_t> _compressed;
+    /** @brief set to stop the background thread */
+    bool _stop=false;
+    /** @brief protects the buffer flags */
+    std::mutex _lock;
+    /** @brief signals a change in the buffer flags */
+    std::condition_variable _changed;
+    /** @brief the background thread */
+    std::thread _writer;
+    /** @brief total bytes written */
+    uint64_t _bytesWritten=0;
+    /** @brief number of snapshots written */
+    uint64_t _snapshotsWritten=0;
+    /** @brief total time spent by the background thread compressing and writing */
+    std::chrono::steady_clock::duration _writeTime{0};
+    //------------------------------------------------------------------------
+    /** @brief XOR a column against the previous snapshot and run-length encode the zeros
+        @param now the values in this snapshot
+        @param previous the values in the previous snapshot - updated to the current values
+        @param out the compressed words are added to the end of this */
+    void compress(const uint64_t* now,uint64_t* previous,std::vector<uint64_t>& out){
+        uint64_t i=0;
+        while (i<_nPlaces){
+            uint64_t zeros=0,literals=0;
+            while (i<_nPlaces && now[i]==previous[i]){zeros++;i++;}
+            uint64_t start=i;
+            while (i<_nPlaces && now[i]!=previous[i]){literals++;i++;}
+            out.push_back((zeros<<32)|literals);
+            for (uint64_t k=start;k<i;k++){
+                out.push_back(now[k]^previous[k]);
+                previous[k]=now[k];
+            }
+        }
+    }
+    /** @brief the background thread - compress and write out each buffer as it is filled */
+    void run(){
+        traceRecorder::nameThread("snapshotWriter");
+        int b=0;
+        std::unique_lock<std::mutex> guard(_lock);
+        while (true){
+            _changed.wait(guard,[this,b]{return _stop || _full[b];});
+            if (!_full[b])break;
+            //the model won't touch this buffer until it is marked empty, so no need to hold the lock
+            guard.unlock();
+            auto start=std::chrono::steady_clock::now();
+            traceRecorder::span s("compress and write snapshot","io");
+            int64_t step=_steps[b];
+            fwrite(&step,8,1,_file);
+            uint64_t bytes=8;
+            for (int c=0;c<_nColumns;c++){
+                _compressed.clear();
+                compress(_buffers[b].data()+c*_nPlaces,_previous.data()+c*_nPlaces,_compressed);
+                uint64_t m=_compressed.size();
+                fwrite(&m,8,1,_file);
+                fwrite(_compressed.data(),8,m,_file);
+                bytes+=8*(m+1);
+            }
+            auto end=std::chrono::steady_clock::now();
+            guard.lock();
+            _writeTime+=end-start;
+            _bytesWritten+=bytes;
+            _snapshotsWritten++;
+            _full[b]=false;
+            _changed.notify_all();
+            b=1-b;
+        }
+    }
+public:
+    /** @brief finish writing and stop the background thread */
+    ~snapshotWriter(){
+        close();
+    }
+    /** @brief open the file, write the header and start the background thread
+        @param fileName the path of the file
+        @param placeIDs the ID of each place, in the order the values will be given
+        @param occupancy if true, store the number of occupants of each place as well as the contamination */
+    void open(std::string fileName,const std::vector<uint64_t>& placeIDs,bool occupancy){
+        close();
+        _file=fopen(fileName.c_str(),"wb");
+        if (_file==nullptr){
+            std::cout<<"Unable to open snapshot file "<<fileName<<std::endl;
+            exit(1);
+        }
+        _nPlaces=placeIDs.size();
+        _nColumns=occupancy?2:1;
+        for (int b=0;b<2;b++){_buffers[b].assign(_nColumns*_nPlaces,0);_full[b]=false;}
+        _previous.assign(_nColumns*_nPlaces,0);
+        _compressed.reserve(_nPlaces+1);
+        _next=0;
+        uint64_t header[4]={1,0x01020304,_nPlaces,uint64_t(_nColumns)};
+        fwrite("MOPSNAPS",1,8,_file);
+        fwrite(header,8,4,_file);
+        fwrite(placeIDs.data(),8,_nPlaces,_file);
+        _bytesWritten=8*(5+_nPlaces);
+        _snapshotsWritten=0;
+        _stop=false;
+        _writer=std::thread(&snapshotWriter::run,this);
+    }
+    /** @brief wait for the remaining snapshots to be written, then close the file */
+    void close(){
+        if (_file==nullptr)return;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            _stop=true;
+        }
+        _changed.notify_all();
+        _writer.join();
+        fclose(_file);
+        _file=nullptr;
+    }
+    /** @brief the memory held in the snapshot buffers, in bytes */
+    size_t memoryUsed(){
+        return sizeof(uint64_t)*(_buffers[0].capacity()+_buffers[1].capacity()+_previous.capacity()+_compressed.capacity());
+    }
+    /** @brief check whether a file is open */
+    bool is_open(){
+        return _file!=nullptr;
+    }
+    /** @brief get the next buffer to fill, waiting if the background thread is still writing it
+        @return a pointer to space for the contamination of each place (as doubles), followed, if occupancy is being stored, by the occupancy of each place (as 64 bit integers) */
+    uint64_t* buffer(){
+        std::unique_lock<std::mutex> guard(_lock);
+        _changed.wait(guard,[this]{return !_full[_next];});
+        return _buffers[_next].data();
+    }
+    /** @brief hand the buffer just filled over to be written
+        @param step the step number to label the snapshot with */
+    void submit(long step){
+        std::lock_guard<std::mutex> guard(_lock);
+        _steps[_next]=step;
+        _full[_next]=true;
+        _next=1-_next;
+        _changed.notify_all();
+    }
+    /** @brief the number of columns stored for each place */
+    int nColumns(){
+        return _nColumns;
+    }
+    /** @brief the total time the background thread has spent compressing and writing so far, in seconds */
+    double writeSeconds(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return std::chrono::duration<double>(_writeTime).count();
+    }
+    /** @brief the number of bytes written so far, compared with the size of the same snapshots without compression
+        @return the compressed size as a fraction of the uncompressed size*/
+    double compressionRatio(){
+        std::lock_guard<std::mutex> guard(_lock);
+        return double(_bytesWritten)/double(8*(5+_nPlaces+_snapshotsWritten*(1+_nColumns*(_nPlaces+1))));
+    }
+};
+#endif // SNAPSHOTWRITER_H_INCLUDED
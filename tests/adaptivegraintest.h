@@ -0,0 +1,84 @@
+#ifndef ADAPTIVEGRAINTEST_H_INCLUDED
+#define ADAPTIVEGRAINTEST_H_INCLUDED
+#include "../adaptiveGrain.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file adaptivegraintest.h 
+ * @brief File containing the definition of the adaptiveGrainTest class for the chunk sizes of dynamically scheduled loops
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the adaptive chunk size
+ *  @details Check that the chunk size moves towards the target time per chunk, and is capped for short loops.*/
+class adaptiveGrainTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( adaptiveGrainTest );
+    /** @brief convergence test */
+    CPPUNIT_TEST( testAdapt );
+    /** @brief capping test */
+    CPPUNIT_TEST( testCap );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief at 100ns per item and a 50 microsecond target, chunks should settle at 500 items, and grow if the items get cheaper */
+    void testAdapt()
+    {
+        adaptiveGrain g(50.);
+        for (int k=0;k<20;k++){
+            g.record(60000000);
+            g.record(40000000);
+            g.adapt(1000000);
+        }
+        CPPUNIT_ASSERT(g.current()>=495 && g.current()<=505);
+        //nothing recorded - no change
+        g.adapt(1000000);
+        CPPUNIT_ASSERT(g.current()>=495 && g.current()<=505);
+        for (int k=0;k<20;k++){
+            g.record(10000000);
+            g.adapt(1000000);
+        }
+        CPPUNIT_ASSERT(g.current()>=4950 && g.current()<=5050);
+        //very expensive items still leave a chunk big enough to be worth taking
+        for (int k=0;k<40;k++){
+            g.record(1000000000);
+            g.adapt(10);
+        }
+        CPPUNIT_ASSERT(g.current()==16);
+    }
+    /** @brief a short loop should still give each thread at least four chunks, and never less than one item */
+    void testCap()
+    {
+        adaptiveGrain g(50.);
+        for (int k=0;k<20;k++){
+            g.record(1000000);
+            g.adapt(1000000);
+        }
+        CPPUNIT_ASSERT(g.current()>1000);
+        CPPUNIT_ASSERT(g.grain(1000000,4)==g.current());
+        CPPUNIT_ASSERT(g.grain(800,4)==50);
+        CPPUNIT_ASSERT(g.grain(3,4)==1);
+        CPPUNIT_ASSERT(g.grain(0,0)==1);
+    }
+};
+#endif // ADAPTIVEGRAINTEST_H_INCLUDED
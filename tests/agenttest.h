@@ -177,15 +177,15 @@ public:
         //put contamination to over 1 - guarantees infectious!
         b.getCurrentPlace()->increaseContamination(1);
         randomizer r;
-        //b should be immune
-        b.process_disease(r);
+        //b should be immune - so no new infection is reported
+        CPPUNIT_ASSERT(!b.process_disease(r));
         CPPUNIT_ASSERT(!b.diseased());
         //a is dead!
         a.process_disease(r);
         CPPUNIT_ASSERT(!a.diseased());
-        //new agent should get infected
+        //new agent should get infected, and report that it has been
         c.setHome(&p);
-        c.process_disease(r);
+        CPPUNIT_ASSERT(c.process_disease(r));
         CPPUNIT_ASSERT(c.diseased());
         //store disease default recovery rate- needed for later tests
         double k=disease::getRecoveryRate();
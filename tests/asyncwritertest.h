@@ -0,0 +1,79 @@
+#ifndef ASYNCWRITERTEST_H_INCLUDED
+#define ASYNCWRITERTEST_H_INCLUDED
+#include "../asyncWriter.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file asyncwritertest.h 
+ * @brief File containing the definition of the asyncWriterTest class for the background output writer
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the background output writer
+ *  @details Check that values are formatted like a std::ostream would, and that everything written arrives in the file, in order.*/
+class asyncWriterTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( asyncWriterTest );
+    /** @brief formatting test */
+    CPPUNIT_TEST( testFormat );
+    /** @brief large output test */
+    CPPUNIT_TEST( testManyBuffers );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief numbers should look the same as they would from std::ostream, and append should add to the end of the file */
+    void testFormat()
+    {
+        asyncWriter w;
+        w.open("./output/asyncWriterTest.csv");
+        std::stringstream expected;
+        w       <<1<<","<<-7L<<","<<600UL<<","<<0.5<<","<<1e-7<<","<<123456789.<<","<<std::string("a")<<'\n';
+        expected<<1<<","<<-7L<<","<<600UL<<","<<0.5<<","<<1e-7<<","<<123456789.<<","<<std::string("a")<<'\n';
+        w.close();
+        w.open("./output/asyncWriterTest.csv",true);
+        w<<2.25<<"\n";
+        expected<<2.25<<"\n";
+        w.flush();
+        std::ifstream f("./output/asyncWriterTest.csv");
+        std::stringstream got;
+        got<<f.rdbuf();
+        CPPUNIT_ASSERT(got.str()==expected.str());
+    }
+    /** @brief output bigger than one buffer should all arrive, in order */
+    void testManyBuffers()
+    {
+        asyncWriter w;
+        w.open("./output/asyncWriterTest.csv");
+        for (long i=0;i<500000;i++)w<<i<<"\n";
+        w.flush();
+        std::ifstream f("./output/asyncWriterTest.csv");
+        long i=0,v;
+        while (f>>v){
+            CPPUNIT_ASSERT(v==i);
+            i++;
+        }
+        CPPUNIT_ASSERT(i==500000);
+    }
+};
+
+#endif // ASYNCWRITERTEST_H_INCLUDED
@@ -0,0 +1,276 @@
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file couplerDriver.cpp
+ * @brief Test the exchange of agents between MPI domains by the \ref MUIcoupler, with one domain per MPI rank
+ * @details The cppunit tests run in a single process, so can't check the coupler - this program is run under mpiexec instead, and each\n
+ * rank makes its own domain (named domain0, domain1...) with 100 made-up agents, whose IDs say which rank they started on. The checks\n
+ * send some of them to another domain, send them back, and check that the right agents arrived with the right state. The coupler keeps\n
+ * track of agents away and of free traveller slots between exchanges, so every check uses the same lists of locals and travellers. Each check prints a line, and any failure is counted - the\n
+ * program exits with status 1 on every rank if any rank had a failure. A last check shares the contamination of places used by agents of more\n
+ * than one domain, as when a population is split between the domains, and another moves homes from a slow domain to the others.\n
+ * Build and run with "make couplertest WITH_MPI_COUPLER=1" from the main model directory (set MPIEXEC if mpiexec needs extra options).
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<iostream>
+#include<string>
+#include<vector>
+#include<cmath>
+#include"../model.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief the number of failed checks on this rank */
+int failures=0;
+/** @brief count and report a check
+    @param ok true if the check passed
+    @param domain the name of this domain
+    @param what a description of the check */
+void check(bool ok,std::string domain,std::string what){
+    if (!ok){
+        failures++;
+        std::cout<<"Domain "<<domain<<": FAILED "<<what<<std::endl;
+    }
+}
+//------------------------------------------------------------------------
+/** @brief every domain sends the packed records of agents 0 to 9, with alternate agents diseased, to the next domain - and with more\n
+    than two domains agents 10 to 14 to the one after that - and then they are all sent home recovered
+    @details with two domains the agents are given no destination, so go to the other domain by default. Checks that the right number of\n
+    travellers arrive, that they have the IDs and disease state they left with, that each came from the domain that should have sent it\n
+    and will go back there, and that every local is back and active, with the state set while it was away
+    @param c the coupler
+    @param domain the name of this domain
+    @param rank this rank
+    @param size the number of domains
+    @param locals the agents that live on this domain
+    @param travellers the agents visiting from other domains */
+void checkRoundTrip(MUIcoupler& c,std::string domain,int rank,int size,std::vector<agent*>& locals,std::vector<agent*>& travellers){
+    int sent=(size>2)?15:10;
+    for (int i=0;i<sent;i++){
+        locals[i]->leaveDomain();
+        locals[i]->setDiseased(i%2);
+        if (size>2)locals[i]->setDestination((rank+(i<10?1:2))%size);
+    }
+    c.exchange(0,locals,travellers,true);
+    int active=0;
+    for (auto t:travellers)if (t->active())active++;
+    check(active==sent,domain,"round trip: "+std::to_string(sent)+" travellers should arrive, got "+std::to_string(active));
+    for (auto t:travellers){
+        if (!t->active())continue;
+        int source=t->getID()/1000,k=t->getID()%1000;
+        check(k<sent && (source+(k<10?1:2))%size==rank,domain,"round trip: traveller "+std::to_string(t->getID())+" should not have come here");
+        check(t->destination()==source,domain,"round trip: traveller "+std::to_string(t->getID())+" would go home to domain "+std::to_string(t->destination()));
+        check(t->diseased()==bool(k%2),domain,"round trip: traveller "+std::to_string(t->getID())+" has the wrong disease state");
+        t->leaveDomain();
+        t->setRecovered(true);
+    }
+    c.exchange(1,locals,travellers,true);
+    for (int i=0;i<100;i++){
+        check(locals[i]->active(),domain,"round trip: local "+std::to_string(i)+" is not back");
+        check(locals[i]->recovered()==(i<sent),domain,"round trip: local "+std::to_string(i)+" has the wrong recovered state");
+    }
+    for (auto t:travellers)check(!t->active(),domain,"round trip: traveller "+std::to_string(t->getID())+" did not go home");
+}
+//------------------------------------------------------------------------
+/** @brief three rounds of sending a different ten agents away to the next domain and back again
+    @details checks that travellers that have gone home are re-used for the next arrivals (so the traveller list does not grow), and that\n
+    each agent coming home finds its own local copy by ID, with the state it was given while away
+    @param c the coupler
+    @param domain the name of this domain
+    @param rank this rank
+    @param size the number of domains
+    @param locals the agents that live on this domain
+    @param travellers the agents visiting from other domains - at least ten slots, all free, left by \ref checkRoundTrip
+    @param time the first step to use - exchanges must be on increasing steps */
+void checkReuse(MUIcoupler& c,std::string domain,int rank,int size,std::vector<agent*>& locals,std::vector<agent*>& travellers,int time){
+    unsigned long slots=travellers.size();
+    for (int round=0;round<3;round++){
+        int first=10*round;
+        for (int i=first;i<first+10;i++){
+            locals[i]->leaveDomain();
+            locals[i]->setDestination((rank+1)%size);
+        }
+        c.exchange(time++,locals,travellers,true);
+        check(travellers.size()==slots,domain,"reuse: round "+std::to_string(round)+" has "+std::to_string(travellers.size())+" traveller slots, not "+std::to_string(slots));
+        for (auto t:travellers){
+            if (!t->active())continue;
+            int k=t->getID()%1000;
+            check(k>=first && k<first+10,domain,"reuse: traveller "+std::to_string(t->getID())+" should not have been sent this round");
+            t->leaveDomain();
+            t->setImmune(true);
+        }
+        c.exchange(time++,locals,travellers,true);
+        for (int i=0;i<100;i++){
+            check(locals[i]->active(),domain,"reuse: local "+std::to_string(i)+" is not back");
+            check(locals[i]->immune()==(i<first+10),domain,"reuse: local "+std::to_string(i)+" has the wrong immune state");
+        }
+    }
+}
+//------------------------------------------------------------------------
+/** @brief with an exchange lag of two steps, three agents on domain 0 decide to leave at step 0 - they should stay (still active) for\n
+    two steps, and arrive on domain 1 at step 2, not before
+    @details uses its own coupler, as the lag is set when the coupler is made
+    @param domain the name of this domain
+    @param rank this rank */
+void checkLag(std::string domain,int rank){
+    const int lag=2;
+    MUIcoupler c(domain+"lag","packed",lag);
+    std::vector<agent*> locals,travellers;
+    for (int i=0;i<20;i++)locals.push_back(new agent(rank*1000+i));
+    if (rank==0)for (int i=0;i<3;i++){
+        locals[i]->leaveDomain();
+        locals[i]->setDestination(1);
+    }
+    for (int time=0;time<6;time++){
+        bool leavers=false;
+        for (auto a:locals)leavers=leavers || a->leaver();
+        c.exchange(time,locals,travellers,leavers);
+        int arrived=0;
+        for (auto t:travellers)if (t->active())arrived++;
+        if (rank==0)check(locals[0]->active()==(time<lag),domain,"lag: at step "+std::to_string(time)+" agent 0 should "+(time<lag?"still be here":"have left"));
+        if (rank==1)check(arrived==(time<lag?0:3),domain,"lag: "+std::to_string(arrived)+" travellers here at step "+std::to_string(time));
+    }
+    c.finish();
+    for (auto a:locals)delete a;
+    for (auto a:travellers)delete a;
+}
+//------------------------------------------------------------------------
+/** @brief every domain has the same places, and two agents - one living in place 0, and one in a place of its own. Only place 0 should\n
+    be shared, and once each domain has added contamination to both in two steps, place 0 should hold the sum over all the domains, and\n
+    each domain's own place just what that domain added
+    @param c the coupler
+    @param domain the name of this domain
+    @param rank this rank
+    @param size the number of domains */
+void checkSharedPlaces(MUIcoupler& c,std::string domain,int rank,int size){
+    std::vector<place*> places;
+    for (int p=0;p<=size;p++){
+        places.push_back(new place());
+        places.back()->setID(100+p);
+    }
+    std::vector<agent*> locals;
+    for (int p:{0,rank+1}){
+        agent* a=new agent(rank*1000+p);
+        a->setHome(places[p]);
+        a->setWork(places[p]);
+        a->setTransport(places[p]);
+        locals.push_back(a);
+    }
+    c.setupSharedPlaces(true,locals,places);
+    check(c.sharesPlaces(),domain,"shared places: places are not shared");
+    for (int step=0;step<2;step++){
+        #pragma omp parallel
+        {
+            c.noteContamination();
+            #pragma omp single
+            for (auto a:locals)a->getHome()->increaseContamination(rank+1);
+            c.shareContamination();
+        }
+    }
+    double all=size*(size+1);
+    check(std::abs(places[0]->getContaminationLevel()-all)<1e-9,domain,"shared places: place 0 has "+std::to_string(places[0]->getContaminationLevel())+", not "+std::to_string(all));
+    for (int p=1;p<=size;p++){
+        double mine=(p==rank+1)?2*(rank+1):0;
+        check(std::abs(places[p]->getContaminationLevel()-mine)<1e-9,domain,"shared places: place "+std::to_string(p)+" has "+std::to_string(places[p]->getContaminationLevel())+", not "+std::to_string(mine));
+    }
+    for (auto a:locals)delete a;
+    for (auto p:places)delete p;
+}
+//------------------------------------------------------------------------
+/** @brief every domain has ten homes of its own, each with two agents and some contamination, and domain 0 says it is ten times slower than\n
+    the others, so a rebalance should move some of its homes to other domains
+    @details checks that no agent is lost, that agents keep their IDs, that households stay together, and that every agent's home has the\n
+    contamination it had on the domain the agent came from
+    @param c the coupler
+    @param domain the name of this domain
+    @param rank this rank
+    @param size the number of domains */
+void checkRebalance(MUIcoupler& c,std::string domain,int rank,int size){
+    std::vector<place*> places;
+    for (int p=0;p<10*size;p++){
+        places.push_back(new place());
+        places.back()->setID(200+p);
+        if (p/10==rank)places.back()->setContaminationLevel(p+1);
+    }
+    std::vector<agent*> locals;
+    for (int k=0;k<20;k++){
+        agent* a=new agent(rank*1000+k);
+        place* home=places[10*rank+k/2];
+        a->setHome(home);
+        a->setWork(home);
+        a->setTransport(home);
+        locals.push_back(a);
+    }
+    c.setupSharedPlaces(true,locals,places);
+    c.setupRebalance(1,0.1,1,places);
+    check(c.rebalanceDue(1),domain,"rebalance: not due at step 1");
+    c.rebalance(1,locals,places,rank==0?10.:1.);
+    long total=c.sumOverDomains(locals.size());
+    check(total==20*size,domain,"rebalance: "+std::to_string(total)+" agents left, not "+std::to_string(20*size));
+    if (rank==0)check(locals.size()<20,domain,"rebalance: the slow domain sent no agents");
+    long IDs=0;
+    for (auto a:locals)IDs+=a->getID();
+    IDs=c.sumOverDomains(IDs);
+    long expected=20000L*size*(size-1)/2+190L*size;
+    check(IDs==expected,domain,"rebalance: agent IDs add up to "+std::to_string(IDs)+", not "+std::to_string(expected));
+    std::vector<int> residents(places.size(),0);
+    for (auto a:locals){
+        long p=a->getHome()->getID()-200;
+        residents[p]++;
+        check(a->getID()/1000==p/10 && a->getID()%1000/2==p%10,domain,"rebalance: agent "+std::to_string(a->getID())+" has the wrong home");
+        check(std::abs(a->getHome()->getContaminationLevel()-(p+1))<1e-9,domain,"rebalance: home "+std::to_string(p)+" of agent "+std::to_string(a->getID())
+              +" has contamination "+std::to_string(a->getHome()->getContaminationLevel())+", not "+std::to_string(p+1));
+    }
+    for (unsigned long p=0;p<places.size();p++)check(residents[p]==0 || residents[p]==2,domain,"rebalance: home "+std::to_string(p)+" was split up");
+    for (auto a:locals)delete a;
+    for (auto p:places)delete p;
+}
+//------------------------------------------------------------------------
+int main(int argc,char** argv){
+    int started=0;
+    MPI_Initialized(&started);
+    //sharing places makes MPI calls from the master thread of a parallel region
+    int provided=0;
+    if (!started)MPI_Init_thread(&argc,&argv,MPI_THREAD_FUNNELED,&provided);
+    int rank=0,size=1;
+    MPI_Comm_rank(MPI_COMM_WORLD,&rank);
+    MPI_Comm_size(MPI_COMM_WORLD,&size);
+    if (size<2){
+        std::cout<<"Run the coupler test on at least 2 MPI ranks"<<std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    std::string domain="domain"+std::to_string(rank);
+    MUIcoupler c(domain,"packed");
+    std::vector<agent*> locals,travellers;
+    for (int i=0;i<100;i++)locals.push_back(new agent(rank*1000+i));
+    check(c.domains().size()==unsigned(size) && c.domains()[rank]==domain,domain,"the coupler has the wrong list of domains");
+    checkRoundTrip(c,domain,rank,size,locals,travellers);
+    checkReuse(c,domain,rank,size,locals,travellers,2);
+    checkLag(domain,rank);
+    checkSharedPlaces(c,domain,rank,size);
+    checkRebalance(c,domain,rank,size);
+    c.finish();
+    for (auto a:locals)delete a;
+    for (auto a:travellers)delete a;
+    int total=failures;
+    MPI_Allreduce(MPI_IN_PLACE,&total,1,MPI_INT,MPI_SUM,MPI_COMM_WORLD);
+    if (rank==0)std::cout<<"Coupler test on "<<size<<" domains: "<<total<<" failures"<<std::endl;
+    MPI_Finalize();
+    return total>0?1:0;
+}
@@ -0,0 +1,85 @@
+#ifndef DOMAINBALANCERTEST_H_INCLUDED
+#define DOMAINBALANCERTEST_H_INCLUDED
+#include "../domainBalancer.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file domainbalancertest.h 
+ * @brief File containing the definition of the domainBalancerTest class for planning moves of agents between MPI domains
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the domain balancer
+ *  @details Give the balancer made-up times for each domain, and check the moves it plans.*/
+class domainBalancerTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( domainBalancerTest );
+    /** @brief planning test */
+    CPPUNIT_TEST( testPlan );
+    /** @brief cooldown test */
+    CPPUNIT_TEST( testCooldown );
+    /** @brief smoothing test */
+    CPPUNIT_TEST( testSmoothing );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief domains within the tolerance move nothing - a slow one sends half its excess to the fastest */
+    void testPlan()
+    {
+        domainBalancer B;
+        B.setup(0.1,3);
+        CPPUNIT_ASSERT(B.plan({1.,1.05,0.98},{100,100,100}).empty());
+        B.setup(0.1,3);
+        auto moves=B.plan({2.,1.,0.5},{100,100,100});
+        CPPUNIT_ASSERT(moves.size()==1);
+        CPPUNIT_ASSERT(moves[0].from==0);
+        CPPUNIT_ASSERT(moves[0].to==2);
+        //mean 7/6 - domain 0 has 100*(1-7/12)=41.7 agents too many, domain 2 room for 100*(7/3-1)=133.3
+        CPPUNIT_ASSERT(moves[0].agents==20);
+        CPPUNIT_ASSERT(std::abs(7./6.-B.smoothed()[0])<1.e-12);
+        CPPUNIT_ASSERT(std::abs(7./6.-B.smoothed()[2])<1.e-12);
+    }
+    /** @brief two domains that have just swapped agents cannot swap them back until the cooldown is over */
+    void testCooldown()
+    {
+        domainBalancer B;
+        B.setup(0.1,3);
+        auto moves=B.plan({2.,1.},{100,100});
+        CPPUNIT_ASSERT(moves.size()==1 && moves[0].from==0 && moves[0].to==1 && moves[0].agents==12);
+        //domain 1 is now much the slower, but must wait three rebalances
+        for (int round=0;round<3;round++)CPPUNIT_ASSERT(B.plan({1.,3.},{88,112}).empty());
+        moves=B.plan({1.,3.},{88,112});
+        CPPUNIT_ASSERT(moves.size()==1 && moves[0].from==1 && moves[0].to==0);
+    }
+    /** @brief one slow interval is averaged with the ones before, so does not move agents on its own */
+    void testSmoothing()
+    {
+        domainBalancer B;
+        B.setup(0.1,3);
+        CPPUNIT_ASSERT(B.plan({1.,1.},{100,100}).empty());
+        CPPUNIT_ASSERT(B.plan({1.,1.4},{100,100}).empty());
+        CPPUNIT_ASSERT(std::abs(1.2-B.smoothed()[1])<1.e-12);
+        CPPUNIT_ASSERT(!B.plan({1.,1.4},{100,100}).empty());
+    }
+};
+#endif // DOMAINBALANCERTEST_H_INCLUDED
@@ -0,0 +1,102 @@
+#ifndef DOMAINPARTITIONTEST_H_INCLUDED
+#define DOMAINPARTITIONTEST_H_INCLUDED
+#include "../domainPartition.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file domainpartitiontest.h 
+ * @brief File containing the definition of the domainPartitionTest class for splitting a population between MPI domains
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the domain partition
+ *  @details Build populations of separate towns, with and without commuters between them, and check the split keeps towns together.*/
+class domainPartitionTest : public CppUnit::TestFixture  {
+    /** @brief the columns of a test population */
+    std::vector<uint32_t> home,work,vehicle;
+    /** @brief make towns of 40 homes, 4 workplaces and 2 buses, with 200 agents each, numbering the places town by town
+        @param nTowns the number of towns
+        @param commuters every this many agents works in the next town along, or zero for none
+        @return the number of places */
+    uint32_t towns(int nTowns,int commuters){
+        home.clear();work.clear();vehicle.clear();
+        const uint32_t perTown=46;
+        for (int t=0;t<nTowns;t++){
+            for (int i=0;i<200;i++){
+                int workTown=(commuters>0 && i%commuters==0)?(t+1)%nTowns:t;
+                home.push_back(t*perTown+i/5);
+                work.push_back(workTown*perTown+40+i%4);
+                vehicle.push_back(workTown*perTown+44+i%2);
+            }
+        }
+        return nTowns*perTown;
+    }
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( domainPartitionTest );
+    /** @brief separate towns test */
+    CPPUNIT_TEST( testSeparateTowns );
+    /** @brief commuter test */
+    CPPUNIT_TEST( testCommuters );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief four towns with no agents in common should give one town per domain, with nothing cut */
+    void testSeparateTowns()
+    {
+        uint32_t nPlaces=towns(4,0);
+        domainPartition D;
+        D.build(nPlaces,home.size(),home.data(),work.data(),vehicle.data(),4);
+        CPPUNIT_ASSERT(D.domains()==4);
+        CPPUNIT_ASSERT(D.edgeCut()==0);
+        CPPUNIT_ASSERT(D.sharedPlaces()==0);
+        std::vector<uint64_t> a=D.agentCounts(),p=D.placeCounts();
+        for (int d=0;d<4;d++)CPPUNIT_ASSERT(a[d]==200 && p[d]==46);
+        for (uint32_t i=0;i<home.size();i++){
+            CPPUNIT_ASSERT(D.agentDomain(i)==D.placeDomain(home[i]));
+            CPPUNIT_ASSERT(D.placeDomain(work[i])==D.placeDomain(home[i]));
+        }
+    }
+    /** @brief with a few commuters between eight towns in a ring, splitting in two should cut only the commuters across two of the links,\n
+        keep the domains balanced, give each agent the domain of most of its places, and give the same answer every time */
+    void testCommuters()
+    {
+        uint32_t nPlaces=towns(8,10);
+        domainPartition D,E;
+        D.build(nPlaces,home.size(),home.data(),work.data(),vehicle.data(),2);
+        E.build(nPlaces,home.size(),home.data(),work.data(),vehicle.data(),2);
+        //20 commuters leave each town - cutting the ring in two places cuts 40 homes from work and vehicle
+        CPPUNIT_ASSERT(D.edgeCut()<=2*20);
+        //a place used by agents of two domains has at least one cut edge
+        CPPUNIT_ASSERT(D.sharedPlaces()>0 && D.sharedPlaces()<=D.edgeCut());
+        std::vector<uint64_t> a=D.agentCounts();
+        CPPUNIT_ASSERT(a[0]+a[1]==1600);
+        CPPUNIT_ASSERT(a[0]<=1600*0.53 && a[1]<=1600*0.53);
+        for (uint32_t i=0;i<home.size();i++){
+            int h=D.placeDomain(home[i]),w=D.placeDomain(work[i]),v=D.placeDomain(vehicle[i]);
+            CPPUNIT_ASSERT(D.agentDomain(i)==((w==v)?w:h));
+            CPPUNIT_ASSERT(D.agentDomain(i)==E.agentDomain(i));
+        }
+        for (uint32_t p=0;p<nPlaces;p++)CPPUNIT_ASSERT(D.placeDomain(p)==E.placeDomain(p));
+    }
+};
+#endif // DOMAINPARTITIONTEST_H_INCLUDED
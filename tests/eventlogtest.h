@@ -0,0 +1,93 @@
+#ifndef EVENTLOGTEST_H_INCLUDED
+#define EVENTLOGTEST_H_INCLUDED
+#include "../eventLog.h"
+#include<omp.h>
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file eventlogtest.h 
+ * @brief File containing the definition of the eventLogTest class for the infection event log
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the infection event log
+ *  @details Record events from several threads at once and check every one reaches the file.*/
+class eventLogTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( eventLogTest );
+    /** @brief many threads test */
+    CPPUNIT_TEST( testThreads );
+    /** @brief final flush test */
+    CPPUNIT_TEST( testFlushKeepsLast );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief events recorded by four threads, with a budget small enough that chunks have to be re-used, should all be written exactly once */
+    void testThreads()
+    {
+        const long n=100000;
+        eventLog log;
+        log.open("./output/eventLogTest.evt",4,1,"block");
+        omp_set_num_threads(4);
+        #pragma omp parallel for
+        for (long i=0;i<n;i++)log.record(omp_get_thread_num(),i%7,i,2*i,i%3);
+        omp_set_num_threads(1);
+        log.close();
+        CPPUNIT_ASSERT(log.written()==uint64_t(n));
+        CPPUNIT_ASSERT(log.dropped()==0);
+        std::ifstream f("./output/eventLogTest.evt",std::ios::binary);
+        char header[24];
+        f.read(header,24);
+        CPPUNIT_ASSERT(std::string(header,8)=="MOPEVENT");
+        std::vector<int> seen(n,0);
+        infectionEvent e;
+        long count=0;
+        while (f.read((char*)&e,sizeof(e))){
+            CPPUNIT_ASSERT(e.agentID<uint64_t(n));
+            CPPUNIT_ASSERT(e.step==long(e.agentID%7) && e.placeID==2*e.agentID && e.placeType==int(e.agentID%3));
+            seen[e.agentID]++;
+            count++;
+        }
+        CPPUNIT_ASSERT(count==n);
+        for (auto s:seen)CPPUNIT_ASSERT(s==1);
+    }
+    /** @brief with the drop policy and the smallest budget, full chunks recorded faster than they are written may be dropped, but the\n
+        events still waiting in the part-filled chunk when the log is closed must all be written */
+    void testFlushKeepsLast()
+    {
+        const long n=3*4096+100;
+        eventLog log;
+        log.open("./output/eventLogDrop.evt",1,0,"drop");
+        for (long i=0;i<n;i++)log.record(0,0,i,i,0);
+        log.close();
+        CPPUNIT_ASSERT(log.written()+log.dropped()==uint64_t(n));
+        std::ifstream f("./output/eventLogDrop.evt",std::ios::binary);
+        f.seekg(24);
+        std::vector<int> seen(n,0);
+        infectionEvent e;
+        while (f.read((char*)&e,sizeof(e)))seen[e.agentID]++;
+        for (long i=3*4096;i<n;i++)CPPUNIT_ASSERT(seen[i]==1);
+    }
+};
+
+#endif // EVENTLOGTEST_H_INCLUDED
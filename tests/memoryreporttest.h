@@ -0,0 +1,89 @@
+#ifndef MEMORYREPORTTEST_H_INCLUDED
+#define MEMORYREPORTTEST_H_INCLUDED
+#include "../memoryReport.h"
+#include "../profiler.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file memoryreporttest.h 
+ * @brief File containing the definition of the memoryReportTest class for the memory accounting
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the memory report
+ *  @details Check the totals, object sizes and resident memory readings.*/
+class memoryReportTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( memoryReportTest );
+    /** @brief totals test */
+    CPPUNIT_TEST( testTotals );
+    /** @brief resident memory test */
+    CPPUNIT_TEST( testResident );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief detail lines should not be added to the totals, and objects from new should be at least as big as their sizeof */
+    void testTotals()
+    {
+        memoryReport m;
+        m.add("a",10,1000,memoryReport::perAgent);
+        m.addDetail("part of a",10,400);
+        m.add("b",5,500,memoryReport::perPlace);
+        m.add("c",1,50,memoryReport::fixed);
+        CPPUNIT_ASSERT(m.total()==1550);
+        CPPUNIT_ASSERT(m.total(memoryReport::perAgent)==1000);
+        CPPUNIT_ASSERT(m.total(memoryReport::perPlace)==500);
+        struct thing{double x[5];};
+        thing* t=new thing;
+        CPPUNIT_ASSERT(memoryReport::allocatedSize(t)>=sizeof(thing));
+        CPPUNIT_ASSERT(memoryReport::allocatedSize((thing*)nullptr)==sizeof(thing));
+        delete t;
+    }
+    /** @brief touching new memory in a profiled phase should show up in the resident memory, and in the peak growth for that phase */
+    void testResident()
+    {
+        CPPUNIT_ASSERT(memoryReport::residentBytes()>0);
+        profiler p;
+        int a=p.phase("a");
+        int b=p.phase("b");
+        p.enableMemory(true);
+        p.startStep(0);
+        uint64_t before=memoryReport::peakResidentBytes();
+        //more than the peak so far, so that the peak has to grow
+        size_t n=before+64*1024*1024;
+        {
+            profiler::scope s(p,a);
+            char* memory=(char*)malloc(n);
+            for (size_t i=0;i<n;i+=4096)memory[i]=1;
+            free(memory);
+        }
+        {
+            profiler::scope s(p,b);
+        }
+        CPPUNIT_ASSERT(memoryReport::peakResidentBytes()>=before+64*1024*1024);
+        CPPUNIT_ASSERT(p.peakGrowth(a)>=64*1024*1024);
+        CPPUNIT_ASSERT(p.peakGrowth(b)==0);
+    }
+};
+
+#endif // MEMORYREPORTTEST_H_INCLUDED
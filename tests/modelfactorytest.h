@@ -2,6 +2,7 @@
 #define MODELFACTORYTEST_H_INCLUDED
 
 #include"../modelFactory.h"
+#include<omp.h>
 /* A program to test the model of modelFactorys moving between places
     Copyright (C) 2021  Mike Bithell
 
@@ -41,6 +42,10 @@ public:
     CPPUNIT_TEST( testSelector );
     /** @brief check agent and place creation  */
     CPPUNIT_TEST( testCreation );
+    /** @brief check the population does not depend on the number of threads  */
+    CPPUNIT_TEST( testThreadIndependence );
+    /** @brief check the census factory place sizes  */
+    CPPUNIT_TEST( testCensus );
     /** @brief end the test suite   */
     CPPUNIT_TEST_SUITE_END();
     /** @brief make sure the selector works */
@@ -90,6 +95,60 @@ public:
         }
         CPPUNIT_ASSERT(agents[10]->getWork()==agents[10]->getCurrentPlace());
     }
+    /** @brief the same agents should end up in the same places whatever the number of threads used to build them*/
+    void testThreadIndependence()
+    {
+        parameterSettings pr;
+        std::vector<agent*> agents1,agents4;
+        std::vector<place*> places1,places4;
+        modelFactory& F=modelFactorySelector::select("simpleMobile");
+        omp_set_num_threads(1);
+        F.createAgents(pr,agents1,places1,"a");
+        omp_set_num_threads(4);
+        F.createAgents(pr,agents4,places4,"a");
+        omp_set_num_threads(1);
+        CPPUNIT_ASSERT(agents1.size()==agents4.size());
+        for (unsigned long i=0;i<agents1.size();i++){
+            CPPUNIT_ASSERT(agents1[i]->getHome()->getID()==agents4[i]->getHome()->getID());
+            CPPUNIT_ASSERT(agents1[i]->getWork()->getID()==agents4[i]->getWork()->getID());
+            CPPUNIT_ASSERT(agents1[i]->getTransport()->getID()==agents4[i]->getTransport()->getID());
+            //IDs are taken in blocks, so the second set follows on from the first
+            CPPUNIT_ASSERT(agents4[i]->getID()==agents1[i]->getID()+agents1.size());
+        }
+    }
+    /** @brief places built from the census size table should have sizes from the table, and not depend on the number of threads*/
+    void testCensus()
+    {
+        parameterSettings pr;
+        pr.setParameter("model.census.sizeTable","testCensusTable");
+        pr.setParameter("model.census.chunkSize","100");
+        std::vector<agent*> agents1,agents4;
+        std::vector<place*> places1,places4;
+        modelFactory& F=modelFactorySelector::select("census");
+        omp_set_num_threads(1);
+        F.createAgents(pr,agents1,places1,"a");
+        omp_set_num_threads(4);
+        F.createAgents(pr,agents4,places4,"a");
+        omp_set_num_threads(1);
+        CPPUNIT_ASSERT(agents1.size()==600);
+        CPPUNIT_ASSERT(places1.size()==places4.size());
+        std::map<place*,long> count[3];
+        for (unsigned long i=0;i<agents1.size();i++){
+            count[agent::home][agents1[i]->getHome()]++;
+            count[agent::work][agents1[i]->getWork()]++;
+            count[agent::vehicle][agents1[i]->getTransport()]++;
+            CPPUNIT_ASSERT(agents1[i]->getHome()->getID()==agents4[i]->getHome()->getID());
+            CPPUNIT_ASSERT(agents1[i]->getWork()->getID()==agents4[i]->getWork()->getID());
+            CPPUNIT_ASSERT(agents1[i]->getTransport()->getID()==agents4[i]->getTransport()->getID());
+        }
+        //every place is used, and none is bigger than the largest size in the table
+        CPPUNIT_ASSERT(count[0].size()+count[1].size()+count[2].size()==places1.size());
+        for (auto& c:count[agent::home])   CPPUNIT_ASSERT(c.second<=3);
+        for (auto& c:count[agent::work])   CPPUNIT_ASSERT(c.second<=10);
+        for (auto& c:count[agent::vehicle])CPPUNIT_ASSERT(c.second<=20);
+        //all workplaces have size 10, and chunks are multiples of 10, so there are exactly 60
+        CPPUNIT_ASSERT(count[agent::work].size()==60);
+    }
 };
 
 #endif // MODELFACTORYTEST_H_INCLUDED
@@ -44,6 +44,8 @@ public:
     CPPUNIT_TEST( testNumberInfected );
     /** @brief test run  */
     CPPUNIT_TEST( testRun );
+    /** @brief test scenario branch copy  */
+    CPPUNIT_TEST( testBranch );
     /** @brief end the test suite   */
     CPPUNIT_TEST_SUITE_END();
     /** @brief make sure results from constructor are as expected for simple mobile model*/
@@ -83,8 +85,10 @@ public:
 
         //take a step
         m.step(0,pr);
+        //output is buffered, so make sure it is written before reading it back
+        m.flush();
         //read header
-        std::ifstream f("./output/experiment.default/run_0000/diseaseSummary.csv");
+        std::ifstream f("./output/default/run_0000/diseaseSummary.csv");
         std::string s;
         std::getline(f,s);
         //check header is OK
@@ -93,6 +97,29 @@ public:
         //this line could change with thread num or RNG settings!
         CPPUNIT_ASSERT(s=="0,0,599,1,0,0");
     }
+    /** @brief a scenario branch should start as an exact copy of the model it was taken from, with its own output
+        @details The branch output starts with a copy of the output from the base model so far*/
+    void testBranch()
+    {
+        parameterSettings pr;
+        pr.setParameter("experiment.run.number","0000");
+        pr.setParameter("disease.simplistic.initialNumberInfected","10");
+        omp_set_num_threads(1);
+        model m(pr,"a");
+        for (int i=0;i<3;i++)m.step(i,pr);
+        parameterSettings branchParameters=pr;
+        branchParameters.setParameter("schedule.type","stationary");
+        model b(m,branchParameters,0);
+        CPPUNIT_ASSERT(b.numberOfAgents()==m.numberOfAgents());
+        CPPUNIT_ASSERT(b.numberOfPlaces()==m.numberOfPlaces());
+        CPPUNIT_ASSERT(b.numberDiseased()==m.numberDiseased());
+        //the branch output so far should match the base model
+        std::ifstream f("./output/default/run_0000/branch_0000/diseaseSummary.csv");
+        std::string s;
+        int lines=0;
+        while(std::getline(f,s))lines++;
+        CPPUNIT_ASSERT(lines==4);
+    }
 };
 
 #endif // MODELTEST_H_INCLUDED
@@ -0,0 +1,87 @@
+#ifndef PERMUTATIONTEST_H_INCLUDED
+#define PERMUTATIONTEST_H_INCLUDED
+#include "../permutation.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file permutationtest.h 
+ * @brief File containing the definition of the permutationTest class for the random permutation
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the random permutation
+ *  @details Check that every value turns up exactly once, and that the ordering depends only on the seed.*/
+class permutationTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( permutationTest );
+    /** @brief one-to-one test */
+    CPPUNIT_TEST( testOneToOne );
+    /** @brief seed test */
+    CPPUNIT_TEST( testSeed );
+    /** @brief inverse test */
+    CPPUNIT_TEST( testInverse );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief every value from 0 to n-1 should come out exactly once, for sizes that are and are not powers of two */
+    void testOneToOne()
+    {
+        for (unsigned long n:{1,2,3,10,64,600,1000,4097}){
+            randomPermutation p(n,3);
+            CPPUNIT_ASSERT(p.size()==n);
+            std::vector<int> count(n,0);
+            for (unsigned long i=0;i<n;i++){
+                unsigned long j=p(i);
+                CPPUNIT_ASSERT(j<n);
+                count[j]++;
+            }
+            for (auto c:count)CPPUNIT_ASSERT(c==1);
+        }
+    }
+    /** @brief the same seed should give the same ordering, different seeds different ones, and the order should actually be shuffled */
+    void testSeed()
+    {
+        randomPermutation p(1000,7),q(1000,7),r(1000,8);
+        int same=0,unmoved=0;
+        for (unsigned long i=0;i<1000;i++){
+            CPPUNIT_ASSERT(p(i)==q(i));
+            if (p(i)==r(i))same++;
+            if (p(i)==i)unmoved++;
+        }
+        CPPUNIT_ASSERT(same<50);
+        CPPUNIT_ASSERT(unmoved<50);
+    }
+    /** @brief the inverse should undo the permutation */
+    void testInverse()
+    {
+        for (unsigned long n:{1,5,600,4097}){
+            randomPermutation p(n,11);
+            for (unsigned long i=0;i<n;i++){
+                CPPUNIT_ASSERT(p.inverse(p(i))==i);
+                CPPUNIT_ASSERT(p(p.inverse(i))==i);
+            }
+        }
+    }
+};
+
+#endif // PERMUTATIONTEST_H_INCLUDED
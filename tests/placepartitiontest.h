@@ -0,0 +1,98 @@
+#ifndef PLACEPARTITIONTEST_H_INCLUDED
+#define PLACEPARTITIONTEST_H_INCLUDED
+#include "../placePartition.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file placepartitiontest.h 
+ * @brief File containing the definition of the placePartitionTest class for owner-computes place updates
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the place partition
+ *  @details Check that places get the right owners, and that contamination from other threads is queued and delivered.*/
+class placePartitionTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( placePartitionTest );
+    /** @brief ownership test */
+    CPPUNIT_TEST( testOwners );
+    /** @brief contamination routing test */
+    CPPUNIT_TEST( testRouting );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief four agents on two threads - each home should belong to the thread of its occupants, the shared workplace to the first
+        thread that uses it, and the unused place should be shared out by its position */
+    void testOwners()
+    {
+        place h0,h1,w,unused;
+        std::vector<place*> places={&h0,&h1,&w,&unused};
+        agent a[4];
+        std::vector<agent*> agents;
+        for (int i=0;i<4;i++){
+            a[i].setHome(i<2?&h0:&h1);
+            a[i].setWork(&w);
+            a[i].setTransport(&w);
+            agents.push_back(&a[i]);
+        }
+        placePartition P;
+        CPPUNIT_ASSERT(!P.built());
+        P.build(agents,places,2);
+        CPPUNIT_ASSERT(P.threads()==2);
+        CPPUNIT_ASSERT(P.first(0,4)==0 && P.first(1,4)==2 && P.first(2,4)==4);
+        CPPUNIT_ASSERT(h0.getOwner()==0);
+        CPPUNIT_ASSERT(h1.getOwner()==1);
+        CPPUNIT_ASSERT(w.getOwner()==0);
+        CPPUNIT_ASSERT(unused.getOwner()==1);
+        CPPUNIT_ASSERT(P.owned(0).size()==2 && P.owned(1).size()==2);
+    }
+    /** @brief updates to a thread's own places should be made at once, the rest only when the owner collects them */
+    void testRouting()
+    {
+        place h0,h1,w;
+        std::vector<place*> places={&h0,&h1,&w};
+        agent a[2];
+        a[0].setHome(&h0);a[0].setWork(&w);a[0].setTransport(&w);
+        a[1].setHome(&h1);a[1].setWork(&w);a[1].setTransport(&w);
+        std::vector<agent*> agents={&a[0],&a[1]};
+        placePartition P;
+        P.build(agents,places,2);
+        P.contaminate(0,&w,0.5);
+        P.contaminate(1,&w,1.0);
+        P.contaminate(1,&h1,2.0);
+        P.contaminate(1,&h0,0.);
+        CPPUNIT_ASSERT(w.getContaminationLevel()==0.5);
+        CPPUNIT_ASSERT(h1.getContaminationLevel()==2.0);
+        CPPUNIT_ASSERT(P.local()==2);
+        CPPUNIT_ASSERT(P.routed()==1);
+        P.deliver(1);
+        CPPUNIT_ASSERT(w.getContaminationLevel()==0.5);
+        P.deliver(0);
+        CPPUNIT_ASSERT(w.getContaminationLevel()==1.5);
+        //the queue is emptied once delivered
+        P.deliver(0);
+        CPPUNIT_ASSERT(w.getContaminationLevel()==1.5);
+        CPPUNIT_ASSERT(P.memoryUsed()>0);
+    }
+};
+#endif // PLACEPARTITIONTEST_H_INCLUDED
@@ -0,0 +1,115 @@
+#ifndef POPULATIONFILETEST_H_INCLUDED
+#define POPULATIONFILETEST_H_INCLUDED
+#include "../populationFile.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file populationfiletest.h 
+ * @brief File containing the definition of the populationFileTest class for the binary population file
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the binary population file
+ *  @details Check that a population survives writing and reading back, that csv conversion works, and that the columnar factory uses the file.*/
+class populationFileTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( populationFileTest );
+    /** @brief write and read back test */
+    CPPUNIT_TEST( testRoundTrip );
+    /** @brief csv conversion test */
+    CPPUNIT_TEST( testConvert );
+    /** @brief factory test */
+    CPPUNIT_TEST( testFactory );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief columns written to a file should come back unchanged */
+    void testRoundTrip()
+    {
+        populationColumns pop;
+        for (uint32_t i=0;i<1000;i++){
+            pop.home.push_back(i/3);pop.work.push_back(334+i/10);pop.vehicle.push_back(434+i/30);pop.status.push_back(i%4);
+        }
+        for (uint64_t i=0;i<468;i++){
+            pop.placeID.push_back(i*1000000007ULL);pop.placeType.push_back(i<334?0:(i<434?1:2));
+        }
+        populationFile::write("./output/testRoundTrip.mop",pop);
+        populationFile f("./output/testRoundTrip.mop");
+        CPPUNIT_ASSERT(f.nAgents()==1000);
+        CPPUNIT_ASSERT(f.nPlaces()==468);
+        for (uint64_t i=0;i<f.nAgents();i++){
+            CPPUNIT_ASSERT(f.home()[i]==pop.home[i]);
+            CPPUNIT_ASSERT(f.work()[i]==pop.work[i]);
+            CPPUNIT_ASSERT(f.vehicle()[i]==pop.vehicle[i]);
+            CPPUNIT_ASSERT(f.status()[i]==pop.status[i]);
+        }
+        for (uint64_t i=0;i<f.nPlaces();i++){
+            CPPUNIT_ASSERT(f.placeID()[i]==pop.placeID[i]);
+            CPPUNIT_ASSERT(f.placeType()[i]==pop.placeType[i]);
+        }
+        //columns start on cache lines
+        CPPUNIT_ASSERT((uintptr_t)f.placeID()%64==0);
+    }
+    /** @brief places in the csv file get numbered in order of appearance, and keep their original IDs */
+    void testConvert()
+    {
+        CPPUNIT_ASSERT(populationFile::convertCSV("testPopulation.csv","./output/testPopulation.mop")==4);
+        populationFile f("./output/testPopulation.mop");
+        CPPUNIT_ASSERT(f.nAgents()==4);
+        CPPUNIT_ASSERT(f.nPlaces()==7);
+        CPPUNIT_ASSERT(f.placeID()[0]==1001 && f.placeType()[0]==0);
+        CPPUNIT_ASSERT(f.placeID()[1]==52   && f.placeType()[1]==1);
+        CPPUNIT_ASSERT(f.placeID()[2]==9003 && f.placeType()[2]==2);
+        CPPUNIT_ASSERT(f.placeID()[f.home()[3]]==1003);
+        CPPUNIT_ASSERT(f.placeID()[f.work()[3]]==77);
+        CPPUNIT_ASSERT(f.placeID()[f.vehicle()[2]]==9004);
+        CPPUNIT_ASSERT(f.home()[0]==f.home()[1]);
+        CPPUNIT_ASSERT(f.status()[1]==1 && f.status()[2]==2);
+        //missing status defaults to susceptible
+        CPPUNIT_ASSERT(f.status()[3]==0);
+    }
+    /** @brief the columnar factory should build agents in the places given by the file */
+    void testFactory()
+    {
+        populationFile::convertCSV("testPopulation.csv","./output/testPopulation.mop");
+        parameterSettings pr;
+        pr.setParameter("model.columnar.populationFile","./output/testPopulation.mop");
+        std::vector<agent*> agents;
+        std::vector<place*> places;
+        modelFactory& F=modelFactorySelector::select("columnar");
+        F.createAgents(pr,agents,places,"a");
+        CPPUNIT_ASSERT(agents.size()==4);
+        CPPUNIT_ASSERT(places.size()==7);
+        CPPUNIT_ASSERT(agents[0]->getHome()==agents[1]->getHome());
+        CPPUNIT_ASSERT(agents[0]->getHome()->getID()==1001);
+        CPPUNIT_ASSERT(agents[3]->getWork()->getID()==77);
+        CPPUNIT_ASSERT(agents[2]->getTransport()->getID()==9004);
+        CPPUNIT_ASSERT(agents[1]->diseased());
+        CPPUNIT_ASSERT(agents[2]->recovered());
+        CPPUNIT_ASSERT(!agents[0]->diseased() && !agents[0]->recovered());
+        for (auto a:agents)delete a;
+        for (auto p:places)delete p;
+    }
+};
+
+#endif // POPULATIONFILETEST_H_INCLUDED
@@ -0,0 +1,218 @@
+#ifndef PROFILERTEST_H_INCLUDED
+#define PROFILERTEST_H_INCLUDED
+#include "../profiler.h"
+#include<omp.h>
+#include<thread>
+#include<filesystem>
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file profilertest.h 
+ * @brief File containing the definition of the profilerTest class for the step phase profiler
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the profiler
+ *  @details Time some phases with known lengths, check the thread imbalance and the saved files.*/
+class profilerTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( profilerTest );
+    /** @brief phase timing test */
+    CPPUNIT_TEST( testPhases );
+    /** @brief thread imbalance test */
+    CPPUNIT_TEST( testImbalance );
+    /** @brief several phases in one parallel region test */
+    CPPUNIT_TEST( testTeam );
+    /** @brief disabled profiler test */
+    CPPUNIT_TEST( testDisabled );
+    /** @brief performance counter test */
+    CPPUNIT_TEST( testCounters );
+    /** @brief performance counter closing test */
+    CPPUNIT_TEST( testCountersClosed );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief each scope should add its time to the current step, and the files should have one row per step */
+    void testPhases()
+    {
+        profiler p;
+        int a=p.phase("a");
+        int b=p.phase("b");
+        CPPUNIT_ASSERT(p.phase("a")==a);
+        for (int s=0;s<3;s++){
+            p.startStep(s);
+            {
+                profiler::scope t(p,a);
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            {
+                profiler::scope t(p,b);
+            }
+        }
+        CPPUNIT_ASSERT(p.nSteps()==3);
+        for (int s=0;s<3;s++){
+            CPPUNIT_ASSERT(p.time(a,s)>=2000000);
+            CPPUNIT_ASSERT(p.time(b,s)<p.time(a,s));
+        }
+        CPPUNIT_ASSERT(p.totalSeconds(a)>=0.006);
+        p.write("./output/profilerTest_");
+        std::ifstream csv("./output/profilerTest_profile.csv");
+        std::string line;
+        std::getline(csv,line);
+        CPPUNIT_ASSERT(line=="step,a(ns),b(ns),a(imbalance),b(imbalance)");
+        int rows=0;
+        while (std::getline(csv,line))rows++;
+        CPPUNIT_ASSERT(rows==3);
+        std::ifstream json("./output/profilerTest_profileSummary.json");
+        std::stringstream ss;
+        ss<<json.rdbuf();
+        CPPUNIT_ASSERT(ss.str().find("\"name\": \"a\"")!=std::string::npos);
+        CPPUNIT_ASSERT(ss.str().find("\"histogram_log2_ns\"")!=std::string::npos);
+    }
+    /** @brief if one thread has much more work than the rest, the imbalance should be well above one, and the busy time should be counted per thread */
+    void testImbalance()
+    {
+        profiler p;
+        p.setThreads(4);
+        int a=p.phase("a");
+        p.startStep(0);
+        omp_set_num_threads(4);
+        {
+            profiler::scope t(p,a);
+            #pragma omp parallel
+            {
+                profiler::threadScope busy(p,a);
+                std::this_thread::sleep_for(std::chrono::milliseconds(omp_get_thread_num()==0?20:1));
+            }
+        }
+        omp_set_num_threads(1);
+        p.write("./output/profilerTest2_");
+        std::ifstream csv("./output/profilerTest2_profile.csv");
+        std::string header,line;
+        std::getline(csv,header);
+        std::getline(csv,line);
+        double imbalance=std::stod(line.substr(line.rfind(',')+1));
+        //one thread busy for 20ms and three for 1ms gives 20/5.75 - allow for sleep overrunning
+        CPPUNIT_ASSERT(imbalance>2 && imbalance<=4);
+    }
+    /** @brief phases sharing one parallel region should be timed by thread 0, including the wait at a barrier, with busy times per thread */
+    void testTeam()
+    {
+        profiler p;
+        p.setThreads(4);
+        int a=p.phase("a"),b=p.phase("b");
+        p.startStep(0);
+        omp_set_num_threads(4);
+        #pragma omp parallel
+        {
+            bool first=(omp_get_thread_num()==0);
+            {
+                profiler::teamScope t(p,a,true);
+                std::this_thread::sleep_for(std::chrono::milliseconds(first?1:20));
+            }
+            {
+                profiler::teamScope t(p,b,false);
+                std::this_thread::sleep_for(std::chrono::milliseconds(first?1:20));
+            }
+        }
+        omp_set_num_threads(1);
+        p.finishPhase(a);
+        p.finishPhase(b);
+        //thread 0 waits for the others at the end of phase a, but goes straight on at the end of phase b
+        CPPUNIT_ASSERT(p.time(a,0)>=20000000);
+        CPPUNIT_ASSERT(p.time(b,0)<20000000);
+        p.write("./output/profilerTest4_");
+        std::ifstream csv("./output/profilerTest4_profile.csv");
+        std::string header,line;
+        std::getline(csv,header);
+        std::getline(csv,line);
+        //busy times not including the wait - one thread 1ms and three 20ms gives 20/15.25
+        double imbalance=std::stod(line.substr(line.rfind(',')+1));
+        CPPUNIT_ASSERT(imbalance>1.1 && imbalance<=1.4);
+    }
+    /** @brief a disabled profiler should record nothing */
+    void testDisabled()
+    {
+        profiler p(false);
+        int a=p.phase("a");
+        p.startStep(0);
+        {
+            profiler::scope t(p,a);
+        }
+        CPPUNIT_ASSERT(p.nSteps()==0);
+    }
+    /** @brief counters should be added up per phase if they can be opened, and give zeros (not a crash) if they can't
+        @details Hardware counters are often missing on test machines, so software events (CPU time and page faults) stand in for them */
+    void testCounters()
+    {
+        hardwareCounters hw;
+        auto v=hw.read();
+        if (!hw.available()){
+            CPPUNIT_ASSERT(!hw.reason().empty());
+            for (auto c:v)CPPUNIT_ASSERT(c==0);
+        }
+        profiler p;
+        p.counters().setEvents({{{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_TASK_CLOCK},{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_PAGE_FAULTS},
+                                 {PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CONTEXT_SWITCHES},{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CPU_MIGRATIONS}}});
+        int a=p.phase("a");
+        bool counting=p.enableCounters(true);
+        p.startStep(0);
+        {
+            profiler::scope t(p,a);
+            #pragma omp parallel
+            {
+                profiler::threadScope busy(p,a);
+                //touch some new memory, so there is CPU time and there are page faults to count
+                std::vector<char> memory(16*1024*1024);
+                for (size_t i=0;i<memory.size();i+=4096)memory[i]=1;
+            }
+        }
+        if (counting){
+            CPPUNIT_ASSERT(p.counter(a,hardwareCounters::cycles)>0);
+            CPPUNIT_ASSERT(p.counter(a,hardwareCounters::instructions)>=4096);
+        }else{
+            CPPUNIT_ASSERT(p.counter(a,hardwareCounters::cycles)==0);
+        }
+    }
+    /** @brief the counters opened by every thread should be closed with the object, so that each scenario branch doesn't leave some open */
+    void testCountersClosed()
+    {
+        auto openFiles=[](){
+            long n=0;
+            for (auto& f:std::filesystem::directory_iterator("/proc/self/fd"))if (!f.path().empty())n++;
+            return n;
+        };
+        long before=openFiles();
+        for (int repeat=0;repeat<3;repeat++){
+            hardwareCounters hw;
+            hw.setEvents({{{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_TASK_CLOCK},{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_PAGE_FAULTS},
+                           {PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CONTEXT_SWITCHES},{PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CPU_MIGRATIONS}}});
+            #pragma omp parallel
+            hw.read();
+            if (hw.available())CPPUNIT_ASSERT(hw.openDescriptors()>=omp_get_max_threads());
+        }
+        CPPUNIT_ASSERT(openFiles()==before);
+    }
+};
+
+#endif // PROFILERTEST_H_INCLUDED
@@ -0,0 +1,78 @@
+#ifndef SERIESWRITERTEST_H_INCLUDED
+#define SERIESWRITERTEST_H_INCLUDED
+#include "../seriesWriter.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file serieswritertest.h 
+ * @brief File containing the definition of the seriesWriterTest class for the binary time series output
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the binary time series output
+ *  @details Write a file and check the header and block layout byte by byte.*/
+class seriesWriterTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( seriesWriterTest );
+    /** @brief layout test */
+    CPPUNIT_TEST( testLayout );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief the file should have the header, then one block of rows for each flush, with the values in column order */
+    void testLayout()
+    {
+        seriesWriter s;
+        s.open("./output/seriesWriterTest.mts",{"step","rate"},{'i','d'});
+        s.row({0,0.5});
+        s.row({1L,1});
+        s.flush();
+        s.close();
+        s.open("./output/seriesWriterTest.mts",{"step","rate"},{'i','d'},true);
+        s.row({2UL,-2.5});
+        s.close();
+        std::ifstream f("./output/seriesWriterTest.mts",std::ios::binary);
+        std::vector<char> data((std::istreambuf_iterator<char>(f)),std::istreambuf_iterator<char>());
+        //header, then two blocks of one count and two columns
+        CPPUNIT_ASSERT(data.size()==24+2*40+(8+2*2*8)+(8+2*8));
+        CPPUNIT_ASSERT(std::string(data.data(),8)=="MOPSERIE");
+        uint32_t header[4];
+        memcpy(header,data.data()+8,16);
+        CPPUNIT_ASSERT(header[0]==1 && header[1]==0x01020304 && header[2]==2 && header[3]==104);
+        CPPUNIT_ASSERT(std::string(data.data()+24)=="step" && data[24+32]=='i');
+        CPPUNIT_ASSERT(std::string(data.data()+64)=="rate" && data[64+32]=='d');
+        uint64_t n;
+        int64_t step[2];
+        double rate[2];
+        memcpy(&n,data.data()+104,8);
+        memcpy(step,data.data()+112,16);
+        memcpy(rate,data.data()+128,16);
+        CPPUNIT_ASSERT(n==2 && step[0]==0 && step[1]==1 && rate[0]==0.5 && rate[1]==1.);
+        memcpy(&n,data.data()+144,8);
+        memcpy(step,data.data()+152,8);
+        memcpy(rate,data.data()+160,8);
+        CPPUNIT_ASSERT(n==1 && step[0]==2 && rate[0]==-2.5);
+    }
+};
+
+#endif // SERIESWRITERTEST_H_INCLUDED
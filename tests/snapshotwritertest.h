@@ -0,0 +1,96 @@
+#ifndef SNAPSHOTWRITERTEST_H_INCLUDED
+#define SNAPSHOTWRITERTEST_H_INCLUDED
+#include "../snapshotWriter.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file snapshotwritertest.h 
+ * @brief File containing the definition of the snapshotWriterTest class for the compressed place snapshots
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the place snapshots
+ *  @details Write some snapshots, then decode the file and check the values come back.*/
+class snapshotWriterTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( snapshotWriterTest );
+    /** @brief round trip test */
+    CPPUNIT_TEST( testRoundTrip );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief undo the XOR and run length encoding of one column */
+    void decode(const uint64_t* words,uint64_t m,std::vector<uint64_t>& values){
+        uint64_t i=0,k=0;
+        while (k<m){
+            uint64_t zeros=words[k]>>32,literals=words[k]&0xffffffff;
+            i+=zeros;
+            for (uint64_t j=0;j<literals;j++)values[i++]^=words[k+1+j];
+            k+=1+literals;
+        }
+    }
+    /** @brief several snapshots (more than the two buffers) should all decode to the values put in, and unchanged values should take no space */
+    void testRoundTrip()
+    {
+        const uint64_t n=1000;
+        std::vector<uint64_t> IDs(n);
+        for (uint64_t i=0;i<n;i++)IDs[i]=i+100;
+        std::vector<std::vector<double>> contamination(5,std::vector<double>(n,0.));
+        for (int s=0;s<5;s++)for (uint64_t i=0;i<n;i+=7)contamination[s][i]=(s<3)?0.5*i:1.5;
+        snapshotWriter w;
+        w.open("./output/snapshotWriterTest.snp",IDs,true);
+        for (int s=0;s<5;s++){
+            uint64_t* b=w.buffer();
+            memcpy(b,contamination[s].data(),n*sizeof(double));
+            for (uint64_t i=0;i<n;i++)b[n+i]=s;
+            w.submit(10*s);
+        }
+        w.close();
+        std::ifstream f("./output/snapshotWriterTest.snp",std::ios::binary);
+        std::vector<char> bytes((std::istreambuf_iterator<char>(f)),std::istreambuf_iterator<char>());
+        const uint64_t* data=(const uint64_t*)bytes.data();
+        CPPUNIT_ASSERT(std::string(bytes.data(),8)=="MOPSNAPS");
+        CPPUNIT_ASSERT(data[3]==n && data[4]==2 && data[5]==100 && data[4+n]==n+99);
+        uint64_t p=5+n;
+        std::vector<uint64_t> values[2]={std::vector<uint64_t>(n,0),std::vector<uint64_t>(n,0)};
+        for (int s=0;s<5;s++){
+            CPPUNIT_ASSERT(data[p++]==uint64_t(10*s));
+            for (int c=0;c<2;c++){
+                uint64_t m=data[p];
+                //an unchanged snapshot is a single token
+                if (s==2 && c==0)CPPUNIT_ASSERT(m==1);
+                decode(data+p+1,m,values[c]);
+                p+=1+m;
+            }
+            for (uint64_t i=0;i<n;i++){
+                double d;
+                memcpy(&d,&values[0][i],8);
+                CPPUNIT_ASSERT(d==contamination[s][i]);
+                CPPUNIT_ASSERT(values[1][i]==uint64_t(s));
+            }
+        }
+        CPPUNIT_ASSERT(p*8==bytes.size());
+    }
+};
+
+#endif // SNAPSHOTWRITERTEST_H_INCLUDED
@@ -40,6 +40,7 @@
 #include "../agent.h"
 #include<math.h>
 #include"randomtest.h"
+#include"permutationtest.h"
 #include"timereportertest.h"
 #include"timesteptest.h"
 #include"travelscheduletest.h"
@@ -49,6 +50,20 @@
 #include"parametertest.h"
 #include"agenttest.h"
 #include"modelfactorytest.h"
+#include"populationfiletest.h"
+#include"asyncwritertest.h"
+#include"serieswritertest.h"
+#include"snapshotwritertest.h"
+#include"eventlogtest.h"
+#include"profilertest.h"
+#include"tracerecordertest.h"
+#include"memoryreporttest.h"
+#include"threadaffinitytest.h"
+#include"placepartitiontest.h"
+#include"adaptivegraintest.h"
+#include"threadtunertest.h"
+#include"domainpartitiontest.h"
+#include"domainbalancertest.h"
 #include"modeltest.h"
 //------------------------------------------------------------------------
 //------------------------------------------------------------------------
@@ -80,6 +95,7 @@ int main(){
   runner.addTest( timeStepTest::suite() );
   runner.addTest( agentTest::suite() );
   runner.addTest( randomTest::suite() );
+  runner.addTest( permutationTest::suite() );
   runner.addTest( timeReporterTest::suite() );
   runner.addTest( travelScheduleTest::suite() );
   runner.addTest( scheduleListTest::suite() );
@@ -87,6 +103,20 @@ int main(){
   runner.addTest( placeTest::suite() );
   runner.addTest( parameterTest::suite() );
   runner.addTest( modelFactoryTest::suite() ); 
+  runner.addTest( populationFileTest::suite() ); 
+  runner.addTest( asyncWriterTest::suite() ); 
+  runner.addTest( seriesWriterTest::suite() ); 
+  runner.addTest( snapshotWriterTest::suite() ); 
+  runner.addTest( eventLogTest::suite() );
+  runner.addTest( profilerTest::suite() );
+  runner.addTest( traceRecorderTest::suite() );
+  runner.addTest( memoryReportTest::suite() ); 
+  runner.addTest( threadAffinityTest::suite() );
+  runner.addTest( placePartitionTest::suite() );
+  runner.addTest( adaptiveGrainTest::suite() );
+  runner.addTest( threadTunerTest::suite() );
+  runner.addTest( domainPartitionTest::suite() );
+  runner.addTest( domainBalancerTest::suite() );
   runner.addTest( modelTest::suite() ); 
   //run all test suites
   runner.run();
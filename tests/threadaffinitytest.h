@@ -0,0 +1,88 @@
+#ifndef THREADAFFINITYTEST_H_INCLUDED
+#define THREADAFFINITYTEST_H_INCLUDED
+#include "../threadAffinity.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file threadaffinitytest.h 
+ * @brief File containing the definition of the threadAffinityTest class for pinning threads to cores
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the thread pinning
+ *  @details Check the CPU ordering and placement, and that threads really are pinned.*/
+class threadAffinityTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( threadAffinityTest );
+    /** @brief placement test */
+    CPPUNIT_TEST( testPlacement );
+    /** @brief pinning test */
+    CPPUNIT_TEST( testPin );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief every allowed CPU should be listed once, and threads should be placed on them in order, wrapping round if there are too many */
+    void testPlacement()
+    {
+        std::vector<int> c=threadAffinity::cpus();
+        CPPUNIT_ASSERT(!c.empty());
+        std::vector<int> sorted=c;
+        std::sort(sorted.begin(),sorted.end());
+        CPPUNIT_ASSERT(std::unique(sorted.begin(),sorted.end())==sorted.end());
+        int n=c.size();
+        std::vector<int> close=threadAffinity::placement("close",n+1);
+        for (int t=0;t<n;t++)CPPUNIT_ASSERT(close[t]==c[t]);
+        CPPUNIT_ASSERT(close[n]==c[0]);
+        std::vector<int> spread=threadAffinity::placement("spread",1);
+        CPPUNIT_ASSERT(spread[0]==c[0]);
+    }
+    /** @brief after pinning, each thread should be allowed on just the one CPU it was given - the threads are unpinned again afterwards */
+    void testPin()
+    {
+        if (std::getenv("OMP_PROC_BIND")!=nullptr)return;
+        cpu_set_t all;
+        CPU_ZERO(&all);
+        sched_getaffinity(0,sizeof(all),&all);
+        omp_set_num_threads(2);
+        CPPUNIT_ASSERT(threadAffinity::pin("close",2));
+        std::vector<int> expected=threadAffinity::placement("close",2);
+        std::vector<int> count(2),cpu(2,-1);
+        #pragma omp parallel
+        {
+            int t=omp_get_thread_num();
+            cpu_set_t mine;
+            CPU_ZERO(&mine);
+            pthread_getaffinity_np(pthread_self(),sizeof(mine),&mine);
+            count[t]=CPU_COUNT(&mine);
+            for (int c=0;c<CPU_SETSIZE;c++)if (CPU_ISSET(c,&mine))cpu[t]=c;
+            pthread_setaffinity_np(pthread_self(),sizeof(all),&all);
+        }
+        omp_set_num_threads(1);
+        for (int t=0;t<2;t++){
+            CPPUNIT_ASSERT(count[t]==1);
+            CPPUNIT_ASSERT(cpu[t]==expected[t]);
+        }
+        CPPUNIT_ASSERT(!threadAffinity::pin("none",2));
+    }
+};
+#endif // THREADAFFINITYTEST_H_INCLUDED
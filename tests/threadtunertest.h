@@ -0,0 +1,97 @@
+#ifndef THREADTUNERTEST_H_INCLUDED
+#define THREADTUNERTEST_H_INCLUDED
+#include "../threadTuner.h"
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file threadtunertest.h 
+ * @brief File containing the definition of the threadTunerTest class for choosing the thread count of each phase
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the thread tuner
+ *  @details Feed the tuner made-up times, from outside any parallel region (so every time is for thread 0), and check the choices.*/
+class threadTunerTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( threadTunerTest );
+    /** @brief choice test */
+    CPPUNIT_TEST( testChoose );
+    /** @brief re-tuning test */
+    CPPUNIT_TEST( testResize );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief a phase that is fastest on 2 threads should get 2, one that scales keeps the team, and fixed phases always use the team */
+    void testChoose()
+    {
+        threadTuner T;
+        T.setup(true,8,2);
+        int small=T.add("small",true),big=T.add("big",true),fixed=T.add("fixed",false);
+        CPPUNIT_ASSERT(T.candidates()==std::vector<int>({1,2,4,8}));
+        CPPUNIT_ASSERT(T.tuning());
+        std::map<int,int64_t> smallTime={{1,300},{2,100},{4,200},{8,400}};
+        for (int step=0;step<8;step++){
+            int k=T.threads(small);
+            CPPUNIT_ASSERT(k==T.candidates()[step%4]);
+            CPPUNIT_ASSERT(T.threads(fixed)==8);
+            T.record(small,smallTime[k]+step);
+            T.record(big,8000/k);
+            T.endStep(step);
+        }
+        CPPUNIT_ASSERT(!T.tuning());
+        CPPUNIT_ASSERT(T.threads(small)==2);
+        CPPUNIT_ASSERT(T.threads(big)==8);
+        CPPUNIT_ASSERT(T.threads(fixed)==8);
+        //only slightly faster than the whole team - keep the team
+        threadTuner U;
+        U.setup(true,2,1);
+        int close=U.add("close",true);
+        U.record(close,98);U.endStep(0);
+        U.record(close,100);U.endStep(1);
+        CPPUNIT_ASSERT(U.threads(close)==2);
+        //switched off - always the whole team
+        threadTuner V;
+        V.setup(false,4,1);
+        int off=V.add("off",true);
+        CPPUNIT_ASSERT(!V.tuning() && V.threads(off)==4);
+    }
+    /** @brief a big change in the size of a phase should start tuning again, a small one should not */
+    void testResize()
+    {
+        threadTuner T;
+        T.setup(true,2,1);
+        int p=T.add("travellers",true);
+        T.resize(p,100);
+        T.record(p,10);T.endStep(0);
+        T.record(p,50);T.endStep(1);
+        CPPUNIT_ASSERT(!T.tuning() && T.threads(p)==1);
+        T.resize(p,150);
+        CPPUNIT_ASSERT(!T.tuning());
+        T.resize(p,1000);
+        CPPUNIT_ASSERT(T.tuning());
+        T.record(p,50);T.endStep(2);
+        T.record(p,10);T.endStep(3);
+        CPPUNIT_ASSERT(!T.tuning() && T.threads(p)==2);
+    }
+};
+#endif // THREADTUNERTEST_H_INCLUDED
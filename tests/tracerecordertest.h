@@ -0,0 +1,137 @@
+#ifndef TRACERECORDERTEST_H_INCLUDED
+#define TRACERECORDERTEST_H_INCLUDED
+#include "../traceRecorder.h"
+#include<omp.h>
+#include<fstream>
+#include<thread>
+/* A program to test the model of agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/**
+ * @file tracerecordertest.h 
+ * @brief File containing the definition of the traceRecorderTest class for the timeline recorder
+ * 
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Test the timeline recorder
+ *  @details Record spans from several threads, check the saved file and that full rings keep the newest spans.*/
+class traceRecorderTest : public CppUnit::TestFixture  {
+public:
+    /** @brief automatically create a test suite */
+    CPPUNIT_TEST_SUITE( traceRecorderTest );
+    /** @brief many threads test */
+    CPPUNIT_TEST( testThreads );
+    /** @brief full ring test */
+    CPPUNIT_TEST( testOverwrite );
+    /** @brief ring re-use test */
+    CPPUNIT_TEST( testReuse );
+    /** @brief disabled recorder test */
+    CPPUNIT_TEST( testDisabled );
+    /** @brief end test suite */
+    CPPUNIT_TEST_SUITE_END();
+    /** @brief count the lines in a trace file that are complete spans */
+    long countSpans(std::string fileName,std::string name){
+        std::ifstream f(fileName);
+        std::string line;
+        long n=0;
+        while (std::getline(f,line)){
+            if (line.find("\"ph\":\"X\"")!=std::string::npos && line.find("\"name\":\""+name+"\"")!=std::string::npos)n++;
+        }
+        return n;
+    }
+    /** @brief spans from four OpenMP threads and a background thread should all be in the file, each thread with its own label */
+    void testThreads()
+    {
+        traceRecorder::enable(1000,8);
+        omp_set_num_threads(4);
+        #pragma omp parallel for
+        for (int i=0;i<100;i++){
+            traceRecorder::span s("work","test");
+        }
+        omp_set_num_threads(1);
+        std::thread background([]{
+            traceRecorder::nameThread("background");
+            traceRecorder::span s("write","io");
+        });
+        background.join();
+        CPPUNIT_ASSERT(traceRecorder::held()==101);
+        CPPUNIT_ASSERT(traceRecorder::lost()==0);
+        traceRecorder::write("./output/traceRecorderTest.json");
+        traceRecorder::disable();
+        CPPUNIT_ASSERT(countSpans("./output/traceRecorderTest.json","work")==100);
+        CPPUNIT_ASSERT(countSpans("./output/traceRecorderTest.json","write")==1);
+        std::ifstream f("./output/traceRecorderTest.json");
+        std::stringstream ss;
+        ss<<f.rdbuf();
+        CPPUNIT_ASSERT(ss.str().find("\"name\":\"background\"")!=std::string::npos);
+        CPPUNIT_ASSERT(ss.str().find("\"traceEvents\"")!=std::string::npos);
+    }
+    /** @brief once a ring is full the oldest spans are overwritten, and the lost ones are counted */
+    void testOverwrite()
+    {
+        traceRecorder::enable(10,1);
+        for (int i=0;i<25;i++)traceRecorder::record("span","test",i*1000,i*1000+500);
+        CPPUNIT_ASSERT(traceRecorder::held()==10);
+        CPPUNIT_ASSERT(traceRecorder::lost()==15);
+        traceRecorder::write("./output/traceRecorderTest2.json");
+        traceRecorder::disable();
+        //the oldest remaining span started at 15 microseconds
+        std::ifstream f("./output/traceRecorderTest2.json");
+        std::string line;
+        std::vector<std::string> spans;
+        while (std::getline(f,line))if (line.find("\"ph\":\"X\"")!=std::string::npos)spans.push_back(line);
+        CPPUNIT_ASSERT(spans.size()==10);
+        CPPUNIT_ASSERT(spans[0].find("\"ts\":15.000")!=std::string::npos);
+        CPPUNIT_ASSERT(spans[9].find("\"ts\":24.000")!=std::string::npos);
+    }
+    /** @brief background threads started one after another, more of them than there are rings, should each take over the ring of the\n
+        one before, so nothing is lost */
+    void testReuse()
+    {
+        traceRecorder::enable(100,2);
+        traceRecorder::record("main","test",0,1);
+        for (int i=0;i<5;i++){
+            std::thread writer([]{
+                traceRecorder::nameThread("writer");
+                traceRecorder::span s("write","io");
+            });
+            writer.join();
+        }
+        CPPUNIT_ASSERT(traceRecorder::held()==6);
+        CPPUNIT_ASSERT(traceRecorder::lost()==0);
+        traceRecorder::write("./output/traceRecorderTest3.json");
+        traceRecorder::disable();
+        CPPUNIT_ASSERT(countSpans("./output/traceRecorderTest3.json","write")==5);
+    }
+    /** @brief nothing should be recorded when tracing is off */
+    void testDisabled()
+    {
+        traceRecorder::disable();
+        {
+            traceRecorder::span s("nothing","test");
+        }
+        CPPUNIT_ASSERT(!traceRecorder::enabled());
+        CPPUNIT_ASSERT(traceRecorder::held()==0);
+    }
+};
+
+#endif // TRACERECORDERTEST_H_INCLUDED
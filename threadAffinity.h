@@ -0,0 +1,137 @@
+#ifndef THREADAFFINITY_H_INCLUDED
+#define THREADAFFINITY_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file threadAffinity.h
+ * @brief File containing the definition of the static \ref threadAffinity class, which pins OpenMP threads to CPU cores
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<string>
+#include<vector>
+#include<fstream>
+#include<iostream>
+#include<algorithm>
+#include<tuple>
+#include<cstdlib>
+#include<omp.h>
+#include<sched.h>
+#include<pthread.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Static class that pins each OpenMP thread to its own CPU core, so that it stays next to the memory it first touched
+    @details On a machine with more than one socket each socket has its own memory, and reaching the memory of the other socket is slower.\n
+    Linux puts a page of memory on the socket of the thread that first writes to it. Agents and places are created in parallel loops with\n
+    a static schedule, and every loop in the step uses the same static schedule, so each thread works on the agents and places it created -\n
+    but only if the thread is still running on the same socket. Pinning makes sure of this.\n
+    The CPUs the process may use are put in order - one per physical core, socket by socket, then any second hardware threads - and\n
+    thread t is given one of them. With the "close" policy threads fill the first socket before moving to the next, so each socket gets one\n
+    contiguous block of agents. With "spread" the threads are spaced out evenly over all the cores (still in socket order), which gives each\n
+    socket an equal share of the threads, and so of the agents, when there are fewer threads than cores.\n
+    If OMP_PROC_BIND is set the OpenMP run time is already pinning the threads, and nothing is changed.
+    \code
+    omp_set_num_threads(8);
+    threadAffinity::pin("close",8);
+    \endcode
+*/
+class threadAffinity{
+    /** @brief read a number from a file in /sys, or -1 if missing */
+    static int readNumber(std::string fileName){
+        std::ifstream f(fileName);
+        int n=-1;
+        if (f.is_open())f>>n;
+        return n;
+    }
+public:
+    /** @brief the socket a CPU belongs to, or 0 if not known */
+    static int socket(int cpu){
+        return std::max(0,readNumber("/sys/devices/system/cpu/cpu"+std::to_string(cpu)+"/topology/physical_package_id"));
+    }
+    /** @brief the CPUs this process is allowed to use, in the order threads are placed on them
+        @details one CPU per physical core, socket by socket, followed by the second (and further) hardware threads of each core */
+    static std::vector<int> cpus(){
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0,sizeof(allowed),&allowed);
+        //sort by (which hardware thread of its core, socket, core, cpu)
+        std::vector<std::tuple<int,int,int,int>> order;
+        std::vector<std::pair<int,int>> seen;
+        for (int c=0;c<CPU_SETSIZE;c++){
+            if (!CPU_ISSET(c,&allowed))continue;
+            int s=socket(c);
+            int core=readNumber("/sys/devices/system/cpu/cpu"+std::to_string(c)+"/topology/core_id");
+            if (core<0)core=c;
+            int sibling=std::count(seen.begin(),seen.end(),std::make_pair(s,core));
+            seen.push_back({s,core});
+            order.push_back({sibling,s,core,c});
+        }
+        std::sort(order.begin(),order.end());
+        std::vector<int> result;
+        for (auto& o:order)result.push_back(std::get<3>(o));
+        return result;
+    }
+    /** @brief the CPU each thread would be pinned to
+        @param policy "close" or "spread"
+        @param nThreads the number of threads
+        @return one CPU number per thread */
+    static std::vector<int> placement(std::string policy,int nThreads){
+        std::vector<int> available=cpus();
+        std::vector<int> result(nThreads);
+        int n=available.size();
+        for (int t=0;t<nThreads;t++){
+            //more threads than CPUs wrap round - they then share
+            if (policy=="spread" && nThreads<n)result[t]=available[(long(t)*n)/nThreads];
+            else result[t]=available[t%n];
+        }
+        return result;
+    }
+    /** @brief pin the OpenMP threads - call outside any parallel region, before the agents and places are created
+        @param policy "none" to leave the threads alone, "close" or "spread"
+        @param nThreads the number of threads that will be used
+        @return true if the threads were pinned */
+    static bool pin(std::string policy,int nThreads){
+        if (policy=="none")return false;
+        if (policy!="close" && policy!="spread"){
+            std::cout<<"Unknown run.pinThreads "<<policy<<" - should be none, close or spread"<<std::endl;
+            exit(1);
+        }
+        if (std::getenv("OMP_PROC_BIND")!=nullptr){
+            std::cout<<"OMP_PROC_BIND is set, so threads are left where the OpenMP run time put them"<<std::endl;
+            return false;
+        }
+        std::vector<int> where=placement(policy,nThreads);
+        bool ok=true;
+        #pragma omp parallel num_threads(nThreads) reduction(&&:ok)
+        {
+            cpu_set_t one;
+            CPU_ZERO(&one);
+            CPU_SET(where[omp_get_thread_num()],&one);
+            ok=(pthread_setaffinity_np(pthread_self(),sizeof(one),&one)==0);
+        }
+        if (!ok){
+            std::cout<<"Unable to pin threads to cores - carrying on unpinned"<<std::endl;
+            return false;
+        }
+        std::cout<<"Threads pinned ("<<policy<<") to cpus";
+        for (int t=0;t<nThreads;t++)std::cout<<(t>0?",":" ")<<where[t]<<"(socket "<<socket(where[t])<<")";
+        std::cout<<std::endl;
+        return true;
+    }
+};
+#endif // THREADAFFINITY_H_INCLUDED
@@ -0,0 +1,245 @@
+#ifndef THREADTUNER_H_INCLUDED
+#define THREADTUNER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file threadTuner.h
+ * @brief File containing the definition of the \ref threadTuner class, which picks the number of threads to use for each phase of the step
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<string>
+#include<vector>
+#include<fstream>
+#include<iostream>
+#include<algorithm>
+#include<chrono>
+#include<omp.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Times each phase of the step with several thread counts during the first few steps, and then uses the fastest for each phase
+    @details A phase with little work - the traveller loops, or the place updates when there are only a few places - can be slower on many\n
+    threads than on one, as the cost of sharing the loop out outweighs the work. The tuner tries each candidate thread count (1, 2, 4...\n
+    up to the full team) for a number of rounds of steps, keeping the shortest time of the slowest thread for each phase and candidate,\n
+    and then picks the fastest. The full team is kept unless another count is more than 5% faster, so that noise does not move work\n
+    away from the memory its threads first touched.\n
+    Threads beyond the chosen count skip the phase, and go straight on to the next one. The size of each phase (e.g. the number of\n
+    travellers) is passed in every step - if any changes by more than a factor of two since the counts were chosen, tuning starts again.\n
+    Each choice is printed, and saved with the time of every candidate by \ref write. If a phase with at least 1000 items per thread\n
+    is fastest on fewer than all the threads, a warning is printed, as this usually means the phase has stopped scaling.
+    \code
+    threadTuner T;
+    T.setup(true,omp_get_max_threads(),2);
+    int loop=T.add("loop",true);
+    for (int step=0;step<nSteps;step++){
+        T.resize(loop,n);
+        #pragma omp parallel
+        {
+            threadTuner::scope timer(T,loop);
+            int k=T.threads(loop),t=omp_get_thread_num();
+            if (t<k)for (long i=(n*t)/k;i<(n*(t+1))/k;i++)work(i);
+        }
+        T.endStep(step);
+    }
+    \endcode
+*/
+class threadTuner{
+    /** @brief what is known about the thread counts of one phase */
+    struct phaseTuning{
+        /** @brief the phase name */
+        std::string name;
+        /** @brief false if the phase must always use the whole team */
+        bool tunable=true;
+        /** @brief the thread count chosen */
+        int threads=0;
+        /** @brief the size of the phase when the count was chosen (or, before then, when last given) */
+        long size=0;
+        /** @brief the shortest time of the slowest thread so far, for each candidate, in nanoseconds */
+        std::vector<int64_t> best;
+        /** @brief the time each thread has spent in the phase during this step, in nanoseconds */
+        std::vector<int64_t> spent;
+    };
+    /** @brief the phases, in the order they were added */
+    std::vector<phaseTuning> _phases;
+    /** @brief the thread counts to try */
+    std::vector<int> _candidates;
+    /** @brief the number of threads in the team */
+    int _team=1;
+    /** @brief the number of steps each candidate is timed for */
+    int _rounds=2;
+    /** @brief false to always use the whole team */
+    bool _enabled=false;
+    /** @brief the number of steps timed so far while tuning, or -1 if not tuning */
+    int _position=-1;
+    /** @brief a line for each choice made - step, phase, size, threads, then the time for each candidate */
+    std::vector<std::string> _history;
+    /** @brief the current clock time in nanoseconds */
+    static int64_t now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    /** @brief forget the timings so far and start trying the candidates again */
+    void restart(){
+        _position=0;
+        for (auto& p:_phases){
+            p.best.assign(_candidates.size(),-1);
+            p.spent.assign(_team,0);
+        }
+    }
+    /** @brief pick the fastest candidate for each phase, and record the choice
+        @param step the step tuning finished on */
+    void choose(int step){
+        for (auto& p:_phases){
+            if (!p.tunable)continue;
+            unsigned fastest=_candidates.size()-1;
+            for (unsigned c=0;c<_candidates.size();c++){
+                if (p.best[c]*1.05<p.best[fastest])fastest=c;
+            }
+            p.threads=_candidates[fastest];
+            std::string line=std::to_string(step)+","+p.name+","+std::to_string(p.size)+","+std::to_string(p.threads);
+            for (auto b:p.best)line+=","+std::to_string(b);
+            _history.push_back(line);
+            std::cout<<"Phase "<<p.name<<" ("<<p.size<<" items) uses "<<p.threads<<" of "<<_team<<" threads";
+            if (p.threads<_team && p.best[fastest]>0)std::cout<<", "<<double(p.best.back())/p.best[fastest]<<" times faster than the whole team";
+            std::cout<<std::endl;
+            if (p.threads<_team && p.size>=1000L*_team){
+                std::cout<<"Warning: phase "<<p.name<<" has enough work for "<<_team<<" threads, but is fastest on "<<p.threads<<" - it has stopped scaling"<<std::endl;
+            }
+        }
+        _position=-1;
+    }
+public:
+    //------------------------------------------------------------------------
+    /** @brief times one thread's share of a phase, while tuning - from creation to the end of the enclosing block */
+    class scope{
+        /** @brief the tuner */
+        threadTuner& _T;
+        /** @brief the phase */
+        int _phase;
+        /** @brief the start time, or zero if not tuning */
+        int64_t _start;
+    public:
+        /** @brief start timing
+            @param T the tuner
+            @param phase the phase number, from \ref add */
+        scope(threadTuner& T,int phase):_T(T),_phase(phase){
+            _start=_T.tuning()?now():0;
+        }
+        /** @brief stop timing */
+        ~scope(){
+            if (_start>0)_T.record(_phase,now()-_start);
+        }
+    };
+    //------------------------------------------------------------------------
+    /** @brief set up the tuner - tuning starts with the next step
+        @param enabled false to always use the whole team
+        @param team the number of threads in the team
+        @param rounds the number of steps each candidate thread count is timed for */
+    void setup(bool enabled,int team,int rounds){
+        _team=std::max(team,1);
+        _rounds=std::max(rounds,1);
+        _enabled=enabled && _team>1;
+        _candidates.clear();
+        for (int k=1;k<_team;k*=2)_candidates.push_back(k);
+        _candidates.push_back(_team);
+        for (auto& p:_phases)p.threads=_team;
+        if (_enabled)restart();
+        else _position=-1;
+    }
+    /** @brief add a phase
+        @param name the name used in reports
+        @param tunable false if the phase must always use the whole team
+        @return the phase number */
+    int add(std::string name,bool tunable){
+        phaseTuning p;
+        p.name=name;
+        p.tunable=tunable;
+        p.threads=_team;
+        p.best.assign(_candidates.size(),-1);
+        p.spent.assign(_team,0);
+        _phases.push_back(p);
+        return _phases.size()-1;
+    }
+    /** @brief check whether the current step is being used to time the candidates */
+    bool tuning(){
+        return _enabled && _position>=0;
+    }
+    /** @brief the number of threads a phase should use in the current step - the same on every thread */
+    int threads(int phase){
+        if (!_enabled || !_phases[phase].tunable)return _team;
+        if (tuning())return _candidates[_position%_candidates.size()];
+        return _phases[phase].threads;
+    }
+    /** @brief the thread counts tried */
+    std::vector<int>& candidates(){
+        return _candidates;
+    }
+    /** @brief add time spent by the calling thread in a phase - each thread only writes its own slot
+        @param phase the phase number
+        @param ns the time in nanoseconds */
+    void record(int phase,int64_t ns){
+        unsigned t=omp_get_thread_num();
+        if (t<_phases[phase].spent.size())_phases[phase].spent[t]+=ns;
+    }
+    /** @brief give the size of a phase for this step - call before the step, outside the parallel region
+        @details if the size has changed a lot since the thread count was chosen, tuning starts again
+        @param phase the phase number
+        @param n the number of items (agents, places or travellers) in the phase */
+    void resize(int phase,long n){
+        phaseTuning& p=_phases[phase];
+        if (tuning() || !_enabled || !p.tunable){
+            p.size=n;
+            return;
+        }
+        if (std::max(n,p.size)>2*std::min(n,p.size)+_team){
+            std::cout<<"Phase "<<p.name<<" has changed size from "<<p.size<<" to "<<n<<" - timing the thread counts again"<<std::endl;
+            p.size=n;
+            restart();
+        }
+    }
+    /** @brief finish a step - call outside the parallel region
+        @details while tuning, keeps the time of the slowest thread in each phase for the candidate used, and picks the thread counts once\n
+        every candidate has been timed for the given number of rounds
+        @param step the step number, saved with each choice */
+    void endStep(int step){
+        if (!tuning())return;
+        unsigned c=_position%_candidates.size();
+        for (auto& p:_phases){
+            int64_t slowest=*std::max_element(p.spent.begin(),p.spent.end());
+            if (p.best[c]<0 || slowest<p.best[c])p.best[c]=slowest;
+            std::fill(p.spent.begin(),p.spent.end(),0);
+        }
+        _position++;
+        if (_position>=int(_candidates.size())*_rounds)choose(step);
+    }
+    /** @brief save every choice made, with the time of each candidate, as a .csv file - nothing is written if the tuner is off
+        @param fileName the full path of the file */
+    void write(std::string fileName){
+        if (!_enabled)return;
+        std::ofstream f(fileName);
+        if (!f.is_open()){
+            std::cout<<"Unable to open thread tuning file "<<fileName<<std::endl;
+            return;
+        }
+        f<<"step,phase,size,threads";
+        for (auto k:_candidates)f<<",ns_"<<k;
+        f<<"\n";
+        for (auto& line:_history)f<<line<<"\n";
+    }
+};
+#endif // THREADTUNER_H_INCLUDED
@@ -0,0 +1,280 @@
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file benchmark.cpp
+ * @brief Time each phase of the model step on its own, for synthetic populations of several sizes, and compare with a saved baseline
+ * @details For each population size a model is built with the usual factories (model.type, default simpleMobile), run for a few warm-up\n
+ * steps, and then stepped a number of times with each phase (totals, places, cough, disease, agents and, with the MPI coupler, exchange)\n
+ * timed separately. The phases are run in the normal order, so the model state stays the same as in a real run.\n
+ * The mean, standard deviation and coefficient of variation of each phase time are shown, along with the throughput in agents per second.\n
+ * Results are saved as JSON. If a baseline file (saved by an earlier run) is given, any phase whose throughput has dropped by more than\n
+ * the tolerance is flagged as a regression, and the program exits with status 1 - so it can be used as a check before merging changes.\n
+ * Usage: benchmark [-s 10000,100000,1000000] [-r repeats] [-w warmup] [-t threads] [-m model.type] [-p parameterFile]\n
+ *                  [-o results.json] [-b baseline.json] [-tolerance 0.1] [-v]\n
+ * With the coupler each MPI domain is run as: benchmark -d domainName [other options]\n
+ * Build with "make benchmark" from the main model directory. Output files from the model go in ./benchmarkOutput.
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<iostream>
+#include<iomanip>
+#include<fstream>
+#include<sstream>
+#include<string>
+#include<vector>
+#include<map>
+#include<algorithm>
+#include<cmath>
+#include<omp.h>
+#include"../parameters.h"
+#include"../timereporter.h"
+#include"../model.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief the timings of one phase for one population size */
+struct phaseResult{
+    /** @brief number of agents in the model */
+    long agents;
+    /** @brief the phase name */
+    std::string phase;
+    /** @brief mean time per call in seconds */
+    double mean;
+    /** @brief standard deviation of the time in seconds */
+    double stddev;
+    /** @brief shortest time in seconds */
+    double min;
+    /** @brief agents processed per second (using the mean time) */
+    double throughput;
+};
+//------------------------------------------------------------------------
+/** @brief collects the time taken by each call of a phase */
+class phaseTimes{
+    /** @brief times in seconds */
+    std::vector<double> _t;
+public:
+    /** @brief time one call of a function */
+    template<typename F> void time(F f){
+        auto start=timeReporter::getTime();
+        f();
+        _t.push_back(std::chrono::duration<double>(timeReporter::getTime()-start).count());
+    }
+    /** @brief summarise the times
+        @param agents the number of agents processed by each call
+        @param phase the phase name */
+    phaseResult result(long agents,std::string phase){
+        double sum=0,sum2=0,least=_t.empty()?0:_t[0];
+        for (auto t:_t){sum+=t;least=std::min(least,t);}
+        double mean=_t.empty()?0:sum/_t.size();
+        for (auto t:_t)sum2+=(t-mean)*(t-mean);
+        double sd=_t.size()>1?sqrt(sum2/(_t.size()-1)):0;
+        return {agents,phase,mean,sd,least,mean>0?agents/mean:0};
+    }
+};
+//------------------------------------------------------------------------
+/** @brief read a results file saved by \ref writeResults - each result is on its own line, so a simple key search is enough
+    @param fileName the file to read
+    @return the throughput for each phase, keyed by "agents/phase" */
+std::map<std::string,double> readBaseline(std::string fileName){
+    std::map<std::string,double> baseline;
+    std::ifstream f(fileName);
+    if (!f.is_open()){
+        std::cout<<"Unable to open baseline file "<<fileName<<std::endl;
+        exit(1);
+    }
+    auto value=[](const std::string& line,std::string key){
+        size_t p=line.find("\""+key+"\":");
+        if (p==std::string::npos)return std::string();
+        p+=key.size()+3;
+        size_t e=line.find_first_of(",}",p);
+        std::string v=line.substr(p,e-p);
+        v.erase(std::remove(v.begin(),v.end(),'"'),v.end());
+        return v;
+    };
+    std::string line;
+    while (std::getline(f,line)){
+        std::string agents=value(line,"agents"),phase=value(line,"phase"),throughput=value(line,"agents_per_s");
+        if (agents.empty() || phase.empty() || throughput.empty())continue;
+        baseline[agents+"/"+phase]=std::stod(throughput);
+    }
+    return baseline;
+}
+//------------------------------------------------------------------------
+/** @brief save the results as JSON, one result per line
+    @param fileName the file to write
+    @param results the phase timings
+    @param threads the number of threads used
+    @param repeats the number of timed steps */
+void writeResults(std::string fileName,std::vector<phaseResult>& results,int threads,int repeats){
+    std::ofstream f(fileName);
+    if (!f.is_open()){
+        std::cout<<"Unable to open results file "<<fileName<<std::endl;
+        exit(1);
+    }
+    f<<std::setprecision(9);
+    f<<"{\"threads\":"<<threads<<",\"repeats\":"<<repeats<<",\n\"results\":[\n";
+    for (unsigned i=0;i<results.size();i++){
+        phaseResult& r=results[i];
+        f<<"{\"agents\":"<<r.agents<<",\"phase\":\""<<r.phase<<"\",\"mean_s\":"<<r.mean<<",\"stddev_s\":"<<r.stddev
+         <<",\"min_s\":"<<r.min<<",\"agents_per_s\":"<<r.throughput<<"}"<<(i+1<results.size()?",":"")<<"\n";
+    }
+    f<<"]}\n";
+}
+//------------------------------------------------------------------------
+/** @brief build a model of the given size and time its phases
+    @param parameters the model parameters - run.nAgents is set here
+    @param domain the MPI domain name (ignored without the coupler)
+    @param nAgents the population size
+    @param warmup the number of untimed steps before timing starts
+    @param repeats the number of timed steps
+    @param verbose if false the model's own messages are hidden
+    @return the timings of each phase */
+std::vector<phaseResult> runSize(parameterSettings& parameters,std::string domain,long nAgents,int warmup,int repeats,bool verbose){
+    parameters.setParameter("run.nAgents",std::to_string(nAgents));
+    //about 1% infected, so that the disease phase has some work to do from the start
+    parameters.setParameter("disease.simplistic.initialNumberInfected",std::to_string(std::max(1L,nAgents/100)));
+    std::stringstream quiet;
+    std::streambuf* console=std::cout.rdbuf();
+    if (!verbose)std::cout.rdbuf(quiet.rdbuf());
+    std::vector<phaseResult> results;
+    {
+        model m(parameters,domain);
+        int step=0;
+        for (;step<warmup;step++)m.step(step,parameters);
+        phaseTimes totals,places,cough,disease,agents;
+#ifdef COUPLER
+        phaseTimes exchange;
+#endif
+        for (int k=0;k<repeats;k++,step++){
+            //the same order as model::step, so the model state evolves as it would in a real run
+#ifdef COUPLER
+            exchange.time([&]{m.exchange(step);});
+#endif
+            long infected,recovered,dead;
+            totals.time([&]{m.countTotals(infected,recovered,dead);});
+            places.time([&]{m.updatePlaces();});
+            cough.time([&]{m.coughAll();});
+            disease.time([&]{m.processDisease(step);});
+            agents.time([&]{m.updateAgents();});
+            timeStep::update();
+        }
+        long n=m.numberOfAgents();
+        results.push_back(totals.result(n,"totals"));
+        results.push_back(places.result(n,"places"));
+        results.push_back(cough.result(n,"cough"));
+        results.push_back(disease.result(n,"disease"));
+        results.push_back(agents.result(n,"agents"));
+#ifdef COUPLER
+        results.push_back(exchange.result(n,"exchange"));
+#endif
+        m.end(parameters);
+    }
+    std::cout.rdbuf(console);
+    return results;
+}
+//------------------------------------------------------------------------
+/** @brief read the command line, run the benchmarks and compare with the baseline
+ @param argc The number of command line arguments
+ @param argv The arguments - see the file description for the options */
+int main(int argc, char **argv) {
+    std::vector<long> sizes={10000,100000,1000000};
+    int repeats=10,warmup=2,threads=omp_get_max_threads();
+    double tolerance=0.1;
+    bool verbose=false;
+    std::string modelType="",parameterFile="",resultsFile="benchmark.json",baselineFile="",domain="none";
+    for (int i=1;i<argc;i++){
+        std::string a=argv[i];
+        bool hasValue=(i+1<argc);
+        if (a=="-v"){verbose=true;continue;}
+        if (!hasValue){
+            std::cout<<"Missing value for option "<<a<<std::endl;
+            return 1;
+        }
+        std::string v=argv[++i];
+        if (a=="-s"){
+            sizes.clear();
+            std::stringstream ss(v);
+            std::string s;
+            //allow sizes like 1e6 as well as 1000000
+            while (std::getline(ss,s,','))sizes.push_back(long(std::stod(s)));
+        }
+        else if (a=="-r")repeats=std::stoi(v);
+        else if (a=="-w")warmup=std::stoi(v);
+        else if (a=="-t")threads=std::stoi(v);
+        else if (a=="-m")modelType=v;
+        else if (a=="-p")parameterFile=v;
+        else if (a=="-o")resultsFile=v;
+        else if (a=="-b")baselineFile=v;
+        else if (a=="-d")domain=v;
+        else if (a=="-tolerance")tolerance=std::stod(v);
+        else{
+            std::cout<<"Unknown option "<<a<<std::endl;
+            std::cout<<"Usage: "<<argv[0]<<" [-s sizes] [-r repeats] [-w warmup] [-t threads] [-m model.type] [-p parameterFile]"
+                     <<" [-o results.json] [-b baseline.json] [-tolerance 0.1] [-d domain] [-v]"<<std::endl;
+            return 1;
+        }
+    }
+    parameterSettings parameters;
+    if (!parameterFile.empty())parameters.readParameters(parameterFile);
+    if (!modelType.empty())parameters.setParameter("model.type",modelType);
+    parameters.setParameter("run.nThreads",std::to_string(threads));
+    omp_set_num_threads(threads);
+    //keep the benchmark to the step itself - no extra output, and the model output is overwritten each time
+    parameters.setParameter("experiment.output.directory","./benchmarkOutput");
+    parameters.setParameter("experiment.name","benchmark");
+    parameters.setParameter("experiment.run.number","0000");
+    parameters.setParameter("profile.enabled","false");
+    parameters.setParameter("profile.counters","false");
+    parameters.setParameter("memory.report","false");
+    parameters.setParameter("trace.enabled","false");
+    parameters.setParameter("events.log","false");
+    parameters.setParameter("snapshot.interval","0");
+    disease d(parameters);
+
+    std::cout<<"Benchmarking model type "<<parameters("model.type")<<" with "<<threads<<" threads, "<<repeats<<" timed steps after "<<warmup<<" warm-up steps"<<std::endl;
+    std::vector<phaseResult> results;
+    for (auto n:sizes){
+        std::cout<<"Building a model with "<<n<<" agents..."<<std::endl;
+        auto r=runSize(parameters,domain,n,warmup,repeats,verbose);
+        results.insert(results.end(),r.begin(),r.end());
+    }
+    std::map<std::string,double> baseline;
+    if (!baselineFile.empty())baseline=readBaseline(baselineFile);
+    int regressions=0;
+    std::cout<<std::left<<std::setw(12)<<"agents"<<std::setw(10)<<"phase"<<std::right<<std::setw(14)<<"mean ms"<<std::setw(12)<<"stddev ms"
+             <<std::setw(8)<<"cv %"<<std::setw(16)<<"agents/s";
+    if (!baseline.empty())std::cout<<std::setw(16)<<"baseline"<<std::setw(10)<<"change %";
+    std::cout<<std::endl;
+    for (auto& r:results){
+        std::cout<<std::left<<std::setw(12)<<r.agents<<std::setw(10)<<r.phase<<std::right<<std::fixed<<std::setprecision(3)
+                 <<std::setw(14)<<r.mean*1000<<std::setw(12)<<r.stddev*1000<<std::setprecision(1)<<std::setw(8)<<(r.mean>0?100*r.stddev/r.mean:0.)
+                 <<std::scientific<<std::setprecision(3)<<std::setw(16)<<r.throughput;
+        auto b=baseline.find(std::to_string(r.agents)+"/"+r.phase);
+        if (b!=baseline.end() && b->second>0){
+            double change=r.throughput/b->second-1;
+            std::cout<<std::setw(16)<<b->second<<std::fixed<<std::setprecision(1)<<std::setw(10)<<100*change;
+            if (change< -tolerance){std::cout<<"  REGRESSION";regressions++;}
+        }
+        std::cout<<std::defaultfloat<<std::endl;
+    }
+    writeResults(resultsFile,results,threads,repeats);
+    std::cout<<"Results saved to "<<resultsFile<<std::endl;
+    if (!baseline.empty()){
+        std::cout<<std::setprecision(6)<<regressions<<" phase"<<(regressions==1?"":"s")<<" slower than the baseline by more than "<<100*tolerance<<"%"<<std::endl;
+    }
+    return regressions>0?1:0;
+}
@@ -0,0 +1,46 @@
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file populationConverter.cpp
+ * @brief Convert a csv file of agents into a binary population file for the columnar model type
+ * @details Usage: populationConverter input.csv output.mop - see \ref populationFile::convertCSV for the csv format.\n
+ * Build with "make populationConverter" from the main model directory.
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<iostream>
+#include"../populationFile.h"
+#include"../timereporter.h"
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief convert the csv file named on the command line
+ @param argc The number of command line arguments - must be 3
+ @param argv 1 is the csv file to read, 2 the population file to write */
+int main(int argc, char **argv) {
+    if (argc!=3){
+        std::cout<<"Usage: "<<argv[0]<<" input.csv output.mop"<<std::endl;
+        return 1;
+    }
+    auto start=timeReporter::getTime();
+    uint64_t n=populationFile::convertCSV(argv[1],argv[2]);
+    populationFile pop(argv[2]);
+    std::cout<<"Wrote "<<n<<" agents and "<<pop.nPlaces()<<" places to "<<argv[2]<<std::endl;
+    auto end=timeReporter::getTime();
+    timeReporter::showInterval("Conversion took: ",start,end);
+    return 0;
+}
@@ -0,0 +1,279 @@
+#ifndef TRACERECORDER_H_INCLUDED
+#define TRACERECORDER_H_INCLUDED
+/* A program to model agents moving between places
+    Copyright (C) 2021  Mike Bithell
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+    */
+/**
+ * @file traceRecorder.h
+ * @brief File containing the definition of the static \ref traceRecorder class, which saves a timeline of what each thread was doing
+ *
+ * @author Mike Bithell
+ * @date 18/10/2026
+ **/
+#include<cstdint>
+#include<cstdio>
+#include<string>
+#include<vector>
+#include<deque>
+#include<mutex>
+#include<atomic>
+#include<chrono>
+#include<iostream>
+#include<omp.h>
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief One span of time on the timeline */
+struct traceEvent{
+    /** @brief what was happening - must point at a string that lasts for the whole run, see \ref traceRecorder::intern */
+    const char* name;
+    /** @brief the group it belongs to, e.g. "step", "io" or "mpi" */
+    const char* category;
+    /** @brief start time in ns */
+    int64_t start;
+    /** @brief length in ns */
+    int64_t duration;
+};
+//------------------------------------------------------------------------
+//------------------------------------------------------------------------
+/** @brief Static class that records a timeline of spans on every thread, saved in the Chrome trace event format
+    @details The saved file can be opened in https://ui.perfetto.dev or chrome://tracing to see, thread by thread, when each part of the model\n
+    was running - and so where threads (or MPI domains) were waiting for each other.\n
+    Each thread writes into its own ring buffer, set aside in full by \ref enable, so recording a span costs two clock reads and a copy, with no\n
+    locks and no memory allocation. If a ring fills up the oldest spans are overwritten, so the file holds the most recent part of the run\n
+    (the number lost is reported). A thread is given its ring the first time it records anything. Nothing is recorded unless tracing is enabled.
+    \code
+    traceRecorder::enable(100000,8);
+    {
+        traceRecorder::span s("places","step");
+        ... do some stuff ...
+    }
+    traceRecorder::write("trace.json");
+    \endcode
+    Background threads should call \ref nameThread when they start, so that they are labelled in the timeline. OpenMP threads are\n
+    labelled with their thread number. The \ref profiler adds a span for each phase it times.
+*/
+class traceRecorder{
+    /** @brief the spans recorded by one thread, padded so that threads don't share cache lines */
+    struct alignas(64) ring{
+        /** @brief space for the spans */
+        std::vector<traceEvent> events;
+        /** @brief total number of spans recorded - the next goes in events[next % size] */
+        uint64_t next=0;
+        /** @brief label for the thread in the timeline */
+        std::string threadName;
+    };
+    /** @brief which ring the calling thread uses */
+    struct threadSlot{
+        /** @brief index into the rings, -1 if none */
+        int index=-1;
+        /** @brief the value of _generation when the ring was handed out - rings from an earlier \ref enable are not re-used */
+        int generation=-1;
+        /** @brief when the thread ends, its ring can be handed to a new background thread - see \ref nameThread */
+        ~threadSlot(){
+            if (generation!=_generation || index<0 || index>=int(_rings.size()))return;
+            std::lock_guard<std::mutex> guard(_releasedLock);
+            _released.push_back(index);
+        }
+    };
+    /** @brief true while recording */
+    inline static bool _enabled=false;
+    /** @brief one ring per thread */
+    inline static std::vector<ring> _rings;
+    /** @brief the next ring to hand out */
+    inline static std::atomic<int> _nextRing{0};
+    /** @brief counts calls to \ref enable */
+    inline static int _generation=0;
+    /** @brief rings of threads that have ended, to be re-used by new background threads */
+    inline static std::vector<int> _released;
+    /** @brief protects the released rings */
+    inline static std::mutex _releasedLock;
+    /** @brief spans from threads that arrived after all the rings were handed out */
+    inline static std::atomic<uint64_t> _unrecorded{0};
+    /** @brief the process ID shown in the timeline */
+    inline static int _pid=0;
+    /** @brief the process label shown in the timeline */
+    inline static std::string _processName="mopatop";
+    /** @brief storage for names made at run time, kept until the program ends */
+    inline static std::deque<std::string> _names;
+    /** @brief protects the stored names */
+    inline static std::mutex _namesLock;
+    /** @brief get the ring for the calling thread, handing one out if needed
+        @param background true for a background thread, which takes the ring of a thread that has ended, if there is one
+        @return a pointer to the ring, or nullptr if they have all been used */
+    static ring* myRing(bool background=false){
+        thread_local threadSlot slot;
+        if (slot.generation!=_generation){
+            slot.generation=_generation;
+            slot.index=-1;
+            if (background){
+                std::lock_guard<std::mutex> guard(_releasedLock);
+                if (!_released.empty()){
+                    slot.index=_released.back();
+                    _released.pop_back();
+                    return &_rings[slot.index];
+                }
+            }
+            slot.index=_nextRing++;
+            if (slot.index<int(_rings.size()))_rings[slot.index].threadName="openmp thread "+std::to_string(omp_get_thread_num());
+        }
+        if (slot.index>=int(_rings.size()))return nullptr;
+        return &_rings[slot.index];
+    }
+public:
+    //------------------------------------------------------------------------
+    /** @brief records a span from creation to the end of the enclosing block */
+    class span{
+        /** @brief the name of the span */
+        const char* _name;
+        /** @brief the group it belongs to */
+        const char* _category;
+        /** @brief the start time */
+        int64_t _start;
+    public:
+        /** @brief start the span
+            @param name what is happening - should be a string literal or come from \ref intern
+            @param category the group the span belongs to */
+        span(const char* name,const char* category):_name(name),_category(category){
+            _start=_enabled?now():0;
+        }
+        /** @brief finish the span and record it */
+        ~span(){
+            if (_enabled)record(_name,_category,_start,now());
+        }
+    };
+    //------------------------------------------------------------------------
+    /** @brief start recording, setting aside memory for each thread
+        @param eventsPerThread the number of spans each thread can hold before the oldest are overwritten
+        @param maxThreads the most threads (OpenMP and background) that will record spans */
+    static void enable(size_t eventsPerThread,int maxThreads){
+        _enabled=false;
+        _rings.clear();
+        _rings.resize(maxThreads);
+        for (auto& r:_rings)r.events.resize(std::max<size_t>(eventsPerThread,1));
+        {
+            std::lock_guard<std::mutex> guard(_releasedLock);
+            _released.clear();
+        }
+        _nextRing=0;
+        _unrecorded=0;
+        _generation++;
+        _enabled=true;
+    }
+    /** @brief stop recording and free the memory */
+    static void disable(){
+        _enabled=false;
+        _rings.clear();
+        {
+            std::lock_guard<std::mutex> guard(_releasedLock);
+            _released.clear();
+        }
+        _generation++;
+    }
+    /** @brief check whether spans are being recorded */
+    static bool enabled(){
+        return _enabled;
+    }
+    /** @brief nanoseconds since an arbitrary start - the same for every thread */
+    static int64_t now(){
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    /** @brief record a span on the calling thread
+        @param name what was happening - should be a string literal or come from \ref intern
+        @param category the group the span belongs to
+        @param start the start time from \ref now
+        @param end the end time from \ref now */
+    static void record(const char* name,const char* category,int64_t start,int64_t end){
+        if (!_enabled)return;
+        ring* r=myRing();
+        if (r==nullptr){_unrecorded++;return;}
+        r->events[r->next%r->events.size()]={name,category,start,end-start};
+        r->next++;
+    }
+    /** @brief label the calling thread in the timeline - call at the start of a background thread, before it records anything
+        @details the thread re-uses the ring of a thread that has ended, if there is one - so writers opened and closed again and again (e.g.\n
+        by each scenario branch) don't use up the rings. The ring is then labelled with the names of every thread that used it. */
+    static void nameThread(std::string name){
+        if (!_enabled)return;
+        ring* r=myRing(true);
+        if (r==nullptr)return;
+        //a new ring has the default OpenMP label
+        if (r->threadName.rfind("openmp thread ",0)==0)r->threadName=name;
+        else if (r->threadName.find(name)==std::string::npos)r->threadName+=", "+name;
+    }
+    /** @brief set the process shown in the timeline - useful to tell MPI domains apart when their traces are viewed together
+        @param pid a number for the process
+        @param name a label for the process */
+    static void setProcess(int pid,std::string name){
+        _pid=pid;
+        _processName=name;
+    }
+    /** @brief keep a copy of a name made at run time, so it can be used for spans
+        @param name the name
+        @return a pointer to a copy that lasts until the program ends */
+    static const char* intern(std::string name){
+        std::lock_guard<std::mutex> guard(_namesLock);
+        for (auto& n:_names)if (n==name)return n.c_str();
+        _names.push_back(name);
+        return _names.back().c_str();
+    }
+    /** @brief the number of spans lost, either overwritten in a full ring or from threads that didn't get a ring */
+    static uint64_t lost(){
+        uint64_t n=_unrecorded;
+        for (auto& r:_rings)if (r.next>r.events.size())n+=r.next-r.events.size();
+        return n;
+    }
+    /** @brief the memory set aside for spans, in bytes */
+    static uint64_t memoryUsed(){
+        uint64_t bytes=0;
+        for (auto& r:_rings)bytes+=r.events.capacity()*sizeof(traceEvent);
+        return bytes;
+    }
+    /** @brief the number of spans currently held */
+    static uint64_t held(){
+        uint64_t n=0;
+        for (auto& r:_rings)n+=std::min<uint64_t>(r.next,r.events.size());
+        return n;
+    }
+    //------------------------------------------------------------------------
+    /** @brief save the spans in the Chrome trace event JSON format, oldest first on each thread
+        @details Call when no other thread is recording - e.g. at the end of the run after the output has been flushed.
+        @param fileName the path of the file */
+    static void write(std::string fileName){
+        if (_rings.empty())return;
+        FILE* f=fopen(fileName.c_str(),"w");
+        if (f==nullptr){
+            std::cout<<"Unable to open trace file "<<fileName<<std::endl;
+            return;
+        }
+        fprintf(f,"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+        fprintf(f,"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"%s\"}}",_pid,_processName.c_str());
+        int used=std::min<int>(_nextRing,_rings.size());
+        for (int t=0;t<used;t++){
+            ring& r=_rings[t];
+            fprintf(f,",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",_pid,t,r.threadName.c_str());
+            uint64_t size=r.events.size();
+            uint64_t first=(r.next>size)?r.next-size:0;
+            for (uint64_t k=first;k<r.next;k++){
+                traceEvent& e=r.events[k%size];
+                fprintf(f,",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                        e.name,e.category,_pid,t,e.start*1.e-3,e.duration*1.e-3);
+            }
+        }
+        fprintf(f,"\n]}\n");
+        fclose(f);
+    }
+};
+#endif // TRACERECORDER_H_INCLUDED